@@ -7,6 +7,7 @@
 #include "plot2d.h"
 #include "window2file.h"
 #include <table.h>
+#include <chrono>
 
 using namespace wex;
 
@@ -855,6 +856,48 @@ void TableDemo()
     form.show();
 }
 
+void DispatchDemo()
+{
+    // time the dispatch of window messages to a form with many widgets
+    gui &form = maker::make();
+    form.move({50, 50, 400, 400});
+    form.text("Message dispatch benchmark");
+
+    const int widgets = 2000;
+    std::vector<label *> vl;
+    for (int k = 0; k < widgets; k++)
+    {
+        label &l = maker::make<label>(form);
+        l.move(10 + (k % 40) * 9, 60 + (k / 40) * 6, 8, 5);
+        vl.push_back(&l);
+    }
+
+    // the handlers outlive this function, so the count must too
+    static int moves;
+    moves = 0;
+    for (auto pl : vl)
+        pl->events().mouseMove([](wex::sMouse &)
+                               { moves++; });
+
+    // send mouse moves round the widgets, as the mouse crossing them would
+    const int messages = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < messages; k++)
+        SendMessage(vl[k % widgets]->handle(), WM_MOUSEMOVE, 0, 0);
+    double nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count() /
+                   (double)messages;
+
+    label &lb = maker::make<label>(form);
+    lb.move(10, 10, 380, 30);
+    lb.text(
+        std::to_string(moves) + " messages to " + std::to_string(widgets) +
+        " widgets, " + std::to_string((int)nsecs) + " ns each");
+
+    form.show();
+}
+
 int main()
 {
 
@@ -989,6 +1032,12 @@ int main()
     btntable.events().click([&]
                             { TableDemo(); });
 
+    button &btndispatch = wex::maker::make<button>(l);
+    btndispatch.size(150, 30);
+    btndispatch.text("Dispatch benchmark");
+    btndispatch.events().click([&]
+                               { DispatchDemo(); });
+
     button &btnModal = wex::maker::make<button>(l);
     btntable.size(150, 30);
     btntable.text("Modal");
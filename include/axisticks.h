@@ -0,0 +1,108 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "labelformat.h"
+
+namespace wex
+{
+    /** Tick marks, labels and dotted grid of a plot axis
+
+    Draws on anything with the shapes line(), text() and segments() methods,
+    so the axis of a plot window can also be drawn into a displayList or displayRaster.
+    The grid is two pixels every 25, drawn together in one segments() call after the ticks.
+
+    <pre>
+        wex::axisTicks T;
+        T.horz( S, ticks, paxis, xpmin, xumin, scale, true, ypmax );
+    </pre>
+    */
+    class axisTicks
+    {
+    public:
+        /** Draw ticks along a horizontal axis
+        @param[in] S drawing target
+        @param[in] ticks tick values
+        @param[in] paxis y pixel of axis
+        @param[in] pmin x pixel of value vmin
+        @param[in] vmin value at pmin
+        @param[in] scale pixels per unit value
+        @param[in] fGrid true to draw the grid
+        @param[in] gridTop y pixel of the top of the grid
+        */
+        template <class T>
+        void horz(
+            T &S,
+            const std::vector<double> &ticks,
+            int paxis, int pmin, double vmin, double scale,
+            bool fGrid, int gridTop)
+        {
+            myDots.clear();
+            for (double tickValue : ticks)
+            {
+                int tickPixel = pmin + scale * (tickValue - vmin);
+                S.line(
+                    {tickPixel, paxis - 5,
+                     tickPixel, paxis + 5});
+                S.text(
+                    myLabel.label(tickValue),
+                    {tickPixel, paxis + 5,
+                     tickPixel + 50, paxis + 15});
+                if (fGrid)
+                {
+                    for (int kp = paxis;
+                         kp >= gridTop;
+                         kp -= 25)
+                        myDots.insert(
+                            myDots.end(),
+                            {tickPixel, kp, tickPixel, kp + 2});
+                }
+            }
+
+            // one call for the whole grid, instead of one per pixel
+            S.segments(myDots);
+        }
+
+        /** Draw ticks along a vertical axis
+        @param[in] S drawing target
+        @param[in] ticks tick values
+        @param[in] paxis x pixel of axis
+        @param[in] pmin y pixel of value vmin
+        @param[in] vmin value at pmin
+        @param[in] scale pixels per unit value, negative when y pixels increase downward
+        @param[in] fGrid true to draw the grid
+        @param[in] gridRight x pixel beyond the right of the grid
+        */
+        template <class T>
+        void vert(
+            T &S,
+            const std::vector<double> &ticks,
+            int paxis, int pmin, double vmin, double scale,
+            bool fGrid, int gridRight)
+        {
+            myDots.clear();
+            for (double tickValue : ticks)
+            {
+                int tickPixel = pmin + scale * (tickValue - vmin);
+                S.line({paxis - 5, tickPixel,
+                        paxis + 5, tickPixel});
+                S.text(
+                    myLabel.label(tickValue),
+                    {paxis - 50, tickPixel, paxis - 5, tickPixel + 15});
+                if (fGrid)
+                {
+                    for (int kp = paxis;
+                         kp < gridRight;
+                         kp += 25)
+                        myDots.insert(
+                            myDots.end(),
+                            {kp, tickPixel, kp + 2, tickPixel});
+                }
+            }
+            S.segments(myDots);
+        }
+
+    private:
+        labelFormat myLabel;     // tick labels, kept between paints
+        std::vector<int> myDots; // grid, reused on every paint
+    };
+}
@@ -0,0 +1,185 @@
+// Benchmarks, too slow for the unit tests, built by the benchposix makefile target
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <ctime>
+#include <random>
+#include "cutest.h"
+#include "tcp.h"
+#include "cxyindex.h"
+#include "tablemodel.h"
+
+/// process CPU time in seconds, all threads
+static double cpuSecs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+std::vector<cxy> randomPoints(int n, double range, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> d(-range, range);
+    std::vector<cxy> pts;
+    for (int k = 0; k < n; k++)
+        pts.push_back(cxy(d(rng), d(rng)));
+    return pts;
+}
+std::vector<cxySegment> randomSegments(int n, double range, double length, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> d(0, range);
+    std::uniform_real_distribution<double> l(-length, length);
+    std::vector<cxySegment> segs;
+    for (int k = 0; k < n; k++)
+    {
+        cxy a(d(rng), d(rng));
+        segs.push_back(std::make_pair(a, cxy(a.x + l(rng), a.y + l(rng))));
+    }
+    return segs;
+}
+
+/** time building and querying a segment index
+@return intersections found
+*/
+template <class T>
+int timeSegmentIndex(const char *name, const std::vector<cxySegment> &segs, double range)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto msecs = [&]
+    {
+        double ret = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count() /
+                     1000.0;
+        start = std::chrono::steady_clock::now();
+        return ret;
+    };
+    T index(segs);
+    double build = msecs();
+    std::mt19937 rng(13);
+    auto pts = randomPoints(1000, range / 2, rng);
+    int found = 0;
+    for (auto &p : pts)
+        found += (int)index.nearest(p + cxy(range / 2, range / 2), 5).size();
+    double nearest = msecs();
+    for (auto &p : pts)
+    {
+        cxy mn = p + cxy(range / 2, range / 2);
+        found += (int)index.range(mn, mn + cxy(20, 20)).size();
+    }
+    double ranges = msecs();
+    int crossings = (int)index.intersections().size();
+    double intersections = msecs();
+    std::cout << name << " " << segs.size() << " segments: build " << build
+              << " ms, 1000 nearest " << nearest
+              << " ms, 1000 range " << ranges
+              << " ms, " << crossings << " intersections " << intersections << " ms\n";
+    return crossings;
+}
+
+TEST(segmentIndexScaling)
+{
+    // constant density, so the work per segment should stay about the same
+    std::mt19937 rng(12);
+    for (int n : {10000, 100000, 1000000})
+    {
+        double range = 10 * sqrt((double)n);
+        auto segs = randomSegments(n, range, 5, rng);
+        int grid = timeSegmentIndex<cSegmentGrid>("grid", segs, range);
+        int tree = timeSegmentIndex<cSegmentRTree>("rtree", segs, range);
+        CHECK(grid > n / 100);
+        CHECK_EQUAL(grid, tree);
+    }
+}
+
+TEST(tcpThroughput)
+{
+    const long long total = 256LL * 1024 * 1024;
+    const int chunk = 65536;
+
+    std::vector<wex::cSocket::eBackend> backends{wex::cSocket::eBackend::epoll};
+    if (wex::cSocket::isUringAvailable())
+        backends.push_back(wex::cSocket::eBackend::uring);
+    else
+        std::cout << "io_uring not available\n";
+    for (auto b : backends)
+    {
+        wex::cSocket S(b);
+        S.server(
+            "0",
+            [](std::string &port) {},
+            [&](std::string &port, const std::string &msg)
+            {
+                if (S.bytesRead() + (long long)msg.size() >= total)
+                    S.stop();
+            });
+
+        // a plain blocking client, so only the server side is measured
+        std::thread client([&]
+                           {
+            addrinfo hints{}, *result;
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_STREAM;
+            getaddrinfo("127.0.0.1", S.serverPort().c_str(), &hints, &result);
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            ::connect(fd, result->ai_addr, result->ai_addrlen);
+            freeaddrinfo(result);
+            std::vector<char> buf(chunk, 'x');
+            for (long long sent = 0; sent < total;)
+            {
+                int n = ::send(fd, buf.data(), chunk, MSG_NOSIGNAL);
+                if (n <= 0)
+                    break;
+                sent += n;
+            }
+            ::close(fd); });
+
+        auto start = std::chrono::steady_clock::now();
+        double cpu = cpuSecs();
+        S.run();
+        double secs = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+        cpu = cpuSecs() - cpu;
+        client.join();
+
+        CHECK_EQUAL(total, S.bytesRead());
+        double mb = total / 1048576.0;
+        std::cout << (b == wex::cSocket::eBackend::uring ? "io_uring" : "epoll   ")
+                  << " " << (int)(mb / secs) << " MB/s, "
+                  << (int)(1000 * cpu * 1024 / mb) << " ms CPU per GB, "
+                  << S.reads() << " reads\n";
+    }
+}
+
+TEST(tableSort)
+{
+    const int n = 1000000;
+    std::vector<long long> group(n);
+    std::vector<double> value(n);
+    for (int k = 0; k < n; k++)
+    {
+        group[k] = (k * 7919LL) % 1000;
+        value[k] = (k * 104729LL) % 5000;
+    }
+    auto M = std::make_shared<wex::tableColumnProvider>();
+    M->int64Column(group);
+    M->realColumn(value);
+    wex::tableIndexProvider V(M);
+    auto start = std::chrono::steady_clock::now();
+    V.sort({{1, false}, {2, false}});
+    double msecs = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count() /
+                   1000.0;
+    std::cout << "sort 1,000,000 rows on 2 columns " << msecs << " ms\n";
+    CHECK_EQUAL(n, V.rowCount());
+}
+
+int main()
+{
+    return raven::set::UnitTest::RunAllTests();
+}
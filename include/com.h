@@ -1,10 +1,19 @@
 #pragma once
+#ifndef _WIN32
+
+// POSIX termios backend, same open / read / read_async / write surface
+#include "composix.h"
+
+#else
 #include <iostream>
 #include <windows.h>
 #include <vector>
-#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <functional>
 #include "wex.h"
+#include "comstream.h"
 
 namespace wex
 {
@@ -23,8 +32,17 @@ For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/com
               myCOMHandle(0),
               myfOverlapped(true),
               myfCTSFlowControl(true),
-              myInputBufferLength( 0 )
+              myInputBufferLength( 0 ),
+              myReadRequest(0),
+              myfStop(false),
+              myfStreaming(false),
+              myStopEvent(NULL),
+              myCommEvent(NULL)
+        {
+        }
+        ~com()
         {
+            close();
         }
         /// @name Setters
         ///@{
@@ -209,6 +227,8 @@ For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/com
         {
             if (!myPortNumber.length())
                 return false;
+            if (isOpen())
+                close();
 
             DWORD dwFlagsAndAttributes = 0;
             if (myfOverlapped)
@@ -272,6 +292,14 @@ For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/com
             // empty the input buffer
             PurgeComm(myCOMHandle, PURGE_RXCLEAR);
 
+            // start reader thread, which waits for read_async requests
+            myStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+            myCommEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+            myfStop = false;
+            myfStreaming = false;
+            myReadRequest = 0;
+            myReader = std::thread(&com::reader, this);
+
             if (myInputBufferLength > 0)
             {
                 // set device input buffer length
@@ -289,10 +317,38 @@ For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/com
         }
         void close()
         {
-            if (myCOMHandle)
+            if (!myCOMHandle)
+                return;
+
+            // stop the reader thread
             {
-                CloseHandle(myCOMHandle);
+                std::lock_guard<std::mutex> lck(myMutex);
+                myfStop = true;
             }
+            myCV.notify_one();
+
+            // wake the reader if it is waiting for data.
+            // The event stays set, so a reader about to wait returns at once
+            SetEvent(myStopEvent);
+
+            if (myReader.joinable())
+            {
+                if (myReader.get_id() == std::this_thread::get_id())
+                    myReader.detach(); // closed from inside the reader
+                else
+                    myReader.join();
+            }
+
+            // stop the parser thread
+            myStream.stop();
+            myfStreaming = false;
+
+            CloseHandle(myCOMHandle);
+            myCOMHandle = 0;
+            CloseHandle(myStopEvent);
+            myStopEvent = NULL;
+            CloseHandle(myCommEvent);
+            myCommEvent = NULL;
         }
 
         /** blocking read from COM port
@@ -318,6 +374,8 @@ For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/com
             {
                 // wait for data
                 int waiting = waitForData();
+                if (waiting < 0)
+                    throw std::runtime_error("windex com read aborted");
 
                 if (needed < 0)
                 {
@@ -378,28 +436,62 @@ For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/com
       This uses the message <pre>id = WM_APP+1</pre>,
       which must NOT be used anywhere in the application code.
 
+      The read is done by the port's reader thread, started when the port opens,
+      which posts the message as soon as the read completes.
+
     */
         void read_async(
             int bytes)
         {
             // std::cout << "com read_async " << bytes << "\n";
 
-            // start blocking read in own thread
-            myFuture = std::async(
-                std::launch::async, // insist on starting immediatly
-                &com::read,
-                this,
-                bytes);
+            // pass the request to the reader thread
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myReadRequest = bytes;
+            }
+            myCV.notify_one();
+        }
+
+        /** continuous streaming read from COM port
+        @param[in] parser frame parser, e.g. std::make_shared<wex::syncFrameParser>()
+        @param[in] handler function to call with each complete frame
+        @param[in] ringSize bytes buffered between reader and parser, default 64K
 
-            // start waiting for read completion in own thread
-            myThread = new std::thread(read_sync_wait, this);
+        Returns immediatly.
 
-            /* There are now two threads running
-            one doing the reading
-            and the other waiting for the read to be finished
+        The reader thread reads continuously into a lock free byte ring.
+        A parser thread drains the ring through the frame parser
+        and calls the handler, on the parser thread, for each complete frame.
+        If the parser falls behind and the ring fills, the excess bytes are counted as overrun.
 
-            We can return now and get on with something else
-        */
+        Streaming continues until the port is closed.
+        Do not call read() or read_async() while streaming.
+        Throws exception if already streaming, close and reopen the port to stream again.
+    */
+        void stream(
+            std::shared_ptr<frameParser> parser,
+            frameParser::handler_t handler,
+            int ringSize = 65536)
+        {
+            {
+                // the reader thread is pushing into the ring, which must not be replaced
+                std::lock_guard<std::mutex> lck(myMutex);
+                if (myfStreaming)
+                    throw std::runtime_error("windex com already streaming");
+            }
+            myStream.start(parser, handler, ringSize);
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myfStreaming = true;
+            }
+            myCV.notify_one();
+        }
+
+        /// frame and overrun counters for streaming read
+        sStreamStats streamStats() const
+        {
+            return myStream.stats();
         }
 
         /// Write buffer of data to the COM port
@@ -465,14 +557,24 @@ For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/com
     private:
         std::string myPortNumber;
         HANDLE myCOMHandle;
-        std::future<void> myFuture;
-        std::thread *myThread;
         std::vector<unsigned char> myRcvbuffer; // memory buffer to copy data read from devicer
         int myInputBufferLength;                // device input buffer. 0 for default ( 4K )
         std::string myError;
         bool myfOverlapped;
         bool myfCTSFlowControl;
 
+        // reader thread, waits for read_async requests
+        std::thread myReader;
+        std::mutex myMutex;
+        std::condition_variable myCV;
+        int myReadRequest; // bytes requested by read_async, 0 for none
+        bool myfStop;
+        bool myfStreaming; // true if reading continuously for stream()
+        comStream myStream;
+        HANDLE myStopEvent; // set by close() to wake the reader
+        HANDLE myCommEvent; // signalled when WaitCommEvent completes
+
+        /// wait until data arrives, return number of bytes waiting or -1 if port closing
         int
         waitForData()
         {
@@ -491,34 +593,120 @@ For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/com
                 if (waiting)
                     return waiting;
 
-                // wait for some data to arrive
+                {
+                    std::lock_guard<std::mutex> lck(myMutex);
+                    if (myfStop)
+                        return -1;
+                }
+
+                if (!myfOverlapped)
+                {
+                    // WaitCommEvent would block with no way to wake it,
+                    // so poll for data, or for the port closing
+                    if (WaitForSingleObject(myStopEvent, 5) == WAIT_OBJECT_0)
+                        return -1;
+                    continue;
+                }
+
+                // wait for some data to arrive, or for the port closing
                 SetCommMask(myCOMHandle, EV_RXCHAR);
-                WaitCommEvent(myCOMHandle, &dwEventMask, NULL);
+                OVERLAPPED over;
+                memset(&over, 0, sizeof(over));
+                over.hEvent = myCommEvent;
+                ResetEvent(myCommEvent);
+                if (!WaitCommEvent(myCOMHandle, &dwEventMask, &over))
+                {
+                    if (GetLastError() != ERROR_IO_PENDING)
+                    {
+                        std::cout << "windex com WaitCommEvent failed " << GetLastError() << "\n";
+                        return -1;
+                    }
+                    HANDLE wait[] = {myStopEvent, myCommEvent};
+                    DWORD ret = WaitForMultipleObjects(2, wait, FALSE, INFINITE);
+                    DWORD dummy;
+                    if (ret != WAIT_OBJECT_0 + 1)
+                    {
+                        // closing, cancel the wait before the OVERLAPPED goes out of scope
+                        CancelIoEx(myCOMHandle, &over);
+                        GetOverlappedResult(myCOMHandle, &over, &dummy, TRUE);
+                        return -1;
+                    }
+                    GetOverlappedResult(myCOMHandle, &over, &dummy, FALSE);
+                }
             }
         }
-        void read_sync_wait()
+        void reader()
         {
-            // check if read is complete from time to time
-            const int check_interval_msecs = 50;
-            while (myFuture.wait_for(std::chrono::milliseconds(check_interval_msecs)) == std::future_status::timeout)
+            while (true)
             {
-                // std::cout << '.' << std::flush;
-                //  read still running, loop and check again after an interval
-            }
+                int bytes;
+                {
+                    std::unique_lock<std::mutex> lck(myMutex);
+                    myCV.wait(
+                        lck,
+                        [this]
+                        { return myfStop || myReadRequest != 0 || myfStreaming; });
+                    if (myfStop)
+                        return;
+                    if (myfStreaming)
+                        break;
+                    bytes = myReadRequest;
+                }
 
-            // read complete
-            // send WM_APP+1 message to parent window
-            // which will be handled, not in this thread,
-            // but in the thread that created the window.
+                try
+                {
+                    read(bytes);
+                }
+                catch (std::runtime_error &e)
+                {
+                    // port closing or failed
+                    std::cout << e.what() << "\n";
+                    return;
+                }
+
+                // clear request before notifying, so handler can request next read
+                {
+                    std::lock_guard<std::mutex> lck(myMutex);
+                    myReadRequest = 0;
+                }
+
+                // read complete
+                // send WM_APP+1 message to parent window
+                // which will be handled, not in this thread,
+                // but in the thread that created the window.
 
-            PostMessageA(
-                myParent->handle(),
-                WM_APP + 1,
-                myID,
-                0);
+                PostMessageA(
+                    myParent->handle(),
+                    WM_APP + 1,
+                    myID,
+                    0);
+            }
 
-            // return, terminating the wait thread
-            return;
+            // streaming, read continuously into the ring
+            std::vector<unsigned char> chunk(4096);
+            while (true)
+            {
+                int waiting = waitForData();
+                if (waiting < 0)
+                    return;
+                if (waiting > (int)chunk.size())
+                    waiting = (int)chunk.size();
+                DWORD NoBytesRead;
+                _OVERLAPPED over;
+                memset(&over, 0, sizeof(over));
+                if (!ReadFile(
+                        myCOMHandle,
+                        chunk.data(),
+                        waiting,
+                        &NoBytesRead,
+                        &over))
+                {
+                    std::cout << "windex com stream read failed " << GetLastError() << "\n";
+                    return;
+                }
+                myStream.push(chunk.data(), waiting);
+            }
         }
     };
 }
+#endif
@@ -0,0 +1,711 @@
+#pragma once
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include "comstream.h"
+
+namespace wex
+{
+    /**  @brief read / write to serial port, POSIX termios backend
+
+    The same open / read / read_async / write surface as the windows com class,
+    built on termios and non-blocking file descriptors.
+
+    There is no window system to receive messages,
+    so completion of read_async() is reported to the function registered
+    with asyncReadComplete().  This runs in the port's reader thread.
+
+    <pre>
+    wex::com port;
+    port.port("/dev/ttyUSB0");
+    port.asyncReadComplete([&](int id)
+    {
+        auto data = port.readData();
+        ...
+        port.read_async(-1);
+    });
+    if( ! port.open() )
+        std::cout << port.errorMsg();
+    port.DeviceControlString("baud=115200 parity=N data=8 stop=1");
+    port.read_async(-1);
+    </pre>
+*/
+    class com
+    {
+    public:
+        com()
+            : myFD(-1),
+              myInputBufferLength(0),
+              myfCTSFlowControl(true),
+              myReadRequest(0),
+              myfStop(false),
+              myfStreaming(false)
+        {
+            myID = NewID();
+            myWake[0] = -1;
+            myWake[1] = -1;
+            asyncReadComplete([](int) {});
+        }
+        ~com()
+        {
+            close();
+        }
+
+        /// @name Setters
+        ///@{
+
+        /** Set port to which connection will be made
+        @param[in] port device path, e.g. "/dev/ttyUSB0", or a number n for "/dev/ttySn"
+        */
+        void port(const std::string &port)
+        {
+            if (port.find('/') != std::string::npos)
+                myPortNumber = port;
+            else
+                myPortNumber = "/dev/ttyS" + port;
+        }
+
+        /// Accepted for compatibility with the windows backend, ports are always non-blocking
+        void overlapped(bool = true)
+        {
+        }
+
+        /** Enable/Disable CTS flow control
+         * @param[in] f true to enable, default true
+         *
+         * This must be called before the port is opened.
+         */
+        void CTSFlowControl(bool f = true)
+        {
+            myfCTSFlowControl = f;
+        }
+
+        /** Configure device
+        @param[in] controlString The device-control information.
+
+        The device must be open.
+
+        Control string format, same as windows
+        [baud=b][parity=p][data=d][stop=s][octs={on|off}][xon={on|off}]
+
+        Other windows keywords are ignored.
+    */
+        void DeviceControlString(const std::string &controlString)
+        {
+            termios tio;
+            if (!isOpen())
+                return;
+            if (tcgetattr(myFD, &tio))
+                return;
+
+            std::istringstream ss(controlString);
+            std::string token;
+            while (ss >> token)
+            {
+                int p = token.find('=');
+                if (p == (int)std::string::npos)
+                    continue;
+                std::string key = token.substr(0, p);
+                std::string val = token.substr(p + 1);
+                if (key == "baud")
+                {
+                    speed_t s = speed(atoi(val.c_str()));
+                    cfsetispeed(&tio, s);
+                    cfsetospeed(&tio, s);
+                }
+                else if (key == "parity")
+                {
+                    tio.c_cflag &= ~(PARENB | PARODD);
+                    if (val == "E" || val == "e")
+                        tio.c_cflag |= PARENB;
+                    else if (val == "O" || val == "o")
+                        tio.c_cflag |= PARENB | PARODD;
+                }
+                else if (key == "data")
+                {
+                    tio.c_cflag &= ~CSIZE;
+                    switch (atoi(val.c_str()))
+                    {
+                    case 5:
+                        tio.c_cflag |= CS5;
+                        break;
+                    case 6:
+                        tio.c_cflag |= CS6;
+                        break;
+                    case 7:
+                        tio.c_cflag |= CS7;
+                        break;
+                    default:
+                        tio.c_cflag |= CS8;
+                        break;
+                    }
+                }
+                else if (key == "stop")
+                {
+                    if (val == "2")
+                        tio.c_cflag |= CSTOPB;
+                    else
+                        tio.c_cflag &= ~CSTOPB;
+                }
+                else if (key == "octs")
+                {
+                    myfCTSFlowControl = (val == "on");
+                }
+                else if (key == "xon")
+                {
+                    if (val == "on")
+                        tio.c_iflag |= IXON | IXOFF;
+                    else
+                        tio.c_iflag &= ~(IXON | IXOFF);
+                }
+            }
+
+            // Force the CTS control to state requested
+            if (myfCTSFlowControl)
+                tio.c_cflag |= CRTSCTS;
+            else
+                tio.c_cflag &= ~CRTSCTS;
+
+            tcsetattr(myFD, TCSANOW, &tio);
+        }
+        void baud(int rate)
+        {
+            if (!isOpen())
+                return;
+            termios tio;
+            tcgetattr(myFD, &tio);
+            cfsetispeed(&tio, speed(rate));
+            cfsetospeed(&tio, speed(rate));
+            tio.c_cflag &= ~CRTSCTS;
+            tcsetattr(myFD, TCSANOW, &tio);
+        }
+        /// Accepted for compatibility with the windows backend, the kernel sizes the input buffer
+        void deviceInputBuffer(int length)
+        {
+            myInputBufferLength = length;
+        }
+        /** register function to call when an asynchronous read completes.
+        The function parameter identifies the com port that completed the read.
+        The function runs in the port's reader thread.
+        */
+        void asyncReadComplete(std::function<void(int id)> f)
+        {
+            myAsyncReadCompleteFunction = f;
+        }
+        ///@}
+
+        /// @name Getters
+        ///@{
+        const std::string &portNumber() const
+        {
+            return myPortNumber;
+        }
+        int baud()
+        {
+            if (!isOpen())
+                return 0;
+            termios tio;
+            tcgetattr(myFD, &tio);
+            return rate(cfgetospeed(&tio));
+        }
+        /// true if connected
+        bool isOpen()
+        {
+            return myFD >= 0;
+        }
+        int id() const
+        {
+            return myID;
+        }
+        /** Get human readable port configuration
+         * @return string
+         */
+        std::string configText()
+        {
+            std::stringstream ss;
+            if (!isOpen())
+            {
+                ss << "COM not connected\n";
+                return ss.str();
+            }
+            termios tio;
+            if (tcgetattr(myFD, &tio))
+            {
+                ss << "tcgetattr FAILED\n";
+                return ss.str();
+            }
+            int bits = 8;
+            switch (tio.c_cflag & CSIZE)
+            {
+            case CS5:
+                bits = 5;
+                break;
+            case CS6:
+                bits = 6;
+                break;
+            case CS7:
+                bits = 7;
+                break;
+            }
+            ss << "\nBaudRate " << rate(cfgetospeed(&tio))
+               << "\nParity " << ((tio.c_cflag & PARENB) ? ((tio.c_cflag & PARODD) ? "O" : "E") : "N")
+               << "\nByteSize " << bits
+               << "\nStopBits " << ((tio.c_cflag & CSTOPB) ? 2 : 1)
+               << "\nfOutxCtsFlow " << ((tio.c_cflag & CRTSCTS) ? 1 : 0)
+               << "\nfOutX " << ((tio.c_iflag & IXON) ? 1 : 0)
+               << "\nfInX " << ((tio.c_iflag & IXOFF) ? 1 : 0) << "\n";
+            return ss.str();
+        }
+        std::string &errorMsg()
+        {
+            return myError;
+        }
+
+        ///@}
+
+        /** Open connection to port
+        @return true if succesful
+
+        Opens with default configuration "baud=9600 parity=N data=8 stop=1"
+
+        Reconfigure with DeviceControlString()
+
+        On error, a mesage will be available by calling errorMsg();
+    */
+        bool open()
+        {
+            if (!myPortNumber.length())
+                return false;
+            if (isOpen())
+                close();
+
+            myFD = ::open(
+                myPortNumber.c_str(),
+                O_RDWR | O_NOCTTY | O_NONBLOCK);
+            if (myFD < 0)
+            {
+                int dw = errno;
+                myError = myPortNumber;
+                switch (dw)
+                {
+                case ENOENT:
+                    myError += " There seems to be no device connected to this port";
+                    break;
+                case EBUSY:
+                case EACCES:
+                    myError += " This port seems to be in use or not accessible";
+                    break;
+                default:
+                    myError += " This port will not open, error " + std::string(strerror(dw));
+                }
+                std::cout << "Cannot open COM at " << myError << "\n";
+                myFD = -1;
+                return false;
+            }
+
+            myError = "";
+
+            // raw mode: no echo, no line editing, no character translation
+            termios tio;
+            if (tcgetattr(myFD, &tio) == 0)
+            {
+                cfmakeraw(&tio);
+                tio.c_cflag |= CLOCAL | CREAD;
+                tcsetattr(myFD, TCSANOW, &tio);
+            }
+
+            DeviceControlString(
+                "baud=9600 parity=N data=8 stop=1 octs=off");
+
+            // empty the input buffer
+            tcflush(myFD, TCIFLUSH);
+
+            // pipe used to wake the reader thread when the port closes
+            if (pipe(myWake))
+            {
+                myError = "wake pipe failed";
+                ::close(myFD);
+                myFD = -1;
+                return false;
+            }
+            fcntl(myWake[0], F_SETFL, O_NONBLOCK);
+
+            // start reader thread, which waits for read_async requests
+            myfStop = false;
+            myfStreaming = false;
+            myReadRequest = 0;
+            myReader = std::thread(&com::reader, this);
+
+            return true;
+        }
+        void close()
+        {
+            if (!isOpen())
+                return;
+
+            // stop the reader thread
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myfStop = true;
+            }
+            myCV.notify_one();
+            char c = 0;
+            if (::write(myWake[1], &c, 1) < 0)
+                std::cout << "com close wake failed\n";
+            if (myReader.joinable())
+            {
+                if (myReader.get_id() == std::this_thread::get_id())
+                    myReader.detach(); // closed from inside completion handler
+                else
+                    myReader.join();
+            }
+
+            // stop the parser thread
+            myStream.stop();
+            myfStreaming = false;
+
+            ::close(myWake[0]);
+            ::close(myWake[1]);
+            ::close(myFD);
+            myFD = -1;
+        }
+
+        /** blocking read from COM port
+        @param[in] needed byte count, -1 to read whatever becomes available
+
+        Data will be read into a vector of bytes,
+        com::ReadData() provides a reference to this.
+
+        Throws runtime_error if the port closes or fails during the read
+    */
+        void read(int needed)
+        {
+            int totalBytesRead = 0;
+
+            // ensure there is room for the data read
+            if (needed > 0)
+                myRcvbuffer.resize(needed);
+
+            // loop reading chunks of data as they arrive
+            do
+            {
+                // wait for data
+                int waiting = waitForData();
+                if (waiting < 0)
+                    throw std::runtime_error("windex com read aborted");
+
+                int chunk;
+                if (needed < 0)
+                {
+                    needed = waiting;
+                    chunk = waiting;
+                    myRcvbuffer.resize(needed);
+                }
+                else if (waiting >= needed)
+                {
+                    // read all we need
+                    chunk = needed;
+                }
+                else
+                {
+                    // read all that is available
+                    chunk = waiting;
+                }
+
+                // read chunk
+                int ret = ::read(
+                    myFD,
+                    myRcvbuffer.data() + totalBytesRead,
+                    chunk);
+                if (ret < 0)
+                {
+                    if (errno == EAGAIN || errno == EINTR)
+                        continue;
+                    throw std::runtime_error("windex com read block failed " + std::string(strerror(errno)));
+                }
+
+                // update data counts
+                totalBytesRead += ret;
+                needed -= ret;
+
+            } while (needed > 0);
+        }
+
+        /// get reference to buffer containg data that was read
+        std::vector<unsigned char>
+        readData()
+        {
+            return myRcvbuffer;
+        }
+
+        /** non-blocking read from COM port
+        @param[in] bytes byte count to be read, -1 to read whatever becomes available
+
+      This will return imediatly.
+
+      When the specified bytes have been read
+      the function registered with asyncReadComplete() is called
+      in the port's reader thread.
+      It may call read_async() again to wait for the next packet.
+
+    */
+        void read_async(
+            int bytes)
+        {
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myReadRequest = bytes;
+            }
+            myCV.notify_one();
+        }
+
+        /** continuous streaming read from COM port
+        @param[in] parser frame parser, e.g. std::make_shared<wex::syncFrameParser>()
+        @param[in] handler function to call with each complete frame
+        @param[in] ringSize bytes buffered between reader and parser, default 64K
+
+        Returns immediatly.
+
+        The reader thread reads continuously into a lock free byte ring.
+        A parser thread drains the ring through the frame parser
+        and calls the handler, on the parser thread, for each complete frame.
+        If the parser falls behind and the ring fills, the excess bytes are counted as overrun.
+
+        Streaming continues until the port is closed.
+        Do not call read() or read_async() while streaming.
+        Throws exception if already streaming, close and reopen the port to stream again.
+    */
+        void stream(
+            std::shared_ptr<frameParser> parser,
+            frameParser::handler_t handler,
+            int ringSize = 65536)
+        {
+            {
+                // the reader thread is pushing into the ring, which must not be replaced
+                std::lock_guard<std::mutex> lck(myMutex);
+                if (myfStreaming)
+                    throw std::runtime_error("windex com already streaming");
+            }
+            myStream.start(parser, handler, ringSize);
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myfStreaming = true;
+            }
+            myCV.notify_one();
+        }
+
+        /// frame and overrun counters for streaming read
+        sStreamStats streamStats() const
+        {
+            return myStream.stats();
+        }
+
+        /// Write buffer of data to the COM port
+        int write(const std::vector<unsigned char> &buffer)
+        {
+            if (!isOpen())
+                return 0;
+            int written = 0;
+            while (written < (int)buffer.size())
+            {
+                int ret = ::write(
+                    myFD,
+                    buffer.data() + written,
+                    buffer.size() - written);
+                if (ret < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno != EAGAIN)
+                    {
+                        std::cout << "write failed " << strerror(errno) << "\n";
+                        return written;
+                    }
+
+                    // device output buffer full, wait for room
+                    pollfd pfd{myFD, POLLOUT, 0};
+                    if (poll(&pfd, 1, 10000) <= 0)
+                    {
+                        std::cout << "write timed out\n";
+                        return written;
+                    }
+                    continue;
+                }
+                written += ret;
+            }
+            return written;
+        }
+
+        ///  Write string of data to the COM port
+        int write(const std::string &msg)
+        {
+            std::vector<unsigned char> buffer(msg.begin(), msg.end());
+            return write(buffer);
+        }
+
+    private:
+        std::string myPortNumber;
+        int myFD;
+        int myID;
+        int myWake[2];                          // pipe to wake reader thread on close
+        std::vector<unsigned char> myRcvbuffer; // memory buffer to copy data read from devicer
+        int myInputBufferLength;
+        std::string myError;
+        bool myfCTSFlowControl;
+        std::function<void(int id)> myAsyncReadCompleteFunction;
+
+        // reader thread, waits for read_async requests
+        std::thread myReader;
+        std::mutex myMutex;
+        std::condition_variable myCV;
+        int myReadRequest; // bytes requested by read_async, 0 for none
+        bool myfStop;
+        bool myfStreaming; // true if reading continuously for stream()
+        comStream myStream;
+
+        /// wait until data arrives, return number of bytes waiting or -1 if port closing or device hung up
+        int waitForData()
+        {
+            while (1)
+            {
+                // check for bytes waiting to be read
+                int waiting = 0;
+                ioctl(myFD, FIONREAD, &waiting);
+                if (waiting)
+                    return waiting;
+
+                // wait for some data to arrive
+                pollfd pfd[2] = {
+                    {myFD, POLLIN, 0},
+                    {myWake[0], POLLIN, 0}};
+                if (poll(pfd, 2, -1) < 0 && errno != EINTR)
+                    return -1;
+                if (pfd[1].revents)
+                    return -1;
+                // hang up with nothing left to read, poll would keep returning at once
+                if (pfd[0].revents & (POLLERR | POLLNVAL | POLLHUP))
+                    return -1;
+            }
+        }
+
+        void reader()
+        {
+            while (true)
+            {
+                int bytes;
+                {
+                    std::unique_lock<std::mutex> lck(myMutex);
+                    myCV.wait(
+                        lck,
+                        [this]
+                        { return myfStop || myReadRequest != 0 || myfStreaming; });
+                    if (myfStop)
+                        return;
+                    if (myfStreaming)
+                        break;
+                    bytes = myReadRequest;
+                }
+
+                try
+                {
+                    read(bytes);
+                }
+                catch (std::runtime_error &e)
+                {
+                    // port closing
+                    return;
+                }
+
+                // clear request before notifying, so handler can request next read
+                {
+                    std::lock_guard<std::mutex> lck(myMutex);
+                    myReadRequest = 0;
+                }
+                myAsyncReadCompleteFunction(myID);
+            }
+
+            // streaming, read continuously into the ring
+            std::vector<unsigned char> chunk(4096);
+            while (true)
+            {
+                int waiting = waitForData();
+                if (waiting < 0)
+                    return;
+                if (waiting > (int)chunk.size())
+                    waiting = (int)chunk.size();
+                int ret = ::read(myFD, chunk.data(), waiting);
+                if (ret > 0)
+                    myStream.push(chunk.data(), ret);
+            }
+        }
+
+        static speed_t speed(int rate)
+        {
+            switch (rate)
+            {
+            case 1200:
+                return B1200;
+            case 2400:
+                return B2400;
+            case 4800:
+                return B4800;
+            case 19200:
+                return B19200;
+            case 38400:
+                return B38400;
+            case 57600:
+                return B57600;
+            case 115200:
+                return B115200;
+            case 230400:
+                return B230400;
+            default:
+                return B9600;
+            }
+        }
+        static int rate(speed_t s)
+        {
+            switch (s)
+            {
+            case B1200:
+                return 1200;
+            case B2400:
+                return 2400;
+            case B4800:
+                return 4800;
+            case B19200:
+                return 19200;
+            case B38400:
+                return 38400;
+            case B57600:
+                return 57600;
+            case B115200:
+                return 115200;
+            case B230400:
+                return 230400;
+            default:
+                return 9600;
+            }
+        }
+        static int NewID()
+        {
+            static int lastID = 0;
+            lastID++;
+            return lastID;
+        }
+    };
+}
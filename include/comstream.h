@@ -0,0 +1,364 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace wex
+{
+    /** @brief Lock free single producer, single consumer ring of bytes
+
+    One thread writes, another reads, without locking.
+    Capacity is rounded up to a power of two.
+    */
+    class cByteRing
+    {
+    public:
+        cByteRing(int capacity = 65536)
+        {
+            int c = 1;
+            while (c < capacity)
+                c <<= 1;
+            myBuffer.resize(c);
+            myMask = c - 1;
+            myHead = 0;
+            myTail = 0;
+        }
+        /** write bytes, producer thread only
+        @param[in] p pointer to bytes
+        @param[in] n number of bytes
+        @return number of bytes written, less than n if the ring is full
+        */
+        int write(const unsigned char *p, int n)
+        {
+            size_t head = myHead.load(std::memory_order_relaxed);
+            size_t tail = myTail.load(std::memory_order_acquire);
+            int space = (int)(myBuffer.size() - (head - tail));
+            if (n > space)
+                n = space;
+            for (int k = 0; k < n; k++)
+                myBuffer[(head + k) & myMask] = p[k];
+            myHead.store(head + n, std::memory_order_release);
+            return n;
+        }
+        /** read bytes, consumer thread only
+        @param[out] p buffer for bytes
+        @param[in] n size of buffer
+        @return number of bytes read
+        */
+        int read(unsigned char *p, int n)
+        {
+            size_t tail = myTail.load(std::memory_order_relaxed);
+            size_t head = myHead.load(std::memory_order_acquire);
+            int avail = (int)(head - tail);
+            if (n > avail)
+                n = avail;
+            for (int k = 0; k < n; k++)
+                p[k] = myBuffer[(tail + k) & myMask];
+            myTail.store(tail + n, std::memory_order_release);
+            return n;
+        }
+        /// bytes waiting to be read
+        int size() const
+        {
+            return (int)(myHead.load(std::memory_order_acquire) -
+                         myTail.load(std::memory_order_acquire));
+        }
+        bool empty() const
+        {
+            return size() == 0;
+        }
+        int capacity() const
+        {
+            return (int)myBuffer.size();
+        }
+
+    private:
+        std::vector<unsigned char> myBuffer;
+        size_t myMask;
+        std::atomic<size_t> myHead; // total bytes written
+        std::atomic<size_t> myTail; // total bytes read
+    };
+
+    /** @brief Base class for frame parsers used by com::stream()
+
+    A parser is fed the byte stream in arbitrary chunks
+    and calls the frame handler with each complete frame it finds.
+    */
+    class frameParser
+    {
+    public:
+        typedef std::function<void(const std::vector<unsigned char> &frame)> handler_t;
+
+        frameParser()
+            : myFrames(0), myLost(0), myDiscarded(0)
+        {
+        }
+        virtual ~frameParser() {}
+
+        /** parse some bytes
+        @param[in] p pointer to bytes
+        @param[in] n number of bytes
+        @param[in] handler function to call with each complete frame
+        */
+        virtual void feed(
+            const unsigned char *p, int n,
+            const handler_t &handler) = 0;
+
+        /// complete frames found
+        long long frames() const
+        {
+            return myFrames;
+        }
+        /// frames found but rejected, e.g. by CRC check
+        long long framesLost() const
+        {
+            return myLost;
+        }
+        /// bytes skipped while searching for start of frame
+        long long discarded() const
+        {
+            return myDiscarded;
+        }
+
+    protected:
+        std::atomic<long long> myFrames;
+        std::atomic<long long> myLost;
+        std::atomic<long long> myDiscarded;
+    };
+
+    /** @brief Parse frames of sync word, length, payload and CRC
+
+    Frame layout
+    <pre>
+    sync word | length | payload | CRC
+    </pre>
+    - sync word: the bytes given to the constructor, default 0xAA 0x55
+    - length: payload byte count, little endian, 1 or 2 bytes
+    - CRC: CRC-16/CCITT-FALSE of length and payload, 2 bytes little endian
+
+    Frames that fail the CRC, or whose length exceeds the maximum, are counted as lost
+    and the search for the next sync word restarts one byte after the rejected sync word.
+    The handler receives the payload.
+    */
+    class syncFrameParser : public frameParser
+    {
+    public:
+        syncFrameParser(
+            const std::vector<unsigned char> &sync = {0xAA, 0x55},
+            int lengthBytes = 2,
+            int maxLength = 4096)
+            : mySync(sync),
+              myLengthBytes(lengthBytes == 1 ? 1 : 2),
+              myMaxLength(maxLength)
+        {
+        }
+
+        void feed(
+            const unsigned char *p, int n,
+            const handler_t &handler)
+        {
+            myWork.insert(myWork.end(), p, p + n);
+
+            int start = 0;
+            int header = (int)mySync.size() + myLengthBytes;
+            while ((int)myWork.size() - start >= header)
+            {
+                // search for sync word
+                if (memcmp(myWork.data() + start, mySync.data(), mySync.size()))
+                {
+                    start++;
+                    myDiscarded++;
+                    continue;
+                }
+
+                // payload length
+                int len = myWork[start + mySync.size()];
+                if (myLengthBytes == 2)
+                    len |= myWork[start + mySync.size() + 1] << 8;
+                if (len > myMaxLength)
+                {
+                    myLost++;
+                    start++;
+                    continue;
+                }
+
+                // wait for complete frame
+                int total = header + len + 2;
+                if ((int)myWork.size() - start < total)
+                    break;
+
+                // check CRC
+                const unsigned char *body = myWork.data() + start + mySync.size();
+                unsigned short crc = crc16(body, myLengthBytes + len);
+                unsigned short rcv = body[myLengthBytes + len] |
+                                     (body[myLengthBytes + len + 1] << 8);
+                if (crc != rcv)
+                {
+                    myLost++;
+                    start++;
+                    continue;
+                }
+
+                myFrames++;
+                myFrame.assign(body + myLengthBytes, body + myLengthBytes + len);
+                handler(myFrame);
+                start += total;
+            }
+
+            // keep unparsed tail for next feed
+            myWork.erase(myWork.begin(), myWork.begin() + start);
+        }
+
+        /** build a frame around a payload
+        @param[in] payload
+        @return the frame, ready to write to the port
+        */
+        std::vector<unsigned char> encode(const std::vector<unsigned char> &payload) const
+        {
+            std::vector<unsigned char> f(mySync);
+            f.push_back(payload.size() & 0xFF);
+            if (myLengthBytes == 2)
+                f.push_back((payload.size() >> 8) & 0xFF);
+            f.insert(f.end(), payload.begin(), payload.end());
+            unsigned short crc = crc16(
+                f.data() + mySync.size(),
+                (int)f.size() - mySync.size());
+            f.push_back(crc & 0xFF);
+            f.push_back(crc >> 8);
+            return f;
+        }
+
+        /// CRC-16/CCITT-FALSE, polynomial 0x1021, initial value 0xFFFF
+        static unsigned short crc16(const unsigned char *p, int n)
+        {
+            unsigned short crc = 0xFFFF;
+            for (int k = 0; k < n; k++)
+            {
+                crc ^= p[k] << 8;
+                for (int b = 0; b < 8; b++)
+                    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
+            return crc;
+        }
+
+    private:
+        std::vector<unsigned char> mySync;
+        int myLengthBytes;
+        int myMaxLength;
+        std::vector<unsigned char> myWork;  // bytes received but not yet parsed
+        std::vector<unsigned char> myFrame; // payload of frame passed to handler
+    };
+
+    /// counters for a streaming com port
+    struct sStreamStats
+    {
+        long long frames;     ///< complete frames passed to handler
+        long long framesLost; ///< frames rejected by parser
+        long long discarded;  ///< bytes skipped by parser searching for start of frame
+        long long overrun;    ///< bytes dropped because the ring was full
+    };
+
+    /** @brief Drive a frame parser from a byte ring on its own thread
+
+    Used by com::stream().  The port's reader thread pushes bytes into the ring,
+    the parser thread drains the ring and runs the frame parser.
+    */
+    class comStream
+    {
+    public:
+        comStream()
+            : myfRunning(false), myOverrun(0)
+        {
+        }
+        ~comStream()
+        {
+            stop();
+        }
+        void start(
+            std::shared_ptr<frameParser> parser,
+            frameParser::handler_t handler,
+            int ringSize)
+        {
+            // the reader may still be pushing into the ring
+            if (myfRunning)
+                throw std::runtime_error("comStream already started");
+            myParser = parser;
+            myHandler = handler;
+            myRing.reset(new cByteRing(ringSize));
+            myOverrun = 0;
+            myfRunning = true;
+            myThread = std::thread(&comStream::parse, this);
+        }
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                if (!myfRunning)
+                    return;
+                myfRunning = false;
+            }
+            myCV.notify_one();
+            if (myThread.joinable())
+                myThread.join();
+        }
+        bool isRunning() const
+        {
+            return myfRunning;
+        }
+        /// add bytes received, reader thread only
+        void push(const unsigned char *p, int n)
+        {
+            int w = myRing->write(p, n);
+            if (w < n)
+                myOverrun += n - w;
+            std::lock_guard<std::mutex> lck(myMutex);
+            myCV.notify_one();
+        }
+        sStreamStats stats() const
+        {
+            sStreamStats s;
+            s.frames = myParser ? myParser->frames() : 0;
+            s.framesLost = myParser ? myParser->framesLost() : 0;
+            s.discarded = myParser ? myParser->discarded() : 0;
+            s.overrun = myOverrun;
+            return s;
+        }
+
+    private:
+        std::shared_ptr<frameParser> myParser;
+        frameParser::handler_t myHandler;
+        std::unique_ptr<cByteRing> myRing;
+        std::thread myThread;
+        std::mutex myMutex;
+        std::condition_variable myCV;
+        std::atomic<bool> myfRunning;
+        std::atomic<long long> myOverrun;
+
+        void parse()
+        {
+            std::vector<unsigned char> chunk(4096);
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lck(myMutex);
+                    myCV.wait(
+                        lck,
+                        [this]
+                        { return !myfRunning || !myRing->empty(); });
+                    if (!myfRunning)
+                        return;
+                }
+                int n;
+                while ((n = myRing->read(chunk.data(), (int)chunk.size())))
+                    myParser->feed(chunk.data(), n, myHandler);
+            }
+        }
+    };
+}
@@ -3,6 +3,14 @@
 #include <cfloat>
 #include <cmath>
 #include <vector>
+#include <algorithm>
+#include <iostream>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+template <class T>
+class cxyView;
 
 /// @brief 2D point or vector
 class cxy
@@ -107,6 +115,9 @@ public:
         }
         return (c == 1);
     }
+    /// true if point inside polygon stored as structure of arrays
+    bool isInside(const cxyView<double> &polygon) const;
+    bool isInside(const cxyView<float> &polygon) const;
 
     static cxy enclosingWidthHeight(const std::vector<cxy> &polygon)
     {
@@ -138,8 +149,12 @@ public:
             area += (polygon[j].x + polygon[i].x) * (polygon[j].y - polygon[i].y);
             j = i; // j is previous vertex to i
         }
-        return abs(area / 2);
+        return fabs(area / 2);
     }
+    static cxy enclosingWidthHeight(const cxyView<double> &polygon);
+    static cxy enclosingWidthHeight(const cxyView<float> &polygon);
+    static double polygonArea(const cxyView<double> &polygon);
+    static double polygonArea(const cxyView<float> &polygon);
 
     /** true if line segments intersect
         @param[out] p point of intersection
@@ -330,6 +345,509 @@ public:
         return os;
     }
 };
+/** @brief Polygon prepared for fast point in polygon tests
+
+The edge slopes and the bounding box are calculated once, on construction,
+so each test costs a multiply and compare per edge, with no division.
+
+Optionally the edges are indexed by horizontal bands ( rows )
+so that a point is tested only against the edges that span its band.
+This pays off for polygons with many edges.
+
+classify() tests a batch of points.
+When compiled with AVX2 enabled ( e.g. -mavx2 ) and no row index
+it tests four points at a time.
+
+The result is the same as cxy::isInside,
+except possibly for points within rounding distance of an edge.
+*/
+class cPreparedPolygon
+{
+public:
+    /** CTOR
+    @param[in] polygon vertices
+    @param[in] rows number of horizontal bands to index edges, 0 for no index
+    */
+    cPreparedPolygon(
+        const std::vector<cxy> &polygon,
+        int rows = 0)
+        : myRows(0)
+    {
+        myMin = cxy(DBL_MAX, DBL_MAX);
+        myMax = cxy(-DBL_MAX, -DBL_MAX);
+        if (!polygon.size())
+            return;
+        for (const cxy &p : polygon)
+        {
+            myMin.x = std::min(myMin.x, p.x);
+            myMin.y = std::min(myMin.y, p.y);
+            myMax.x = std::max(myMax.x, p.x);
+            myMax.y = std::max(myMax.y, p.y);
+        }
+
+        // edges from vertex j to vertex i, as in cxy::isInside
+        auto j = polygon.end() - 1;
+        for (auto i = polygon.begin(); i != polygon.end(); j = i++)
+        {
+            // horizontal edges are never crossed
+            if (i->y == j->y)
+                continue;
+            myIY.push_back(i->y);
+            myJY.push_back(j->y);
+            myIX.push_back(i->x);
+            mySlope.push_back((j->x - i->x) / (j->y - i->y));
+        }
+
+        if (rows > 0 && myMax.y > myMin.y)
+        {
+            myRows = rows;
+            myRowHeight = (myMax.y - myMin.y) / rows;
+            myRowEdge.resize(rows);
+            for (int e = 0; e < (int)myIY.size(); e++)
+            {
+                int r1 = row(std::min(myIY[e], myJY[e]));
+                int r2 = row(std::max(myIY[e], myJY[e]));
+                for (int r = r1; r <= r2; r++)
+                    myRowEdge[r].push_back(e);
+            }
+        }
+    }
+
+    /// true if point inside polygon
+    bool isInside(const cxy &p) const
+    {
+        if (p.x < myMin.x || p.x > myMax.x ||
+            p.y < myMin.y || p.y > myMax.y)
+            return false;
+        bool c = false;
+        if (myRows)
+        {
+            for (int e : myRowEdge[row(p.y)])
+                if (crosses(e, p))
+                    c = !c;
+        }
+        else
+        {
+            for (int e = 0; e < (int)myIY.size(); e++)
+                if (crosses(e, p))
+                    c = !c;
+        }
+        return c;
+    }
+
+    /** test a batch of points
+    @param[in] points
+    @param[in] count number of points
+    @param[out] inside true for each point inside the polygon
+    */
+    void classify(
+        const cxy *points,
+        int count,
+        std::vector<bool> &inside) const
+    {
+        inside.resize(count);
+        int k = 0;
+#ifdef __AVX2__
+        if (!myRows)
+            k = classify4(points, count, inside);
+#endif
+        for (; k < count; k++)
+            inside[k] = isInside(points[k]);
+    }
+    void classify(
+        const std::vector<cxy> &points,
+        std::vector<bool> &inside) const
+    {
+        classify(points.data(), (int)points.size(), inside);
+    }
+
+private:
+    cxy myMin, myMax; // bounding box
+
+    // edges, structure of arrays
+    std::vector<double> myIY, myJY, myIX, mySlope;
+
+    // edge indices in each horizontal band
+    int myRows;
+    double myRowHeight;
+    std::vector<std::vector<int>> myRowEdge;
+
+    int row(double y) const
+    {
+        int r = (int)((y - myMin.y) / myRowHeight);
+        if (r < 0)
+            return 0;
+        if (r >= myRows)
+            return myRows - 1;
+        return r;
+    }
+
+    bool crosses(int e, const cxy &p) const
+    {
+        return ((myIY[e] > p.y) != (myJY[e] > p.y)) &&
+               (p.x < mySlope[e] * (p.y - myIY[e]) + myIX[e]);
+    }
+
+#ifdef __AVX2__
+    /// classify groups of four points, return number classified
+    int classify4(
+        const cxy *points,
+        int count,
+        std::vector<bool> &inside) const
+    {
+        static_assert(sizeof(cxy) == 2 * sizeof(double), "cxy must be packed x,y");
+        const __m256d minx = _mm256_set1_pd(myMin.x);
+        const __m256d maxx = _mm256_set1_pd(myMax.x);
+        const __m256d miny = _mm256_set1_pd(myMin.y);
+        const __m256d maxy = _mm256_set1_pd(myMax.y);
+        int k = 0;
+        for (; k + 4 <= count; k += 4)
+        {
+            // de-interleave x0 y0 x1 y1 x2 y2 x3 y3
+            __m256d a = _mm256_loadu_pd(&points[k].x);
+            __m256d b = _mm256_loadu_pd(&points[k + 2].x);
+            __m256d x = _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), 0xD8);
+            __m256d y = _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), 0xD8);
+
+            __m256d inbox = _mm256_and_pd(
+                _mm256_and_pd(
+                    _mm256_cmp_pd(x, minx, _CMP_GE_OQ),
+                    _mm256_cmp_pd(x, maxx, _CMP_LE_OQ)),
+                _mm256_and_pd(
+                    _mm256_cmp_pd(y, miny, _CMP_GE_OQ),
+                    _mm256_cmp_pd(y, maxy, _CMP_LE_OQ)));
+            int mask = _mm256_movemask_pd(inbox);
+            if (mask)
+            {
+                __m256d c = _mm256_setzero_pd();
+                for (int e = 0; e < (int)myIY.size(); e++)
+                {
+                    __m256d iy = _mm256_set1_pd(myIY[e]);
+                    __m256d span = _mm256_xor_pd(
+                        _mm256_cmp_pd(iy, y, _CMP_GT_OQ),
+                        _mm256_cmp_pd(_mm256_set1_pd(myJY[e]), y, _CMP_GT_OQ));
+                    __m256d xcross = _mm256_add_pd(
+                        _mm256_mul_pd(
+                            _mm256_set1_pd(mySlope[e]),
+                            _mm256_sub_pd(y, iy)),
+                        _mm256_set1_pd(myIX[e]));
+                    c = _mm256_xor_pd(
+                        c,
+                        _mm256_and_pd(
+                            span,
+                            _mm256_cmp_pd(x, xcross, _CMP_LT_OQ)));
+                }
+                mask &= _mm256_movemask_pd(c);
+            }
+            for (int b = 0; b < 4; b++)
+                inside[k + b] = (mask >> b) & 1;
+        }
+        return k;
+    }
+#endif
+};
+
+/** @brief Read only view of points stored as structure of arrays
+
+Does not own the coordinates.
+Built from a cxyArray, or from any pair of coordinate buffers.
+The cxy polygon methods accept a view in place of a std::vector<cxy>.
+*/
+template <class T>
+class cxyView
+{
+public:
+    cxyView(const T *X, const T *Y, int count)
+        : x(X), y(Y), n(count)
+    {
+    }
+    int size() const
+    {
+        return n;
+    }
+    cxy operator[](int i) const
+    {
+        return cxy(x[i], y[i]);
+    }
+
+    const T *x;
+    const T *y;
+    int n;
+};
+
+/** @brief Points stored as structure of arrays
+
+The x and y coordinates are held in separate contiguous arrays,
+so bulk operations run as simple loops the compiler can vectorize.
+Use cxyArray for double coordinates, cxyArrayf for float.
+
+<pre>
+    cxyArray a( polygon );
+    a.rotate( 0.5, cxy( 0, 0 ) );
+    a.translate( cxy( 10, 0 ) );
+    double area = a.area();
+    bool in = cxy( 1, 1 ).isInside( a );
+</pre>
+*/
+template <class T>
+class cxyArrayT
+{
+public:
+    cxyArrayT()
+    {
+    }
+    cxyArrayT(const std::vector<cxy> &points)
+    {
+        x.resize(points.size());
+        y.resize(points.size());
+        for (int i = 0; i < (int)points.size(); i++)
+        {
+            x[i] = (T)points[i].x;
+            y[i] = (T)points[i].y;
+        }
+    }
+
+    int size() const
+    {
+        return (int)x.size();
+    }
+    void clear()
+    {
+        x.clear();
+        y.clear();
+    }
+    void push_back(const cxy &p)
+    {
+        x.push_back((T)p.x);
+        y.push_back((T)p.y);
+    }
+    cxy operator[](int i) const
+    {
+        return cxy(x[i], y[i]);
+    }
+    cxyView<T> view() const
+    {
+        return cxyView<T>(x.data(), y.data(), size());
+    }
+    operator cxyView<T>() const
+    {
+        return view();
+    }
+    std::vector<cxy> toVector() const
+    {
+        std::vector<cxy> ret;
+        ret.reserve(x.size());
+        for (int i = 0; i < size(); i++)
+            ret.push_back(cxy(x[i], y[i]));
+        return ret;
+    }
+
+    /// move every point by a vector
+    void translate(const cxy &v)
+    {
+        T *px = x.data();
+        T *py = y.data();
+        const T dx = (T)v.x;
+        const T dy = (T)v.y;
+        const int n = size();
+        for (int i = 0; i < n; i++)
+        {
+            px[i] += dx;
+            py[i] += dy;
+        }
+    }
+
+    /// scale every point, as cxy::zoom
+    void zoom(float ratio)
+    {
+        T *px = x.data();
+        T *py = y.data();
+        const T r = (T)ratio;
+        const int n = size();
+        for (int i = 0; i < n; i++)
+        {
+            px[i] *= r;
+            py[i] *= r;
+        }
+    }
+
+    /// clockwise rotation around an origin, as cxy::rotate
+    void rotate(double angle, const cxy &origin)
+    {
+        T *px = x.data();
+        T *py = y.data();
+        const T s = (T)sin(angle);
+        const T c = (T)cos(angle);
+        const T ox = (T)origin.x;
+        const T oy = (T)origin.y;
+        const int n = size();
+        for (int i = 0; i < n; i++)
+        {
+            T dx = px[i] - ox;
+            T dy = py[i] - oy;
+            px[i] = dx * c + dy * s + ox;
+            py[i] = -dx * s + dy * c + oy;
+        }
+    }
+
+    /** bounding box
+    @param[out] min lower left
+    @param[out] max upper right
+    */
+    void bbox(cxy &min, cxy &max) const
+    {
+        min = cxy(DBL_MAX, DBL_MAX);
+        max = cxy(-DBL_MAX, -DBL_MAX);
+        if (!size())
+            return;
+        const T *px = x.data();
+        const T *py = y.data();
+        T mnx = px[0], mny = py[0], mxx = px[0], mxy = py[0];
+        const int n = size();
+        for (int i = 1; i < n; i++)
+        {
+            mnx = px[i] < mnx ? px[i] : mnx;
+            mny = py[i] < mny ? py[i] : mny;
+            mxx = px[i] > mxx ? px[i] : mxx;
+            mxy = py[i] > mxy ? py[i] : mxy;
+        }
+        min = cxy(mnx, mny);
+        max = cxy(mxx, mxy);
+    }
+
+    /// width and height of bounding box
+    cxy enclosingWidthHeight() const
+    {
+        cxy min, max;
+        bbox(min, max);
+        if (!size())
+            return cxy(0, 0);
+        return cxy(max.x - min.x, max.y - min.y);
+    }
+
+    /// area of polygon, shoelace formula
+    double area() const
+    {
+        return fabs(signedArea());
+    }
+
+    /// centroid of polygon area, or mean of points if the area is zero
+    cxy centroid() const
+    {
+        const int n = size();
+        if (!n)
+            return cxy();
+        const T *px = x.data();
+        const T *py = y.data();
+        double a = 0, cx = 0, cy = 0;
+        for (int i = 0; i < n; i++)
+        {
+            int j = i + 1 < n ? i + 1 : 0;
+            double cross = (double)px[i] * py[j] - (double)px[j] * py[i];
+            a += cross;
+            cx += (px[i] + px[j]) * cross;
+            cy += (py[i] + py[j]) * cross;
+        }
+        if (a == 0)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                cx += px[i];
+                cy += py[i];
+            }
+            return cxy(cx / n, cy / n);
+        }
+        return cxy(cx / (3 * a), cy / (3 * a));
+    }
+
+    std::vector<T> x;
+    std::vector<T> y;
+
+private:
+    double signedArea() const
+    {
+        const int n = size();
+        if (n < 3)
+            return 0;
+        const T *px = x.data();
+        const T *py = y.data();
+        double a = 0;
+        for (int i = 0; i < n - 1; i++)
+            a += (double)px[i] * py[i + 1] - (double)px[i + 1] * py[i];
+        a += (double)px[n - 1] * py[0] - (double)px[0] * py[n - 1];
+        return a / 2;
+    }
+};
+typedef cxyArrayT<double> cxyArray;
+typedef cxyArrayT<float> cxyArrayf;
+
+namespace cxy_detail
+{
+    template <class T>
+    bool isInside(const cxy &p, const cxyView<T> &polygon)
+    {
+        bool c = false;
+        int n = polygon.size();
+        for (int i = 0, j = n - 1; i < n; j = i++)
+        {
+            double ix = polygon.x[i], iy = polygon.y[i];
+            double jx = polygon.x[j], jy = polygon.y[j];
+            if (((iy > p.y) != (jy > p.y)) &&
+                (p.x < (jx - ix) * (p.y - iy) / (jy - iy) + ix))
+                c = !c;
+        }
+        return c;
+    }
+    template <class T>
+    cxy enclosingWidthHeight(const cxyView<T> &polygon)
+    {
+        if (!polygon.size())
+            return cxy(0, 0);
+        T mnx = polygon.x[0], mny = polygon.y[0], mxx = mnx, mxy = mny;
+        for (int i = 1; i < polygon.size(); i++)
+        {
+            mnx = polygon.x[i] < mnx ? polygon.x[i] : mnx;
+            mny = polygon.y[i] < mny ? polygon.y[i] : mny;
+            mxx = polygon.x[i] > mxx ? polygon.x[i] : mxx;
+            mxy = polygon.y[i] > mxy ? polygon.y[i] : mxy;
+        }
+        return cxy(mxx - mnx, mxy - mny);
+    }
+    template <class T>
+    double polygonArea(const cxyView<T> &polygon)
+    {
+        double area = 0;
+        int n = polygon.size();
+        for (int i = 0, j = n - 1; i < n; j = i++)
+            area += ((double)polygon.x[j] + polygon.x[i]) * ((double)polygon.y[j] - polygon.y[i]);
+        return fabs(area / 2);
+    }
+}
+inline bool cxy::isInside(const cxyView<double> &polygon) const
+{
+    return cxy_detail::isInside(*this, polygon);
+}
+inline bool cxy::isInside(const cxyView<float> &polygon) const
+{
+    return cxy_detail::isInside(*this, polygon);
+}
+inline cxy cxy::enclosingWidthHeight(const cxyView<double> &polygon)
+{
+    return cxy_detail::enclosingWidthHeight(polygon);
+}
+inline cxy cxy::enclosingWidthHeight(const cxyView<float> &polygon)
+{
+    return cxy_detail::enclosingWidthHeight(polygon);
+}
+inline double cxy::polygonArea(const cxyView<double> &polygon)
+{
+    return cxy_detail::polygonArea(polygon);
+}
+inline double cxy::polygonArea(const cxyView<float> &polygon)
+{
+    return cxy_detail::polygonArea(polygon);
+}
+
 /// @brief 3D point or vector
 class cxyz
 {
@@ -371,26 +889,32 @@ public:
             p0.z + p01.z + p02.z);
     }
 
-    cxyz cross(const cxyz &other)
+    cxyz cross(const cxyz &other) const
     {
         return cxyz(
             y * other.z - z * other.y,
             z * other.x - x * other.z,
-            x * other.y - y * other.z);
+            x * other.y - y * other.x);
     }
 
-    double dot(const cxyz &other)
+    double dot(const cxyz &other) const
     {
         return x * other.x +
                y * other.y +
                z * other.z;
     }
 
-    /// @brief intersection point between line and triangle
-    /// @param la
-    /// @param lb
-    /// @param plane
-    /// @return intersection point
+    bool isValid() const
+    {
+        return x > -DBL_MAX + 1;
+    }
+
+    /// @brief intersection point between line segment and triangle
+    /// @param la segment end
+    /// @param lb segment end
+    /// @param p0, p1, p2 triangle vertices
+    /// @return intersection point, invalid if none
+    /// For many segments against a large mesh use cxyzMesh
     /// https://en.wikipedia.org/wiki/Line%E2%80%93plane_intersection#Parametric_form
 
     static cxyz intersectLineTriangle(
@@ -399,8 +923,8 @@ public:
     {
         cxyz crossall = p0.vect(p1).cross(p0.vect(p2));
         cxyz crossu = p0.vect(p2).cross(lb.vect(la));
-        cxyz crossv = lb.vect(la).cross(p0.vect(p2));
-        cxyz lap0(la.x - p0.x, la.y - p0.y, la.z - p0.x);
+        cxyz crossv = lb.vect(la).cross(p0.vect(p1));
+        cxyz lap0(la.x - p0.x, la.y - p0.y, la.z - p0.z);
         double divisor = lb.vect(la).dot(crossall);
         double t = crossall.dot(lap0) / divisor;
         double u = crossu.dot(lap0) / divisor;
@@ -0,0 +1,550 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include "cxy.h"
+
+/** @brief Boolean operations on cxy polygons
+
+- clipConvex(): Sutherland-Hodgman, clip any polygon against a convex polygon
+- intersection(), unite(), difference(): Greiner-Hormann, any simple polygons
+- clipBatch(): clip many polygons against many tiles, spread over the cores
+
+Polygons are vectors of vertices, with no repeat of the first vertex at the end,
+in either winding order.
+
+A result is a vector of polygons, because the operations can split a polygon in pieces
+or leave holes.  A hole is returned as a separate polygon wound opposite to the outer boundaries:
+outer boundaries have a positive signed area ( counter clockwise when y is up ), holes negative.
+So the area of a result is the sum of the signed areas of its polygons.
+
+Greiner-Hormann fails when a vertex of one polygon lies on an edge of the other,
+or edges overlap.  When this is detected the first polygon is shifted
+by a distance of about 1e-9 of its size and the operation repeated,
+so the result may differ from the exact answer by that much.
+If every shift is still degenerate std::runtime_error is thrown.
+
+<pre>
+    // fields clipped against tiles, using all cores
+    auto pieces = cPolygonClip::clipBatch( fields, tiles );
+    for( auto& piece : pieces )
+        std::cout << "field " << piece.polygon << " tile " << piece.tile
+                  << " area " << cxy::polygonArea( piece.ring ) << "\n";
+</pre>
+*/
+class cPolygonClip
+{
+public:
+    typedef std::vector<cxy> polygon_t;
+
+    /// part of a polygon inside a tile
+    struct sClipped
+    {
+        int polygon;    ///< index of polygon clipped
+        int tile;       ///< index of tile clipped against
+        polygon_t ring; ///< the part of the polygon inside the tile
+    };
+
+    /// true if polygon is convex
+    static bool isConvex(const polygon_t &polygon)
+    {
+        int n = (int)polygon.size();
+        if (n < 3)
+            return false;
+        int sign = 0;
+        for (int i = 0; i < n; i++)
+        {
+            const cxy &a = polygon[i];
+            const cxy &b = polygon[(i + 1) % n];
+            const cxy &c = polygon[(i + 2) % n];
+            double cross = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+            if (cross == 0)
+                continue;
+            int s = cross > 0 ? 1 : -1;
+            if (sign && s != sign)
+                return false;
+            sign = s;
+        }
+        return sign != 0;
+    }
+
+    /** clip polygon against a convex polygon, Sutherland-Hodgman
+    @param[in] subject polygon to clip
+    @param[in] clip convex polygon
+    @return part of subject inside clip, empty if none
+
+    If subject is concave and the result should be in pieces
+    the pieces are returned joined by edges of zero area along the clip boundary.
+    */
+    static polygon_t clipConvex(
+        const polygon_t &subject,
+        const polygon_t &clip)
+    {
+        polygon_t output(subject);
+        int nc = (int)clip.size();
+        if (nc < 3)
+            return polygon_t();
+        double sense = signedArea(clip) > 0 ? 1 : -1;
+        polygon_t input;
+        for (int e = 0; e < nc && output.size(); e++)
+        {
+            const cxy &c1 = clip[e];
+            const cxy &c2 = clip[(e + 1) % nc];
+            auto side = [&](const cxy &p)
+            {
+                return sense * ((c2.x - c1.x) * (p.y - c1.y) - (c2.y - c1.y) * (p.x - c1.x));
+            };
+            input.swap(output);
+            output.clear();
+            int n = (int)input.size();
+            for (int i = 0; i < n; i++)
+            {
+                const cxy &cur = input[i];
+                const cxy &prev = input[(i + n - 1) % n];
+                double sc = side(cur);
+                double sp = side(prev);
+                if ((sc >= 0) != (sp >= 0))
+                {
+                    double t = sp / (sp - sc);
+                    output.push_back(cxy(
+                        prev.x + t * (cur.x - prev.x),
+                        prev.y + t * (cur.y - prev.y)));
+                }
+                if (sc >= 0)
+                    output.push_back(cur);
+            }
+        }
+        if (output.size() < 3)
+            output.clear();
+        return output;
+    }
+
+    /// area inside both polygons
+    static std::vector<polygon_t> intersection(
+        const polygon_t &a,
+        const polygon_t &b)
+    {
+        return boolean(a, b, eOp::intersect);
+    }
+
+    /// area inside either polygon
+    static std::vector<polygon_t> unite(
+        const polygon_t &a,
+        const polygon_t &b)
+    {
+        return boolean(a, b, eOp::unite);
+    }
+
+    /// area inside a but not inside b
+    static std::vector<polygon_t> difference(
+        const polygon_t &a,
+        const polygon_t &b)
+    {
+        return boolean(a, b, eOp::subtract);
+    }
+
+    /** clip many polygons against many tiles, in parallel
+    @param[in] polygons
+    @param[in] tiles
+    @param[in] threads number of threads, 0 for one per core
+    @return the parts of each polygon inside each tile, ordered by polygon then tile
+
+    Pairs where both polygon and tile are convex use Sutherland-Hodgman,
+    others Greiner-Hormann.  Pairs whose bounding boxes do not overlap are skipped.
+    The result does not depend on the number of threads.
+    An exception thrown clipping any pair is rethrown, after all the threads have finished.
+    */
+    static std::vector<sClipped> clipBatch(
+        const std::vector<polygon_t> &polygons,
+        const std::vector<polygon_t> &tiles,
+        int threads = 0)
+    {
+        if (threads <= 0)
+            threads = std::max(1, (int)std::thread::hardware_concurrency());
+        int np = (int)polygons.size();
+        threads = std::max(1, std::min(threads, np));
+
+        std::vector<sBox> tileBox;
+        std::vector<bool> tileConvex;
+        for (auto &t : tiles)
+        {
+            tileBox.push_back(box(t));
+            tileConvex.push_back(isConvex(t));
+        }
+
+        // each thread clips a contiguous range of polygons into its own output
+        std::vector<std::vector<sClipped>> output(threads);
+        auto work = [&](int thread)
+        {
+            int first = (int)((long long)np * thread / threads);
+            int last = (int)((long long)np * (thread + 1) / threads);
+            for (int p = first; p < last; p++)
+            {
+                sBox pb = box(polygons[p]);
+                bool convex = isConvex(polygons[p]);
+                for (int t = 0; t < (int)tiles.size(); t++)
+                {
+                    if (!pb.overlap(tileBox[t]))
+                        continue;
+                    if (convex && tileConvex[t])
+                    {
+                        polygon_t ring = clipConvex(polygons[p], tiles[t]);
+                        if (ring.size())
+                        {
+                            if (signedArea(ring) < 0)
+                                std::reverse(ring.begin(), ring.end());
+                            output[thread].push_back({p, t, ring});
+                        }
+                    }
+                    else
+                    {
+                        for (auto &ring : intersection(polygons[p], tiles[t]))
+                            output[thread].push_back({p, t, ring});
+                    }
+                }
+            }
+        };
+
+        // an exception must not escape a thread
+        std::vector<std::exception_ptr> error(threads);
+        auto guarded = [&](int thread)
+        {
+            try
+            {
+                work(thread);
+            }
+            catch (...)
+            {
+                error[thread] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int k = 1; k < threads; k++)
+            pool.emplace_back(guarded, k);
+        guarded(0);
+        for (auto &t : pool)
+            t.join();
+        for (auto &e : error)
+            if (e)
+                std::rethrow_exception(e);
+
+        std::vector<sClipped> ret;
+        for (auto &o : output)
+            ret.insert(ret.end(), o.begin(), o.end());
+        return ret;
+    }
+
+private:
+    enum class eOp
+    {
+        intersect,
+        unite,
+        subtract
+    };
+
+    struct sBox
+    {
+        cxy min, max;
+        bool overlap(const sBox &o) const
+        {
+            return min.x <= o.max.x && o.min.x <= max.x &&
+                   min.y <= o.max.y && o.min.y <= max.y;
+        }
+    };
+
+    // vertex in Greiner-Hormann linked lists
+    struct sNode
+    {
+        cxy p;
+        int next;
+        int prev;
+        int neighbour;  // same intersection in the other polygon
+        double alpha;   // position along original edge
+        bool fIntersect;
+        bool fEntry;
+        bool fVisited;
+    };
+
+    static sBox box(const polygon_t &polygon)
+    {
+        sBox b;
+        b.min = cxy(DBL_MAX, DBL_MAX);
+        b.max = cxy(-DBL_MAX, -DBL_MAX);
+        for (const cxy &p : polygon)
+        {
+            b.min.x = std::min(b.min.x, p.x);
+            b.min.y = std::min(b.min.y, p.y);
+            b.max.x = std::max(b.max.x, p.x);
+            b.max.y = std::max(b.max.y, p.y);
+        }
+        return b;
+    }
+
+    static double signedArea(const polygon_t &polygon)
+    {
+        double a = 0;
+        int n = (int)polygon.size();
+        for (int i = 0, j = n - 1; i < n; j = i++)
+            a += polygon[j].x * polygon[i].y - polygon[i].x * polygon[j].y;
+        return a / 2;
+    }
+
+    /// wind outer boundaries positive, holes negative
+    static void orient(std::vector<polygon_t> &rings)
+    {
+        for (int i = 0; i < (int)rings.size(); i++)
+        {
+            // point just inside ring, beside the middle of its first edge
+            polygon_t &r = rings[i];
+            double sign = signedArea(r) > 0 ? 1 : -1;
+            cxy mid((r[0].x + r[1].x) / 2, (r[0].y + r[1].y) / 2);
+            cxy inside(
+                mid.x - sign * (r[1].y - r[0].y) * 1e-6,
+                mid.y + sign * (r[1].x - r[0].x) * 1e-6);
+
+            // a ring inside an odd number of others is a hole
+            int depth = 0;
+            for (int j = 0; j < (int)rings.size(); j++)
+                if (j != i && inside.isInside(rings[j]))
+                    depth++;
+            bool fHole = depth % 2;
+            if ((sign < 0) != fHole)
+                std::reverse(r.begin(), r.end());
+        }
+    }
+
+    static std::vector<polygon_t> boolean(
+        const polygon_t &a,
+        const polygon_t &b,
+        eOp op)
+    {
+        std::vector<polygon_t> ret = booleanRings(a, b, op);
+        orient(ret);
+        return ret;
+    }
+
+    static std::vector<polygon_t> booleanRings(
+        const polygon_t &a,
+        const polygon_t &b,
+        eOp op)
+    {
+        std::vector<polygon_t> ret;
+        if (a.size() < 3 || b.size() < 3)
+        {
+            // an empty polygon
+            if (op != eOp::intersect && a.size() >= 3)
+                ret.push_back(a);
+            if (op == eOp::unite && b.size() >= 3)
+                ret.push_back(b);
+            return ret;
+        }
+
+        // retry with shifted subject while degenerate
+        sBox bb = box(a);
+        double size = std::max(bb.max.x - bb.min.x, bb.max.y - bb.min.y);
+        polygon_t shifted(a);
+        for (int attempt = 1; attempt < 8; attempt++)
+        {
+            if (greinerHormann(shifted, b, op, ret))
+                return ret;
+            double d = size * 1e-9 * attempt;
+            for (int k = 0; k < (int)a.size(); k++)
+                shifted[k] = cxy(a[k].x + d, a[k].y + 0.618 * d);
+        }
+        throw std::runtime_error("cPolygonClip still degenerate after shifting");
+    }
+
+    /** Greiner-Hormann
+    @return false if degenerate
+    */
+    static bool greinerHormann(
+        const polygon_t &a,
+        const polygon_t &b,
+        eOp op,
+        std::vector<polygon_t> &ret)
+    {
+        const double eps = 1e-10;
+        ret.clear();
+        int na = (int)a.size();
+        int nb = (int)b.size();
+
+        // linked lists, a then b
+        std::vector<sNode> node;
+        auto add = [&](const cxy &p)
+        {
+            sNode n;
+            n.p = p;
+            n.next = n.prev = n.neighbour = -1;
+            n.alpha = 0;
+            n.fIntersect = n.fEntry = n.fVisited = false;
+            node.push_back(n);
+            return (int)node.size() - 1;
+        };
+        for (auto &p : a)
+            add(p);
+        for (auto &p : b)
+            add(p);
+
+        // intersections found on each original edge, as alpha and node index
+        std::vector<std::vector<std::pair<double, int>>> onA(na), onB(nb);
+        for (int i = 0; i < na; i++)
+        {
+            const cxy &a1 = a[i];
+            const cxy &a2 = a[(i + 1) % na];
+            for (int j = 0; j < nb; j++)
+            {
+                const cxy &b1 = b[j];
+                const cxy &b2 = b[(j + 1) % nb];
+                double rx = a2.x - a1.x, ry = a2.y - a1.y;
+                double sx = b2.x - b1.x, sy = b2.y - b1.y;
+                double qx = b1.x - a1.x, qy = b1.y - a1.y;
+                double denom = rx * sy - ry * sx;
+                double scale = (fabs(rx) + fabs(ry)) * (fabs(sx) + fabs(sy));
+                if (fabs(denom) <= eps * scale)
+                {
+                    // parallel, degenerate if collinear and overlapping
+                    if (fabs(qx * ry - qy * rx) <= eps * (fabs(rx) + fabs(ry)) * (fabs(qx) + fabs(qy) + 1e-300))
+                    {
+                        double r2 = rx * rx + ry * ry;
+                        double t0 = (qx * rx + qy * ry) / r2;
+                        double t1 = t0 + (sx * rx + sy * ry) / r2;
+                        if (std::max(t0, t1) >= -eps && std::min(t0, t1) <= 1 + eps)
+                            return false;
+                    }
+                    continue;
+                }
+                double ta = (qx * sy - qy * sx) / denom;
+                double tb = (qx * ry - qy * rx) / denom;
+                if (ta < -eps || ta > 1 + eps || tb < -eps || tb > 1 + eps)
+                    continue;
+
+                // touching at a vertex
+                if (ta <= eps || ta >= 1 - eps || tb <= eps || tb >= 1 - eps)
+                    return false;
+
+                cxy p(a1.x + ta * rx, a1.y + ta * ry);
+                int ia = add(p);
+                int ib = add(p);
+                node[ia].fIntersect = node[ib].fIntersect = true;
+                node[ia].neighbour = ib;
+                node[ib].neighbour = ia;
+                node[ia].alpha = ta;
+                node[ib].alpha = tb;
+                onA[i].push_back(std::make_pair(ta, ia));
+                onB[j].push_back(std::make_pair(tb, ib));
+            }
+        }
+
+        // link each polygon's vertices and intersections in order
+        auto link = [&](int first, int n, std::vector<std::vector<std::pair<double, int>>> &on)
+        {
+            std::vector<int> order;
+            for (int i = 0; i < n; i++)
+            {
+                order.push_back(first + i);
+                std::sort(on[i].begin(), on[i].end());
+                for (auto &x : on[i])
+                    order.push_back(x.second);
+            }
+            int m = (int)order.size();
+            for (int k = 0; k < m; k++)
+            {
+                node[order[k]].next = order[(k + 1) % m];
+                node[order[k]].prev = order[(k + m - 1) % m];
+            }
+        };
+        link(0, na, onA);
+        link(na, nb, onB);
+
+        bool fCrossing = false;
+        for (auto &on : onA)
+            if (on.size())
+                fCrossing = true;
+
+        if (!fCrossing)
+        {
+            bool aInB = a[0].isInside(b);
+            bool bInA = b[0].isInside(a);
+            switch (op)
+            {
+            case eOp::intersect:
+                if (aInB)
+                    ret.push_back(a);
+                else if (bInA)
+                    ret.push_back(b);
+                break;
+            case eOp::unite:
+                if (aInB)
+                    ret.push_back(b);
+                else if (bInA)
+                    ret.push_back(a);
+                else
+                {
+                    ret.push_back(a);
+                    ret.push_back(b);
+                }
+                break;
+            case eOp::subtract:
+                if (aInB)
+                    break;
+                ret.push_back(a);
+                if (bInA)
+                    ret.push_back(b);
+                break;
+            }
+            return true;
+        }
+
+        // mark intersections as entering or leaving the other polygon
+        auto mark = [&](int first, bool fEntry)
+        {
+            int k = first;
+            do
+            {
+                if (node[k].fIntersect)
+                {
+                    node[k].fEntry = fEntry;
+                    fEntry = !fEntry;
+                }
+                k = node[k].next;
+            } while (k != first);
+        };
+        bool aEntry = !a[0].isInside(b);
+        bool bEntry = !b[0].isInside(a);
+        if (op == eOp::unite || op == eOp::subtract)
+            aEntry = !aEntry;
+        if (op == eOp::unite)
+            bEntry = !bEntry;
+        mark(0, aEntry);
+        mark(na, bEntry);
+
+        // trace result polygons
+        for (int start = na + nb; start < (int)node.size(); start++)
+        {
+            if (node[start].fVisited)
+                continue;
+            polygon_t ring;
+            int cur = start;
+            ring.push_back(node[cur].p);
+            do
+            {
+                node[cur].fVisited = node[node[cur].neighbour].fVisited = true;
+                bool fForward = node[cur].fEntry;
+                do
+                {
+                    cur = fForward ? node[cur].next : node[cur].prev;
+                    ring.push_back(node[cur].p);
+                } while (!node[cur].fIntersect);
+                cur = node[cur].neighbour;
+            } while (!node[cur].fVisited);
+            if (ring.size() > 1 && ring.back() == ring.front())
+                ring.pop_back();
+            if (ring.size() >= 3)
+                ret.push_back(ring);
+        }
+        return true;
+    }
+};
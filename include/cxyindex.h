@@ -0,0 +1,1034 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <set>
+#include <unordered_set>
+#include <utility>
+#include "cxy.h"
+
+/// line segment, two end points
+typedef std::pair<cxy, cxy> cxySegment;
+
+/** @brief Base for spatial indices over line segments
+
+Holds a copy of the segments and the geometry helpers shared by the indices.
+Segments are identified by their position in the vector given to the constructor.
+
+Queries are const, so several threads can query one index at the same time.
+*/
+class cSegmentIndex
+{
+public:
+    cSegmentIndex(const std::vector<cxySegment> &segments)
+        : mySegment(segments)
+    {
+    }
+
+    int size() const
+    {
+        return (int)mySegment.size();
+    }
+    const cxySegment &segment(int id) const
+    {
+        return mySegment[id];
+    }
+
+    /// distance squared from point to segment, zero length segments allowed
+    static double dist2(const cxy &p, const cxySegment &s)
+    {
+        if (s.first.x == s.second.x && s.first.y == s.second.y)
+            return p.dist2(s.first);
+        return p.dis2toline(s.first, s.second);
+    }
+
+    /// distance squared from point to box, zero if point inside box
+    static double dist2(const cxy &p, const cxy &min, const cxy &max)
+    {
+        double dx = std::max(0.0, std::max(min.x - p.x, p.x - max.x));
+        double dy = std::max(0.0, std::max(min.y - p.y, p.y - max.y));
+        return dx * dx + dy * dy;
+    }
+
+    /// true if boxes overlap
+    static bool overlap(
+        const cxy &min1, const cxy &max1,
+        const cxy &min2, const cxy &max2)
+    {
+        return min1.x <= max2.x && min2.x <= max1.x &&
+               min1.y <= max2.y && min2.y <= max1.y;
+    }
+
+    /// true if segment touches the box ( Liang-Barsky clip )
+    static bool isInRange(
+        const cxySegment &s,
+        const cxy &min, const cxy &max)
+    {
+        double t0 = 0, t1 = 1;
+        double dx = s.second.x - s.first.x;
+        double dy = s.second.y - s.first.y;
+        double p[] = {-dx, dx, -dy, dy};
+        double q[] = {s.first.x - min.x, max.x - s.first.x,
+                      s.first.y - min.y, max.y - s.first.y};
+        for (int k = 0; k < 4; k++)
+        {
+            if (p[k] == 0)
+            {
+                if (q[k] < 0)
+                    return false;
+                continue;
+            }
+            double t = q[k] / p[k];
+            if (p[k] < 0)
+                t0 = std::max(t0, t);
+            else
+                t1 = std::min(t1, t);
+            if (t0 > t1)
+                return false;
+        }
+        return true;
+    }
+
+protected:
+    std::vector<cxySegment> mySegment;
+
+    void box(int id, cxy &min, cxy &max) const
+    {
+        const cxySegment &s = mySegment[id];
+        min = cxy(std::min(s.first.x, s.second.x), std::min(s.first.y, s.second.y));
+        max = cxy(std::max(s.first.x, s.second.x), std::max(s.first.y, s.second.y));
+    }
+
+    /// exact test of segment pair, as cxy::isIntersection
+    bool isIntersection(int id1, const cxySegment &s2) const
+    {
+        cxy p;
+        const cxySegment &s1 = mySegment[id1];
+        return cxy::isIntersection(p, s1.first, s1.second, s2.first, s2.second);
+    }
+
+    /// k best candidates so far, farthest on top
+    typedef std::priority_queue<std::pair<double, int>> best_t;
+
+    static void keep(best_t &best, int k, double d2, int id)
+    {
+        if ((int)best.size() < k)
+            best.push(std::make_pair(d2, id));
+        else if (d2 < best.top().first)
+        {
+            best.pop();
+            best.push(std::make_pair(d2, id));
+        }
+    }
+    static std::vector<int> sorted(best_t &best)
+    {
+        std::vector<int> ret(best.size());
+        for (int k = (int)ret.size() - 1; k >= 0; k--)
+        {
+            ret[k] = best.top().second;
+            best.pop();
+        }
+        return ret;
+    }
+};
+
+/** @brief Uniform grid index over line segments
+
+Each segment is listed in every grid cell its bounding box overlaps.
+Fast to build, and fast to query when the segments are evenly spread and short
+compared to the cell size.  For clustered data prefer cSegmentRTree.
+
+<pre>
+    cSegmentGrid grid( segments );
+    auto near = grid.nearest( cxy( 10, 10 ), 3 );
+    auto hits = grid.range( cxy( 0, 0 ), cxy( 100, 100 ) );
+    auto crossings = grid.intersections();
+</pre>
+*/
+class cSegmentGrid : public cSegmentIndex
+{
+public:
+    /** CTOR
+    @param[in] segments
+    @param[in] cellSize width and height of grid cells, 0 to choose about one segment per cell
+    */
+    cSegmentGrid(
+        const std::vector<cxySegment> &segments,
+        double cellSize = 0)
+        : cSegmentIndex(segments),
+          myCols(0), myRows(0)
+    {
+        if (!mySegment.size())
+            return;
+        myMin = cxy(DBL_MAX, DBL_MAX);
+        myMax = cxy(-DBL_MAX, -DBL_MAX);
+        for (auto &s : mySegment)
+        {
+            for (const cxy *p : {&s.first, &s.second})
+            {
+                myMin.x = std::min(myMin.x, p->x);
+                myMin.y = std::min(myMin.y, p->y);
+                myMax.x = std::max(myMax.x, p->x);
+                myMax.y = std::max(myMax.y, p->y);
+            }
+        }
+        double w = myMax.x - myMin.x;
+        double h = myMax.y - myMin.y;
+        if (cellSize <= 0)
+        {
+            cellSize = sqrt(w * h / mySegment.size());
+            if (cellSize <= 0)
+                cellSize = std::max(w, h) / sqrt((double)mySegment.size());
+            if (cellSize <= 0)
+                cellSize = 1;
+        }
+        myCell = cellSize;
+        myCols = (int)(w / myCell) + 1;
+        myRows = (int)(h / myCell) + 1;
+        myGrid.resize((size_t)myCols * myRows);
+
+        for (int id = 0; id < (int)mySegment.size(); id++)
+        {
+            cxy mn, mx;
+            box(id, mn, mx);
+            int c1, r1, c2, r2;
+            cell(mn, c1, r1);
+            cell(mx, c2, r2);
+            for (int r = r1; r <= r2; r++)
+                for (int c = c1; c <= c2; c++)
+                    myGrid[(size_t)r * myCols + c].push_back(id);
+        }
+    }
+
+    /** segments touching a box
+    @param[in] min lower left of box
+    @param[in] max upper right of box
+    @return segment ids, in no particular order
+    */
+    std::vector<int> range(const cxy &min, const cxy &max) const
+    {
+        std::vector<int> ret;
+        if (!myCols || !overlap(min, max, myMin, myMax))
+            return ret;
+        int c1, r1, c2, r2;
+        cell(min, c1, r1);
+        cell(max, c2, r2);
+        std::unordered_set<int> seen;
+        for (int r = r1; r <= r2; r++)
+            for (int c = c1; c <= c2; c++)
+                for (int id : myGrid[(size_t)r * myCols + c])
+                    if (seen.insert(id).second &&
+                        isInRange(mySegment[id], min, max))
+                        ret.push_back(id);
+        return ret;
+    }
+
+    /** nearest segments to a point
+    @param[in] p point
+    @param[in] k number of segments wanted
+    @return segment ids, nearest first
+
+    Searches rings of cells around the point's cell,
+    stopping when no unsearched cell can hold a nearer segment.
+    */
+    std::vector<int> nearest(const cxy &p, int k = 1) const
+    {
+        best_t best;
+        if (!myCols || k < 1)
+            return sorted(best);
+        int pc, pr;
+        cell(p, pc, pr);
+
+        // a point outside the grid is clamped to a border cell,
+        // add its distance from the grid to the ring distance
+        double outside2 = dist2(p, myMin, myMax);
+
+        std::unordered_set<int> seen;
+        int maxRing = std::max(std::max(pc, myCols - 1 - pc), std::max(pr, myRows - 1 - pr));
+        for (int ring = 0; ring <= maxRing; ring++)
+        {
+            for (int r = pr - ring; r <= pr + ring; r++)
+            {
+                if (r < 0 || r >= myRows)
+                    continue;
+                int step = (r == pr - ring || r == pr + ring) ? 1 : 2 * ring;
+                for (int c = pc - ring; c <= pc + ring; c += std::max(step, 1))
+                {
+                    if (c < 0 || c >= myCols)
+                        continue;
+                    for (int id : myGrid[(size_t)r * myCols + c])
+                        if (seen.insert(id).second)
+                            keep(best, k, dist2(p, mySegment[id]), id);
+                }
+            }
+            // cells in the next ring are at least this far away
+            double reach = ring * myCell;
+            if ((int)best.size() == k && best.top().first <= outside2 + reach * reach)
+                break;
+        }
+        return sorted(best);
+    }
+
+    /** all pairs of intersecting segments
+    @return pairs of segment ids, first < second
+
+    The exact test is cxy::isIntersection.
+    A pair sharing several cells is reported only from the cell
+    holding the lower left corner of the overlap of their bounding boxes.
+    */
+    std::vector<std::pair<int, int>> intersections() const
+    {
+        std::vector<std::pair<int, int>> ret;
+        for (int r = 0; r < myRows; r++)
+            for (int c = 0; c < myCols; c++)
+            {
+                auto &ids = myGrid[(size_t)r * myCols + c];
+                for (int i = 0; i < (int)ids.size(); i++)
+                {
+                    cxy mn1, mx1;
+                    box(ids[i], mn1, mx1);
+                    for (int j = i + 1; j < (int)ids.size(); j++)
+                    {
+                        cxy mn2, mx2;
+                        box(ids[j], mn2, mx2);
+                        if (!overlap(mn1, mx1, mn2, mx2))
+                            continue;
+                        int rc, rr;
+                        cell(cxy(std::max(mn1.x, mn2.x), std::max(mn1.y, mn2.y)), rc, rr);
+                        if (rc != c || rr != r)
+                            continue;
+                        if (!isIntersection(ids[i], mySegment[ids[j]]))
+                            continue;
+                        ret.push_back(std::make_pair(
+                            std::min(ids[i], ids[j]),
+                            std::max(ids[i], ids[j])));
+                    }
+                }
+            }
+        return ret;
+    }
+
+    double cellSize() const
+    {
+        return myCell;
+    }
+
+private:
+    cxy myMin, myMax; // extent of segments
+    double myCell;
+    int myCols, myRows;
+    std::vector<std::vector<int>> myGrid; // segment ids in each cell, row major
+
+    /// grid cell containing point, clamped to grid
+    void cell(const cxy &p, int &c, int &r) const
+    {
+        c = (int)std::floor((p.x - myMin.x) / myCell);
+        r = (int)std::floor((p.y - myMin.y) / myCell);
+        c = std::max(0, std::min(c, myCols - 1));
+        r = std::max(0, std::min(r, myRows - 1));
+    }
+};
+
+/** @brief R-tree index over line segments, bulk loaded
+
+Built in one pass with the Sort-Tile-Recursive packing,
+so nodes are full and overlap little.
+The tree is static: to add segments, build a new tree.
+Handles clustered data and segments of very different lengths better than cSegmentGrid.
+
+<pre>
+    cSegmentRTree tree( segments );
+    auto near = tree.nearest( cxy( 10, 10 ), 3 );
+    auto hits = tree.range( cxy( 0, 0 ), cxy( 100, 100 ) );
+    auto crossings = tree.intersections();
+    auto joined = tree.join( otherTree );
+</pre>
+*/
+class cSegmentRTree : public cSegmentIndex
+{
+public:
+    /** CTOR
+    @param[in] segments
+    @param[in] nodeCapacity maximum children per node
+    */
+    cSegmentRTree(
+        const std::vector<cxySegment> &segments,
+        int nodeCapacity = 16)
+        : cSegmentIndex(segments),
+          myRoot(-1)
+    {
+        int M = std::max(2, nodeCapacity);
+
+        // leaf level entries are the segments
+        std::vector<sEntry> level(mySegment.size());
+        for (int id = 0; id < (int)mySegment.size(); id++)
+        {
+            box(id, level[id].min, level[id].max);
+            level[id].id = id;
+        }
+        bool leaf = true;
+        while (level.size())
+        {
+            level = pack(level, M, leaf);
+            leaf = false;
+            if (level.size() == 1)
+            {
+                myRoot = level[0].id;
+                break;
+            }
+        }
+    }
+
+    /** segments touching a box
+    @param[in] min lower left of box
+    @param[in] max upper right of box
+    @return segment ids, in no particular order
+    */
+    std::vector<int> range(const cxy &min, const cxy &max) const
+    {
+        std::vector<int> ret;
+        if (myRoot < 0)
+            return ret;
+        std::vector<int> stack{myRoot};
+        while (stack.size())
+        {
+            const sNode &n = myNode[stack.back()];
+            stack.pop_back();
+            if (!overlap(min, max, n.min, n.max))
+                continue;
+            for (int k = n.first; k < n.first + n.count; k++)
+            {
+                int child = myChild[k];
+                if (!n.leaf)
+                    stack.push_back(child);
+                else if (isInRange(mySegment[child], min, max))
+                    ret.push_back(child);
+            }
+        }
+        return ret;
+    }
+
+    /** nearest segments to a point
+    @param[in] p point
+    @param[in] k number of segments wanted
+    @return segment ids, nearest first
+
+    Best first search: nodes and segments are visited in order of distance from the point.
+    */
+    std::vector<int> nearest(const cxy &p, int k = 1) const
+    {
+        std::vector<int> ret;
+        if (myRoot < 0 || k < 1)
+            return ret;
+
+        // distance, node index or -1 - segment id, nearest on top
+        typedef std::pair<double, int> entry_t;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+        queue.push(std::make_pair(0.0, myRoot));
+        while (queue.size() && (int)ret.size() < k)
+        {
+            int i = queue.top().second;
+            queue.pop();
+            if (i < 0)
+            {
+                ret.push_back(-1 - i);
+                continue;
+            }
+            const sNode &n = myNode[i];
+            for (int c = n.first; c < n.first + n.count; c++)
+            {
+                int child = myChild[c];
+                if (n.leaf)
+                    queue.push(std::make_pair(dist2(p, mySegment[child]), -1 - child));
+                else
+                    queue.push(std::make_pair(dist2(p, myNode[child].min, myNode[child].max), child));
+            }
+        }
+        return ret;
+    }
+
+    /** all pairs of intersecting segments
+    @return pairs of segment ids, first < second
+
+    The exact test is cxy::isIntersection.
+    */
+    std::vector<std::pair<int, int>> intersections() const
+    {
+        std::vector<std::pair<int, int>> ret;
+        if (myRoot < 0)
+            return ret;
+        std::vector<std::pair<int, int>> stack{std::make_pair(myRoot, myRoot)};
+        while (stack.size())
+        {
+            auto np = stack.back();
+            stack.pop_back();
+            const sNode &a = myNode[np.first];
+            const sNode &b = myNode[np.second];
+            bool self = np.first == np.second;
+            for (int i = a.first; i < a.first + a.count; i++)
+            {
+                int ci = myChild[i];
+                for (int j = self ? i : b.first; j < b.first + b.count; j++)
+                {
+                    int cj = myChild[j];
+                    if (a.leaf)
+                    {
+                        if (self && i == j)
+                            continue;
+                        cxy mn1, mx1, mn2, mx2;
+                        box(ci, mn1, mx1);
+                        box(cj, mn2, mx2);
+                        if (overlap(mn1, mx1, mn2, mx2) &&
+                            isIntersection(ci, mySegment[cj]))
+                            ret.push_back(std::make_pair(std::min(ci, cj), std::max(ci, cj)));
+                    }
+                    else if (overlap(myNode[ci].min, myNode[ci].max,
+                                     myNode[cj].min, myNode[cj].max))
+                        stack.push_back(std::make_pair(ci, cj));
+                }
+            }
+        }
+        return ret;
+    }
+
+    /** pairs of intersecting segments, one from each tree
+    @param[in] other tree
+    @return pairs of segment ids, first in this tree, second in other
+    */
+    std::vector<std::pair<int, int>> join(const cSegmentRTree &other) const
+    {
+        std::vector<std::pair<int, int>> ret;
+        if (myRoot < 0 || other.myRoot < 0)
+            return ret;
+        std::vector<std::pair<int, int>> stack{std::make_pair(myRoot, other.myRoot)};
+        while (stack.size())
+        {
+            auto np = stack.back();
+            stack.pop_back();
+            const sNode &a = myNode[np.first];
+            const sNode &b = other.myNode[np.second];
+            if (!overlap(a.min, a.max, b.min, b.max))
+                continue;
+            if (a.leaf && b.leaf)
+            {
+                for (int i = a.first; i < a.first + a.count; i++)
+                {
+                    int ci = myChild[i];
+                    cxy mn1, mx1;
+                    box(ci, mn1, mx1);
+                    for (int j = b.first; j < b.first + b.count; j++)
+                    {
+                        int cj = other.myChild[j];
+                        cxy mn2, mx2;
+                        other.box(cj, mn2, mx2);
+                        if (overlap(mn1, mx1, mn2, mx2) &&
+                            isIntersection(ci, other.mySegment[cj]))
+                            ret.push_back(std::make_pair(ci, cj));
+                    }
+                }
+            }
+            else if (b.leaf || (!a.leaf && area(a) >= area(b)))
+            {
+                // descend this tree
+                for (int i = a.first; i < a.first + a.count; i++)
+                    stack.push_back(std::make_pair(myChild[i], np.second));
+            }
+            else
+            {
+                for (int j = b.first; j < b.first + b.count; j++)
+                    stack.push_back(std::make_pair(np.first, other.myChild[j]));
+            }
+        }
+        return ret;
+    }
+
+    /// number of levels, 0 if empty
+    int height() const
+    {
+        if (myRoot < 0)
+            return 0;
+        int h = 1;
+        for (int n = myRoot; !myNode[n].leaf; n = myChild[myNode[n].first])
+            h++;
+        return h;
+    }
+
+private:
+    struct sNode
+    {
+        cxy min, max; // bounding box of children
+        int first;    // index of first child in myChild
+        int count;    // number of children
+        bool leaf;    // children are segment ids, otherwise node indices
+    };
+    struct sEntry
+    {
+        cxy min, max;
+        int id;
+    };
+
+    std::vector<sNode> myNode;
+    std::vector<int> myChild;
+    int myRoot;
+
+    static double area(const sNode &n)
+    {
+        return (n.max.x - n.min.x) * (n.max.y - n.min.y);
+    }
+
+    /** pack one level of entries into nodes, Sort-Tile-Recursive
+    @param[in] level entries to pack
+    @param[in] M node capacity
+    @param[in] leaf true if entries are segments
+    @return entries for the nodes created
+    */
+    std::vector<sEntry> pack(
+        std::vector<sEntry> &level,
+        int M,
+        bool leaf)
+    {
+        int n = (int)level.size();
+        int nodeCount = (n + M - 1) / M;
+        int sliceCount = (int)ceil(sqrt((double)nodeCount));
+        int sliceSize = sliceCount * M;
+
+        auto cx = [](const sEntry &e)
+        { return e.min.x + e.max.x; };
+        auto cy = [](const sEntry &e)
+        { return e.min.y + e.max.y; };
+
+        // vertical slices by x, then runs of M by y within each slice
+        std::sort(level.begin(), level.end(),
+                  [&](const sEntry &a, const sEntry &b)
+                  { return cx(a) < cx(b); });
+        for (int s = 0; s < n; s += sliceSize)
+            std::sort(level.begin() + s, level.begin() + std::min(n, s + sliceSize),
+                      [&](const sEntry &a, const sEntry &b)
+                      { return cy(a) < cy(b); });
+
+        std::vector<sEntry> parent;
+        for (int s = 0; s < n; s += sliceSize)
+        {
+            int sliceEnd = std::min(n, s + sliceSize);
+            for (int f = s; f < sliceEnd; f += M)
+            {
+                sNode node;
+                node.first = (int)myChild.size();
+                node.count = std::min(M, sliceEnd - f);
+                node.leaf = leaf;
+                node.min = cxy(DBL_MAX, DBL_MAX);
+                node.max = cxy(-DBL_MAX, -DBL_MAX);
+                for (int k = f; k < f + node.count; k++)
+                {
+                    myChild.push_back(level[k].id);
+                    node.min.x = std::min(node.min.x, level[k].min.x);
+                    node.min.y = std::min(node.min.y, level[k].min.y);
+                    node.max.x = std::max(node.max.x, level[k].max.x);
+                    node.max.y = std::max(node.max.y, level[k].max.y);
+                }
+                sEntry e;
+                e.min = node.min;
+                e.max = node.max;
+                e.id = (int)myNode.size();
+                myNode.push_back(node);
+                parent.push_back(e);
+            }
+        }
+        return parent;
+    }
+};
+
+/// a crossing of two segments
+struct sSegmentCrossing
+{
+    int first;  ///< segment id, the lower
+    int second; ///< segment id, the higher
+    cxy p;      ///< point of intersection
+};
+
+/** @brief All crossings among a set of segments, Bentley-Ottmann plane sweep
+
+A line sweeps from left to right.
+The segments it cuts are kept in a set ordered by y where they cut it,
+and the events where that order changes, segment ends and crossings,
+are kept in a queue ordered by x.
+Only segments that become neighbours in the set are tested,
+so the cost is O( ( n + k ) log n ) for n segments and k crossings.
+
+The exact test is cxy::isIntersection, given each pair lower id first,
+so the result is the same as testing every pair i < j in that order:
+segments that touch at an end point cross,
+collinear or parallel segments never cross, and zero length segments never cross.
+
+Degenerate cases
+- several segments through one point: all their pairs are tested when the sweep reaches the point
+- end points on another segment: every segment through the end point is tested
+- vertical segments: not kept in the set, tested against the range of the set they span
+
+<pre>
+    for( auto& c : cSegmentSweep::crossings( segments ) )
+        std::cout << c.first << " crosses " << c.second << " at " << c.p << "\n";
+</pre>
+*/
+class cSegmentSweep
+{
+public:
+    /** find crossings
+    @param[in] segments
+    @return crossings, sorted by first then second segment id
+    */
+    static std::vector<sSegmentCrossing> crossings(
+        const std::vector<cxySegment> &segments)
+    {
+        cSegmentSweep S(segments);
+        S.sweep();
+
+        // a pair can be neighbours more than once
+        auto &ret = S.myCrossing;
+        std::sort(ret.begin(), ret.end(),
+                  [](const sSegmentCrossing &a, const sSegmentCrossing &b)
+                  {
+                      return a.first < b.first ||
+                             (a.first == b.first && a.second < b.second);
+                  });
+        ret.erase(
+            std::unique(ret.begin(), ret.end(),
+                        [](const sSegmentCrossing &a, const sSegmentCrossing &b)
+                        {
+                            return a.first == b.first && a.second == b.second;
+                        }),
+            ret.end());
+        return ret;
+    }
+
+private:
+    /// at one point, crossings come before starts, so a start is placed among segments already reordered
+    enum class eEvent
+    {
+        cross,
+        start,
+        vertical,
+        end
+    };
+    struct sEvent
+    {
+        double x;
+        int phase; // at one x: starts and crossings, then verticals, then ends
+        double y;
+        eEvent type;
+        int a, b; // segment ids
+    };
+    struct sLater
+    {
+        bool operator()(const sEvent &e1, const sEvent &e2) const
+        {
+            if (e1.x != e2.x)
+                return e1.x > e2.x;
+            if (e1.phase != e2.phase)
+                return e1.phase > e2.phase;
+            if (e1.y != e2.y)
+                return e1.y > e2.y;
+            return e1.type > e2.type;
+        }
+    };
+
+    /// entry in the sweep line status, id changes when neighbours cross
+    struct sStatus
+    {
+        mutable int id;
+    };
+    /// order of segments along the sweep line, lower y first
+    struct sBelow
+    {
+        typedef void is_transparent;
+        const cSegmentSweep *S;
+        bool operator()(const sStatus &a, const sStatus &b) const
+        {
+            return S->below(a.id, b.id);
+        }
+        bool operator()(const sStatus &a, double y) const
+        {
+            return S->yAt(a.id) < y;
+        }
+        bool operator()(double y, const sStatus &b) const
+        {
+            return y < S->yAt(b.id);
+        }
+    };
+    typedef std::set<sStatus, sBelow> status_t;
+
+    const std::vector<cxySegment> &mySegment;
+    std::vector<cxy> myLeft, myRight; // end points, left to right
+    std::vector<double> mySlope;
+    std::vector<status_t::iterator> myPos; // place in status of segments cut by sweep line
+    std::vector<bool> myfCut;
+    status_t myStatus;
+    std::vector<sEvent> myEnds; // starts, ends and verticals, in order
+    std::priority_queue<sEvent, std::vector<sEvent>, sLater> myQueue; // crossings
+    double myX;   // sweep line
+    double myTol; // y difference treated as the same point
+    std::vector<sSegmentCrossing> myCrossing;
+
+    cSegmentSweep(const std::vector<cxySegment> &segments)
+        : mySegment(segments),
+          myStatus(sBelow{this}),
+          myX(-DBL_MAX)
+    {
+    }
+
+    double yAt(int id) const
+    {
+        const cxy &l = myLeft[id];
+        const cxy &r = myRight[id];
+        if (myX <= l.x)
+            return l.y;
+        if (myX >= r.x)
+            return r.y;
+        return l.y + (myX - l.x) * mySlope[id];
+    }
+
+    /// true if segment a is below b just to the right of the sweep line
+    bool below(int a, int b) const
+    {
+        double ya = yAt(a);
+        double yb = yAt(b);
+        if (fabs(ya - yb) > myTol)
+            return ya < yb;
+        if (mySlope[a] != mySlope[b])
+            return mySlope[a] < mySlope[b];
+        return a < b;
+    }
+
+    void sweep()
+    {
+        int n = (int)mySegment.size();
+        myLeft.resize(n);
+        myRight.resize(n);
+        mySlope.resize(n);
+        myPos.resize(n);
+        myfCut.resize(n, false);
+        double extent = 0;
+        for (int id = 0; id < n; id++)
+        {
+            const cxySegment &s = mySegment[id];
+            bool fFirst = s.first.x < s.second.x ||
+                          (s.first.x == s.second.x && s.first.y < s.second.y);
+            myLeft[id] = fFirst ? s.first : s.second;
+            myRight[id] = fFirst ? s.second : s.first;
+            extent = std::max(extent, std::max(
+                                          std::max(fabs(s.first.x), fabs(s.first.y)),
+                                          std::max(fabs(s.second.x), fabs(s.second.y))));
+            const cxy &l = myLeft[id];
+            const cxy &r = myRight[id];
+            if (l.x == r.x && l.y == r.y)
+                continue; // zero length never crosses
+            if (l.x == r.x)
+            {
+                myEnds.push_back(sEvent{l.x, 1, l.y, eEvent::vertical, id, -1});
+                continue;
+            }
+            mySlope[id] = (r.y - l.y) / (r.x - l.x);
+            myEnds.push_back(sEvent{l.x, 0, l.y, eEvent::start, id, -1});
+            myEnds.push_back(sEvent{r.x, 2, r.y, eEvent::end, id, -1});
+        }
+        myTol = 1e-9 * (1 + extent);
+        sLater later;
+        std::sort(myEnds.begin(), myEnds.end(),
+                  [&](const sEvent &e1, const sEvent &e2)
+                  { return later(e2, e1); });
+
+        auto next = myEnds.begin();
+        while (next != myEnds.end() || myQueue.size())
+        {
+            sEvent e;
+            if (next == myEnds.end() ||
+                (myQueue.size() && later(*next, myQueue.top())))
+            {
+                e = myQueue.top();
+                myQueue.pop();
+            }
+            else
+                e = *next++;
+            myX = e.x;
+            switch (e.type)
+            {
+            case eEvent::start:
+                start(e.a);
+                break;
+            case eEvent::cross:
+                cross(e.a, e.b);
+                break;
+            case eEvent::vertical:
+                vertical(e.a);
+                break;
+            case eEvent::end:
+                end(e.a);
+                break;
+            }
+        }
+    }
+
+    void start(int id)
+    {
+        // segments through the start point, whose crossing there was computed a little to the right
+        std::vector<status_t::iterator> run;
+        for (auto it = myStatus.lower_bound(myLeft[id].y - myTol);
+             it != myStatus.end() && yAt(it->id) <= myLeft[id].y + myTol;
+             it++)
+            run.push_back(it);
+        if (run.size() > 1)
+            reorder(run);
+
+        myPos[id] = myStatus.insert(sStatus{id}).first;
+        myfCut[id] = true;
+        neighbours(myPos[id], myLeft[id].y);
+    }
+
+    void end(int id)
+    {
+        auto it = myPos[id];
+        neighbours(it, myRight[id].y);
+        auto above = std::next(it);
+        bool fBelow = it != myStatus.begin();
+        auto below = it;
+        if (fBelow)
+            below--;
+        myStatus.erase(it);
+        myfCut[id] = false;
+        if (fBelow && above != myStatus.end())
+            check(below->id, above->id);
+    }
+
+    /// test the segments each side, and all others through the same point
+    void neighbours(status_t::iterator it, double y)
+    {
+        for (auto j = it; j != myStatus.begin();)
+        {
+            j--;
+            check(j->id, it->id);
+            if (fabs(yAt(j->id) - y) > myTol)
+                break;
+        }
+        for (auto j = std::next(it); j != myStatus.end(); j++)
+        {
+            check(it->id, j->id);
+            if (fabs(yAt(j->id) - y) > myTol)
+                break;
+        }
+    }
+
+    /// reverse the order of the segments through a crossing
+    void cross(int a, int b)
+    {
+        if (!myfCut[a] || !myfCut[b])
+            return;
+        std::vector<status_t::iterator> run;
+        if (!between(myPos[a], myPos[b], run) &&
+            !between(myPos[b], myPos[a], run))
+            return;
+        reorder(run);
+    }
+
+    /// order segments through one point as they are right of it, by slope
+    void reorder(const std::vector<status_t::iterator> &run)
+    {
+        std::vector<int> ids;
+        for (auto it : run)
+            ids.push_back(it->id);
+        auto bySlope = [&](int i, int j)
+        {
+            return mySlope[i] < mySlope[j] ||
+                   (mySlope[i] == mySlope[j] && i < j);
+        };
+        if (std::is_sorted(ids.begin(), ids.end(), bySlope))
+            return; // already crossed, through another pair at the same point
+        std::sort(ids.begin(), ids.end(), bySlope);
+        for (int k = 0; k < (int)run.size(); k++)
+        {
+            run[k]->id = ids[k];
+            myPos[ids[k]] = run[k];
+        }
+
+        for (int i = 0; i < (int)ids.size(); i++)
+            for (int j = i + 1; j < (int)ids.size(); j++)
+                check(ids[i], ids[j]);
+        if (run.front() != myStatus.begin())
+            check(std::prev(run.front())->id, ids.front());
+        auto above = std::next(run.back());
+        if (above != myStatus.end())
+            check(ids.back(), above->id);
+    }
+
+    /// the segments from one to another, if all are at the same y on the sweep line
+    bool between(
+        status_t::iterator from, status_t::iterator to,
+        std::vector<status_t::iterator> &run)
+    {
+        double lo = std::min(yAt(from->id), yAt(to->id)) - myTol;
+        double hi = std::max(yAt(from->id), yAt(to->id)) + myTol;
+        run.clear();
+        for (auto it = from; it != myStatus.end(); it++)
+        {
+            double y = yAt(it->id);
+            if (y < lo || y > hi)
+                return false;
+            run.push_back(it);
+            if (it == to)
+                return true;
+        }
+        return false;
+    }
+
+    /// test against every segment the vertical spans
+    void vertical(int id)
+    {
+        double y1 = myLeft[id].y;
+        double y2 = myRight[id].y;
+        for (auto it = myStatus.lower_bound(y1 - myTol);
+             it != myStatus.end() && yAt(it->id) <= y2 + myTol;
+             it++)
+            test(id, it->id);
+    }
+
+    /** test two segments that are neighbours on the sweep line, and schedule their crossing
+    @param[in] a segment below
+    @param[in] b segment above
+    */
+    void check(int a, int b)
+    {
+        test(a, b);
+
+        // where the order changes, found without the tolerance of the exact test.
+        // Only while they converge, once crossed they diverge
+        if (mySlope[a] <= mySlope[b])
+            return;
+        const cxy &p = myLeft[a];
+        const cxy &q = myLeft[b];
+        double rx = myRight[a].x - p.x, ry = myRight[a].y - p.y;
+        double sx = myRight[b].x - q.x, sy = myRight[b].y - q.y;
+        double d = rx * sy - ry * sx;
+        if (d == 0)
+            return;
+        double qx = q.x - p.x, qy = q.y - p.y;
+        double t = (qx * sy - qy * sx) / d;
+        double u = (qx * ry - qy * rx) / d;
+        if (t < 0 || t > 1 || u < 0 || u > 1)
+            return;
+        myQueue.push(sEvent{
+            std::max(myX, p.x + t * rx), 0, p.y + t * ry,
+            eEvent::cross, a, b});
+    }
+
+    /// exact test, lower id first as when testing every pair
+    void test(int a, int b)
+    {
+        if (a == b)
+            return;
+        sSegmentCrossing c;
+        c.first = std::min(a, b);
+        c.second = std::max(a, b);
+        const cxySegment &s1 = mySegment[c.first];
+        const cxySegment &s2 = mySegment[c.second];
+        if (cxy::isIntersection(c.p, s1.first, s1.second, s2.first, s2.second))
+            myCrossing.push_back(c);
+    }
+};
@@ -0,0 +1,316 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <queue>
+#include <algorithm>
+#include "cxy.h"
+
+/** @brief Convex hull and simplification of large point sets and polylines
+
+- convexHull(): Andrew's monotone chain, O( n log n )
+- rdp(): Ramer-Douglas-Peucker simplification, error bound is a distance
+- visvalingam(): Visvalingam-Whyatt simplification, error bound is an area
+
+Each takes a thread count: 1 runs on the calling thread,
+0 uses one thread per core.  Inputs smaller than about 64K points
+are always processed on the calling thread.
+
+The results are vectors of cxy that can be passed straight to the windex
+shapes::polygon() and shapes::polyLine() drawing methods.
+
+<pre>
+    auto hull = cPointReduce::convexHull( cloud );
+    auto track = cPointReduce::rdp( gpsTrack, 0.5 );
+    S.polyLine( track );
+    S.polygon( hull );
+</pre>
+*/
+class cPointReduce
+{
+public:
+    /** convex hull
+    @param[in] points
+    @param[in] tolerance 0 for the exact hull,
+        otherwise every point is within this distance of the returned hull
+    @param[in] threads
+    @return hull vertices, counter clockwise when y is up, no collinear vertices
+
+    With a tolerance the points are first reduced to the lowest and highest
+    in each vertical strip of that width ( Bentley-Faust-Preparata ),
+    which is O( n ) and much faster for dense clouds.
+    */
+    static std::vector<cxy> convexHull(
+        const std::vector<cxy> &points,
+        double tolerance = 0,
+        int threads = 1)
+    {
+        int n = (int)points.size();
+        int chunks = chunkCount(n, threads);
+        if (chunks == 1)
+            return hull(reduce(points.data(), n, tolerance));
+
+        // hull of each chunk, then hull of the chunk hull vertices
+        std::vector<std::vector<cxy>> part(chunks);
+        run(chunks, [&](int c)
+            {
+                int first = (int)((long long)n * c / chunks);
+                int last = (int)((long long)n * (c + 1) / chunks);
+                part[c] = hull(reduce(points.data() + first, last - first, tolerance)); });
+        std::vector<cxy> merged;
+        for (auto &p : part)
+            merged.insert(merged.end(), p.begin(), p.end());
+        return hull(merged);
+    }
+
+    /** Ramer-Douglas-Peucker simplification of a polyline
+    @param[in] polyline
+    @param[in] tolerance maximum distance of a removed point from the simplified line
+    @param[in] threads
+    @return simplified polyline, keeps first and last points
+
+    In parallel the polyline is cut into pieces which are simplified separately,
+    so the cut points are kept and the result can differ slightly from the serial result.
+    The tolerance is respected either way.
+    */
+    static std::vector<cxy> rdp(
+        const std::vector<cxy> &polyline,
+        double tolerance,
+        int threads = 1)
+    {
+        return piecewise(polyline, threads,
+                         [tolerance](const cxy *p, int n, std::vector<bool> &keep)
+                         { rdpMark(p, n, tolerance, keep); });
+    }
+
+    /** Visvalingam-Whyatt simplification of a polyline
+    @param[in] polyline
+    @param[in] minArea points are removed, smallest first, while the triangle
+        each forms with its neighbours is smaller than this
+    @param[in] threads
+    @return simplified polyline, keeps first and last points
+
+    Visvalingam removes small wiggles before long thin spikes,
+    which often looks better than RDP for coastlines and tracks.
+    In parallel the cut points are kept, as for rdp().
+    */
+    static std::vector<cxy> visvalingam(
+        const std::vector<cxy> &polyline,
+        double minArea,
+        int threads = 1)
+    {
+        return piecewise(polyline, threads,
+                         [minArea](const cxy *p, int n, std::vector<bool> &keep)
+                         { visvalingamMark(p, n, minArea, keep); });
+    }
+
+private:
+    static int chunkCount(int n, int threads)
+    {
+        const int minChunk = 65536;
+        if (threads <= 0)
+            threads = std::max(1, (int)std::thread::hardware_concurrency());
+        return std::max(1, std::min(threads, n / minChunk));
+    }
+
+    /// run f( 0 ) to f( count-1 ), each on its own thread
+    template <class F>
+    static void run(int count, F f)
+    {
+        std::vector<std::thread> pool;
+        for (int k = 1; k < count; k++)
+            pool.emplace_back(f, k);
+        f(0);
+        for (auto &t : pool)
+            t.join();
+    }
+
+    static double cross(const cxy &o, const cxy &a, const cxy &b)
+    {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    }
+
+    /// monotone chain
+    static std::vector<cxy> hull(std::vector<cxy> p)
+    {
+        std::sort(p.begin(), p.end(),
+                  [](const cxy &a, const cxy &b)
+                  { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+        p.erase(std::unique(p.begin(), p.end()), p.end());
+        int n = (int)p.size();
+        if (n < 3)
+            return p;
+        std::vector<cxy> h(2 * n);
+        int k = 0;
+        for (int i = 0; i < n; i++)
+        {
+            while (k >= 2 && cross(h[k - 2], h[k - 1], p[i]) <= 0)
+                k--;
+            h[k++] = p[i];
+        }
+        for (int i = n - 2, t = k + 1; i >= 0; i--)
+        {
+            while (k >= t && cross(h[k - 2], h[k - 1], p[i]) <= 0)
+                k--;
+            h[k++] = p[i];
+        }
+        h.resize(k - 1);
+        return h;
+    }
+
+    /// points that can be on the hull, within tolerance
+    static std::vector<cxy> reduce(const cxy *p, int n, double tolerance)
+    {
+        if (tolerance <= 0 || n < 3)
+            return std::vector<cxy>(p, p + n);
+        double minx = p[0].x, maxx = p[0].x;
+        for (int k = 1; k < n; k++)
+        {
+            minx = std::min(minx, p[k].x);
+            maxx = std::max(maxx, p[k].x);
+        }
+        int strips = (int)std::min((double)n, (maxx - minx) / tolerance) + 1;
+        double width = (maxx - minx) / strips;
+        if (width <= 0)
+            width = 1;
+        std::vector<int> lo(strips, -1), hi(strips, -1);
+        int left = 0, right = 0;
+        for (int k = 0; k < n; k++)
+        {
+            int s = std::min(strips - 1, (int)((p[k].x - minx) / width));
+            if (lo[s] < 0 || p[k].y < p[lo[s]].y)
+                lo[s] = k;
+            if (hi[s] < 0 || p[k].y > p[hi[s]].y)
+                hi[s] = k;
+            if (p[k].x < p[left].x)
+                left = k;
+            if (p[k].x > p[right].x)
+                right = k;
+        }
+        std::vector<cxy> ret{p[left], p[right]};
+        for (int s = 0; s < strips; s++)
+            if (lo[s] >= 0)
+            {
+                ret.push_back(p[lo[s]]);
+                ret.push_back(p[hi[s]]);
+            }
+        return ret;
+    }
+
+    /// simplify pieces of a polyline, in parallel
+    template <class F>
+    static std::vector<cxy> piecewise(
+        const std::vector<cxy> &polyline,
+        int threads,
+        F mark)
+    {
+        int n = (int)polyline.size();
+        if (n < 3)
+            return polyline;
+        int chunks = chunkCount(n, threads);
+
+        // pieces share their end points
+        std::vector<bool> keep(n, false);
+        std::vector<std::vector<bool>> part(chunks);
+        run(chunks, [&](int c)
+            {
+                int first = (int)((long long)(n - 1) * c / chunks);
+                int last = (int)((long long)(n - 1) * (c + 1) / chunks);
+                mark(polyline.data() + first, last - first + 1, part[c]); });
+        for (int c = 0; c < chunks; c++)
+        {
+            int first = (int)((long long)(n - 1) * c / chunks);
+            for (int k = 0; k < (int)part[c].size(); k++)
+                if (part[c][k])
+                    keep[first + k] = true;
+        }
+
+        std::vector<cxy> ret;
+        for (int k = 0; k < n; k++)
+            if (keep[k])
+                ret.push_back(polyline[k]);
+        return ret;
+    }
+
+    static double dist2(const cxy &p, const cxy &a, const cxy &b)
+    {
+        if (a == b)
+            return p.dist2(a);
+        return p.dis2toline(a, b);
+    }
+
+    static void rdpMark(const cxy *p, int n, double tolerance, std::vector<bool> &keep)
+    {
+        keep.assign(n, false);
+        keep[0] = keep[n - 1] = true;
+        double tol2 = tolerance * tolerance;
+        std::vector<std::pair<int, int>> stack{std::make_pair(0, n - 1)};
+        while (stack.size())
+        {
+            int first = stack.back().first;
+            int last = stack.back().second;
+            stack.pop_back();
+            double worst = -1;
+            int index = -1;
+            for (int k = first + 1; k < last; k++)
+            {
+                double d2 = dist2(p[k], p[first], p[last]);
+                if (d2 > worst)
+                {
+                    worst = d2;
+                    index = k;
+                }
+            }
+            if (index < 0 || worst <= tol2)
+                continue;
+            keep[index] = true;
+            stack.push_back(std::make_pair(first, index));
+            stack.push_back(std::make_pair(index, last));
+        }
+    }
+
+    static void visvalingamMark(const cxy *p, int n, double minArea, std::vector<bool> &keep)
+    {
+        keep.assign(n, true);
+        std::vector<int> prev(n), next(n);
+        std::vector<double> area(n, 0);
+        for (int k = 0; k < n; k++)
+        {
+            prev[k] = k - 1;
+            next[k] = k + 1;
+        }
+        auto triangle = [&](int k)
+        {
+            return fabs(cross(p[prev[k]], p[k], p[next[k]])) / 2;
+        };
+
+        // smallest area on top, stale entries skipped
+        typedef std::pair<double, int> entry_t;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> heap;
+        for (int k = 1; k < n - 1; k++)
+        {
+            area[k] = triangle(k);
+            heap.push(std::make_pair(area[k], k));
+        }
+        while (heap.size())
+        {
+            entry_t e = heap.top();
+            heap.pop();
+            int k = e.second;
+            if (!keep[k] || e.first != area[k])
+                continue;
+            if (e.first >= minArea)
+                break;
+            keep[k] = false;
+            next[prev[k]] = next[k];
+            prev[next[k]] = prev[k];
+            for (int nb : {prev[k], next[k]})
+            {
+                if (nb <= 0 || nb >= n - 1)
+                    continue;
+                // a neighbour never becomes cheaper to remove than the point just removed
+                area[nb] = std::max(triangle(nb), e.first);
+                heap.push(std::make_pair(area[nb], nb));
+            }
+        }
+    }
+};
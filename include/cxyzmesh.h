@@ -0,0 +1,411 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include "cxy.h"
+
+/// where a segment first meets a mesh
+struct sMeshHit
+{
+    int triangle; ///< index of triangle hit, -1 if none
+    double t;     ///< fraction along segment from first end ( point = a + t * ( b - a ) )
+    cxyz p;       ///< point of intersection, invalid if none
+};
+
+/** @brief Triangle mesh with a bounding volume hierarchy, for segment intersection
+
+The triangles are sorted into a tree of boxes when the mesh is built,
+so a segment is tested only against the triangles in the boxes it passes through.
+
+Segments are tested in packets of four that traverse the tree together.
+The triangle test is Moller-Trumbore, run on the four segments at once
+with AVX2 when compiled with it enabled ( e.g. -mavx2 ).
+
+Finds the same points as cxyz::intersectLineTriangle,
+except possibly for segments within rounding distance of a triangle edge.
+
+<pre>
+    cxyzMesh terrain( vertices, triangles );
+
+    // line of sight from observer to each target
+    std::vector< std::pair< cxyz, cxyz > > sight;
+    for( auto& target : targets )
+        sight.push_back( std::make_pair( observer, target ) );
+    std::vector< sMeshHit > hits;
+    terrain.intersect( sight, hits );
+    for( int k = 0; k < hits.size(); k++ )
+        if( hits[k].triangle >= 0 )
+            std::cout << "target " << k << " hidden at " << hits[k].p.x << "\n";
+</pre>
+*/
+class cxyzMesh
+{
+public:
+    /** CTOR
+    @param[in] vertices
+    @param[in] triangles vertex indices of each triangle
+    @param[in] leafSize maximum triangles in a leaf box
+    */
+    cxyzMesh(
+        const std::vector<cxyz> &vertices,
+        const std::vector<std::array<int, 3>> &triangles,
+        int leafSize = 4)
+        : myLeafSize(std::max(1, leafSize))
+    {
+        int n = (int)triangles.size();
+        std::vector<sBuild> build(n);
+        for (int k = 0; k < n; k++)
+        {
+            sBuild &b = build[k];
+            b.id = k;
+            for (int a = 0; a < 3; a++)
+            {
+                b.min[a] = DBL_MAX;
+                b.max[a] = -DBL_MAX;
+            }
+            for (int v : triangles[k])
+            {
+                const double c[3] = {vertices[v].x, vertices[v].y, vertices[v].z};
+                for (int a = 0; a < 3; a++)
+                {
+                    b.min[a] = std::min(b.min[a], c[a]);
+                    b.max[a] = std::max(b.max[a], c[a]);
+                }
+            }
+            for (int a = 0; a < 3; a++)
+                b.centre[a] = b.min[a] + b.max[a];
+        }
+        if (n)
+            split(build, 0, n);
+
+        // triangles in leaf order, structure of arrays
+        myTriangle.resize(n);
+        for (auto *v : {&myV0x, &myV0y, &myV0z, &myE1x, &myE1y, &myE1z, &myE2x, &myE2y, &myE2z})
+            v->resize(n);
+        for (int k = 0; k < n; k++)
+        {
+            int id = build[k].id;
+            myTriangle[k] = id;
+            const cxyz &p0 = vertices[triangles[id][0]];
+            cxyz e1 = p0.vect(vertices[triangles[id][1]]);
+            cxyz e2 = p0.vect(vertices[triangles[id][2]]);
+            myV0x[k] = p0.x;
+            myV0y[k] = p0.y;
+            myV0z[k] = p0.z;
+            myE1x[k] = e1.x;
+            myE1y[k] = e1.y;
+            myE1z[k] = e1.z;
+            myE2x[k] = e2.x;
+            myE2y[k] = e2.y;
+            myE2z[k] = e2.z;
+        }
+    }
+
+    int triangleCount() const
+    {
+        return (int)myTriangle.size();
+    }
+
+    /** first intersection of segment with mesh
+    @param[in] a segment end, where the search starts
+    @param[in] b segment end
+    @return the triangle hit nearest a
+    */
+    sMeshHit intersect(const cxyz &a, const cxyz &b) const
+    {
+        sPacket packet;
+        load(packet, &a, &b, 1);
+        trace(packet);
+        sMeshHit hit;
+        result(packet, 0, hit);
+        return hit;
+    }
+
+    /** first intersections of many segments with mesh
+    @param[in] segments pairs of segment ends, search starts from first
+    @param[out] hits one for each segment
+
+    Neighbouring segments that pass close to each other,
+    e.g. lines of sight from one observer, are traced together
+    so order them that way for best performance.
+    */
+    void intersect(
+        const std::vector<std::pair<cxyz, cxyz>> &segments,
+        std::vector<sMeshHit> &hits) const
+    {
+        int n = (int)segments.size();
+        hits.resize(n);
+        for (int first = 0; first < n; first += 4)
+        {
+            int count = std::min(4, n - first);
+            cxyz a[4], b[4];
+            for (int k = 0; k < count; k++)
+            {
+                a[k] = segments[first + k].first;
+                b[k] = segments[first + k].second;
+            }
+            sPacket packet;
+            load(packet, a, b, count);
+            trace(packet);
+            for (int k = 0; k < count; k++)
+                result(packet, k, hits[first + k]);
+        }
+    }
+
+private:
+    /* tree node
+    A leaf holds triangles first to first + count - 1.
+    An internal node has count 0, children at the next index and at first.
+    */
+    struct sNode
+    {
+        double min[3];
+        double max[3];
+        int first;
+        int count;
+    };
+    struct sBuild
+    {
+        double min[3], max[3], centre[3];
+        int id;
+    };
+
+    // four segments traced together, unused lanes have t -1
+    struct sPacket
+    {
+        alignas(32) double ox[4], oy[4], oz[4];
+        alignas(32) double dx[4], dy[4], dz[4];
+        alignas(32) double t[4]; // nearest hit so far, starts at 1, the segment end
+        int triangle[4];
+    };
+
+    int myLeafSize;
+    std::vector<sNode> myNode;
+    std::vector<int> myTriangle; // original index of triangles, in leaf order
+    std::vector<double> myV0x, myV0y, myV0z;
+    std::vector<double> myE1x, myE1y, myE1z;
+    std::vector<double> myE2x, myE2y, myE2z;
+
+    /// build tree node over build[first .. last-1], median split on longest axis
+    int split(std::vector<sBuild> &build, int first, int last)
+    {
+        int index = (int)myNode.size();
+        myNode.push_back(sNode());
+        sNode node;
+        double cmin[3], cmax[3];
+        for (int a = 0; a < 3; a++)
+        {
+            node.min[a] = cmin[a] = DBL_MAX;
+            node.max[a] = cmax[a] = -DBL_MAX;
+        }
+        for (int k = first; k < last; k++)
+            for (int a = 0; a < 3; a++)
+            {
+                node.min[a] = std::min(node.min[a], build[k].min[a]);
+                node.max[a] = std::max(node.max[a], build[k].max[a]);
+                cmin[a] = std::min(cmin[a], build[k].centre[a]);
+                cmax[a] = std::max(cmax[a], build[k].centre[a]);
+            }
+
+        if (last - first <= myLeafSize)
+        {
+            node.first = first;
+            node.count = last - first;
+            myNode[index] = node;
+            return index;
+        }
+
+        int axis = 0;
+        for (int a = 1; a < 3; a++)
+            if (cmax[a] - cmin[a] > cmax[axis] - cmin[axis])
+                axis = a;
+        int mid = (first + last) / 2;
+        std::nth_element(
+            build.begin() + first, build.begin() + mid, build.begin() + last,
+            [axis](const sBuild &l, const sBuild &r)
+            { return l.centre[axis] < r.centre[axis]; });
+
+        split(build, first, mid);
+        node.first = split(build, mid, last);
+        node.count = 0;
+        myNode[index] = node;
+        return index;
+    }
+
+    static void load(sPacket &packet, const cxyz *a, const cxyz *b, int count)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            int s = k < count ? k : 0;
+            packet.ox[k] = a[s].x;
+            packet.oy[k] = a[s].y;
+            packet.oz[k] = a[s].z;
+            packet.dx[k] = b[s].x - a[s].x;
+            packet.dy[k] = b[s].y - a[s].y;
+            packet.dz[k] = b[s].z - a[s].z;
+            packet.t[k] = k < count ? 1 : -1;
+            packet.triangle[k] = -1;
+        }
+    }
+
+    void result(const sPacket &packet, int lane, sMeshHit &hit) const
+    {
+        hit.triangle = -1;
+        hit.t = 1;
+        hit.p = cxyz();
+        if (packet.triangle[lane] < 0)
+            return;
+        hit.triangle = myTriangle[packet.triangle[lane]];
+        hit.t = packet.t[lane];
+        hit.p = cxyz(
+            packet.ox[lane] + hit.t * packet.dx[lane],
+            packet.oy[lane] + hit.t * packet.dy[lane],
+            packet.oz[lane] + hit.t * packet.dz[lane]);
+    }
+
+    /// true if the segment in lane, up to its nearest hit so far, passes through the node box
+    static bool isBoxHit(const sPacket &packet, int lane, const sNode &node)
+    {
+        double tnear = 0, tfar = packet.t[lane];
+        if (tfar < 0)
+            return false;
+        const double o[3] = {packet.ox[lane], packet.oy[lane], packet.oz[lane]};
+        const double d[3] = {packet.dx[lane], packet.dy[lane], packet.dz[lane]};
+        for (int a = 0; a < 3; a++)
+        {
+            if (d[a] == 0)
+            {
+                if (o[a] < node.min[a] || o[a] > node.max[a])
+                    return false;
+                continue;
+            }
+            double t1 = (node.min[a] - o[a]) / d[a];
+            double t2 = (node.max[a] - o[a]) / d[a];
+            if (t1 > t2)
+                std::swap(t1, t2);
+            tnear = std::max(tnear, t1);
+            tfar = std::min(tfar, t2);
+            if (tnear > tfar)
+                return false;
+        }
+        return true;
+    }
+
+    void trace(sPacket &packet) const
+    {
+        if (!myNode.size())
+            return;
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top)
+        {
+            const sNode &node = myNode[stack[--top]];
+            bool fHit = false;
+            for (int lane = 0; lane < 4 && !fHit; lane++)
+                fHit = isBoxHit(packet, lane, node);
+            if (!fHit)
+                continue;
+            if (node.count)
+            {
+                for (int k = node.first; k < node.first + node.count; k++)
+                    triangle4(packet, k);
+            }
+            else
+            {
+                stack[top++] = node.first;
+                stack[top++] = (int)(&node - myNode.data()) + 1;
+            }
+        }
+    }
+
+    /// Moller-Trumbore test of one triangle against the four segments in a packet
+    void triangle4(sPacket &packet, int k) const
+    {
+#ifdef __AVX2__
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d one = _mm256_set1_pd(1);
+        __m256d ox = _mm256_load_pd(packet.ox);
+        __m256d oy = _mm256_load_pd(packet.oy);
+        __m256d oz = _mm256_load_pd(packet.oz);
+        __m256d dx = _mm256_load_pd(packet.dx);
+        __m256d dy = _mm256_load_pd(packet.dy);
+        __m256d dz = _mm256_load_pd(packet.dz);
+        __m256d tbest = _mm256_load_pd(packet.t);
+        __m256d e1x = _mm256_set1_pd(myE1x[k]);
+        __m256d e1y = _mm256_set1_pd(myE1y[k]);
+        __m256d e1z = _mm256_set1_pd(myE1z[k]);
+        __m256d e2x = _mm256_set1_pd(myE2x[k]);
+        __m256d e2y = _mm256_set1_pd(myE2y[k]);
+        __m256d e2z = _mm256_set1_pd(myE2z[k]);
+
+        // p = d x e2
+        __m256d px = _mm256_sub_pd(_mm256_mul_pd(dy, e2z), _mm256_mul_pd(dz, e2y));
+        __m256d py = _mm256_sub_pd(_mm256_mul_pd(dz, e2x), _mm256_mul_pd(dx, e2z));
+        __m256d pz = _mm256_sub_pd(_mm256_mul_pd(dx, e2y), _mm256_mul_pd(dy, e2x));
+        __m256d det = _mm256_add_pd(_mm256_mul_pd(e1x, px),
+                                    _mm256_add_pd(_mm256_mul_pd(e1y, py), _mm256_mul_pd(e1z, pz)));
+        __m256d inv = _mm256_div_pd(one, det);
+
+        // s = o - v0
+        __m256d sx = _mm256_sub_pd(ox, _mm256_set1_pd(myV0x[k]));
+        __m256d sy = _mm256_sub_pd(oy, _mm256_set1_pd(myV0y[k]));
+        __m256d sz = _mm256_sub_pd(oz, _mm256_set1_pd(myV0z[k]));
+        __m256d u = _mm256_mul_pd(inv,
+                                  _mm256_add_pd(_mm256_mul_pd(sx, px),
+                                                _mm256_add_pd(_mm256_mul_pd(sy, py), _mm256_mul_pd(sz, pz))));
+
+        // q = s x e1
+        __m256d qx = _mm256_sub_pd(_mm256_mul_pd(sy, e1z), _mm256_mul_pd(sz, e1y));
+        __m256d qy = _mm256_sub_pd(_mm256_mul_pd(sz, e1x), _mm256_mul_pd(sx, e1z));
+        __m256d qz = _mm256_sub_pd(_mm256_mul_pd(sx, e1y), _mm256_mul_pd(sy, e1x));
+        __m256d v = _mm256_mul_pd(inv,
+                                  _mm256_add_pd(_mm256_mul_pd(dx, qx),
+                                                _mm256_add_pd(_mm256_mul_pd(dy, qy), _mm256_mul_pd(dz, qz))));
+        __m256d t = _mm256_mul_pd(inv,
+                                  _mm256_add_pd(_mm256_mul_pd(e2x, qx),
+                                                _mm256_add_pd(_mm256_mul_pd(e2y, qy), _mm256_mul_pd(e2z, qz))));
+
+        __m256d mask = _mm256_cmp_pd(det, zero, _CMP_NEQ_OQ);
+        mask = _mm256_and_pd(mask, _mm256_cmp_pd(u, zero, _CMP_GE_OQ));
+        mask = _mm256_and_pd(mask, _mm256_cmp_pd(v, zero, _CMP_GE_OQ));
+        mask = _mm256_and_pd(mask, _mm256_cmp_pd(_mm256_add_pd(u, v), one, _CMP_LE_OQ));
+        mask = _mm256_and_pd(mask, _mm256_cmp_pd(t, zero, _CMP_GE_OQ));
+        mask = _mm256_and_pd(mask, _mm256_cmp_pd(t, tbest, _CMP_LE_OQ));
+        int bits = _mm256_movemask_pd(mask);
+        if (!bits)
+            return;
+        _mm256_store_pd(packet.t, _mm256_blendv_pd(tbest, t, mask));
+        for (int lane = 0; lane < 4; lane++)
+            if (bits & (1 << lane))
+                packet.triangle[lane] = k;
+#else
+        for (int lane = 0; lane < 4; lane++)
+        {
+            double dx = packet.dx[lane], dy = packet.dy[lane], dz = packet.dz[lane];
+            double px = dy * myE2z[k] - dz * myE2y[k];
+            double py = dz * myE2x[k] - dx * myE2z[k];
+            double pz = dx * myE2y[k] - dy * myE2x[k];
+            double det = myE1x[k] * px + myE1y[k] * py + myE1z[k] * pz;
+            if (det == 0)
+                continue;
+            double inv = 1 / det;
+            double sx = packet.ox[lane] - myV0x[k];
+            double sy = packet.oy[lane] - myV0y[k];
+            double sz = packet.oz[lane] - myV0z[k];
+            double u = inv * (sx * px + sy * py + sz * pz);
+            double qx = sy * myE1z[k] - sz * myE1y[k];
+            double qy = sz * myE1x[k] - sx * myE1z[k];
+            double qz = sx * myE1y[k] - sy * myE1x[k];
+            double v = inv * (dx * qx + dy * qy + dz * qz);
+            double t = inv * (myE2x[k] * qx + myE2y[k] * qy + myE2z[k] * qz);
+            if (u >= 0 && v >= 0 && u + v <= 1 && t >= 0 && t <= packet.t[lane])
+            {
+                packet.t[lane] = t;
+                packet.triangle[lane] = k;
+            }
+        }
+#endif
+    }
+};
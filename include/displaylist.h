@@ -0,0 +1,967 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include "cxy.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** @file displaylist.h
+
+Retained mode drawing: shapes calls recorded once, replayed on every paint.
+
+A displayList has the drawing methods of wex::shapes.
+Each call appends an opcode and its packed integer coordinates,
+so a recorded scene costs one replay instead of being regenerated.
+A list is replayed to anything with the shapes drawing methods:
+a wex::shapes on a window, or a displayRaster in memory.
+
+The list is divided into segments, which are recorded,
+invalidated and re-recorded independently,
+so the static part of a scene ( axes, labels, gauge face )
+is kept while the moving part is redrawn.
+
+<pre>
+    wex::displayList myScene;
+
+    form.events().draw([&](PAINTSTRUCT &ps)
+    {
+        wex::shapes S(ps);
+        if (!myScene.isValid(0))
+        {
+            // record the static part, drawing it as it is recorded
+            myScene.segment(0);
+            S.record(&myScene);
+            drawAxes(S);
+            S.record(nullptr);
+        }
+        else
+            S.replay(myScene);
+        drawTrace(S);
+    });
+</pre>
+*/
+
+namespace wex
+{
+    /// Display list opcodes, one byte each
+    enum class eDrawOp : unsigned char
+    {
+        color,        ///< c
+        bgcolor,      ///< c
+        transparent,  ///< f
+        penThick,     ///< t
+        fill,         ///< f
+        textVertical, ///< f
+        textHeight,   ///< h
+        textFontName, ///< text index
+        pixel,        ///< x, y
+        line,         ///< x1, y1, x2, y2
+        segments,     ///< n, n times x1, y1, x2, y2
+        rectangle,    ///< left, top, width, height
+        polyLine,     ///< n, x0, y0, ... xn-1, yn-1
+        polygon,      ///< n, x0, y0, ... xn-1, yn-1
+        arc,          ///< x, y, r, sa, ea, r and angles in thousandths
+        circle,       ///< x, y, r
+        text,         ///< text index, n, n coords
+    };
+
+    /** Drawing calls recorded as opcodes with packed integer coordinates
+
+    Coordinates are pixels, as for wex::shapes.
+    Arc radius and angles are stored to a thousandth.
+    */
+    class displayList
+    {
+    public:
+        displayList()
+            : myCurrent(-1)
+        {
+        }
+
+        /** Start recording a segment
+        @param[in] id segment ID
+
+        Drawing already recorded in the segment is discarded.
+        A new segment is replayed after those already recorded.
+        */
+        void segment(int id)
+        {
+            myCurrent = find(id);
+            if (myCurrent < 0)
+            {
+                mySegment.emplace_back();
+                mySegment.back().myID = id;
+                myCurrent = (int)mySegment.size() - 1;
+            }
+            auto &s = mySegment[myCurrent];
+            s.myOp.clear();
+            s.myCoord.clear();
+            s.myText.clear();
+            s.myfValid = true;
+        }
+
+        /// true if segment is recorded and not invalidated
+        bool isValid(int id) const
+        {
+            int k = find(id);
+            return k >= 0 && mySegment[k].myfValid;
+        }
+
+        /// Mark segment for re-recording, it is not replayed until it is
+        void invalidate(int id)
+        {
+            int k = find(id);
+            if (k >= 0)
+                mySegment[k].myfValid = false;
+        }
+        /// Mark every segment for re-recording
+        void invalidate()
+        {
+            for (auto &s : mySegment)
+                s.myfValid = false;
+        }
+
+        /// Discard everything recorded
+        void clear()
+        {
+            mySegment.clear();
+            myCurrent = -1;
+        }
+
+        /// number of drawing calls recorded
+        int size() const
+        {
+            int n = 0;
+            for (auto &s : mySegment)
+                n += (int)s.myOp.size();
+            return n;
+        }
+        /// bytes used by opcodes and coordinates
+        int bytes() const
+        {
+            int n = 0;
+            for (auto &s : mySegment)
+            {
+                n += (int)(s.myOp.size() + s.myCoord.size() * sizeof(int));
+                for (auto &t : s.myText)
+                    n += (int)t.size();
+            }
+            return n;
+        }
+
+        // recording, same as the shapes methods
+
+        void color(int r, int g, int b)
+        {
+            color(r | (g << 8) | (b << 16));
+        }
+        void color(int c)
+        {
+            add(eDrawOp::color, {c});
+        }
+        void bgcolor(int c)
+        {
+            add(eDrawOp::bgcolor, {c});
+        }
+        void bgcolor(int r, int g, int b)
+        {
+            bgcolor(r | (g << 8) | (b << 16));
+        }
+        void transparent(bool f = true)
+        {
+            add(eDrawOp::transparent, {(int)f});
+        }
+        void penThick(int t)
+        {
+            add(eDrawOp::penThick, {t});
+        }
+        void fill(bool f = true)
+        {
+            add(eDrawOp::fill, {(int)f});
+        }
+        void pixel(int x, int y)
+        {
+            add(eDrawOp::pixel, {x, y});
+        }
+        void line(const std::vector<int> &v)
+        {
+            add(eDrawOp::line, {v[0], v[1], v[2], v[3]});
+        }
+        void line(const cxy &p1, const cxy &p2)
+        {
+            line({(int)p1.x, (int)p1.y,
+                  (int)p2.x, (int)p2.y});
+        }
+        /// @param[in] v x1, y1, x2, y2 of each segment
+        void segments(const std::vector<int> &v)
+        {
+            auto &s = current();
+            s.myOp.push_back((unsigned char)eDrawOp::segments);
+            s.myCoord.push_back((int)v.size() / 4);
+            s.myCoord.insert(s.myCoord.end(), v.begin(), v.begin() + v.size() / 4 * 4);
+        }
+        void polyLine(const std::vector<cxy> &v)
+        {
+            points(eDrawOp::polyLine, v);
+        }
+        void rectangle(const std::vector<int> &v)
+        {
+            add(eDrawOp::rectangle, {v[0], v[1], v[2], v[3]});
+        }
+        void rectangle(
+            const cxy &topleft,
+            const cxy &widthHeight)
+        {
+            rectangle(
+                {(int)topleft.x, (int)topleft.y,
+                 (int)widthHeight.x, (int)widthHeight.y});
+        }
+        /// @param[in] v x0,y0,x1,y1,...
+        void polygon(const std::vector<int> &v)
+        {
+            auto &s = current();
+            s.myOp.push_back((unsigned char)eDrawOp::polygon);
+            s.myCoord.push_back((int)v.size() / 2);
+            s.myCoord.insert(s.myCoord.end(), v.begin(), v.begin() + v.size() / 2 * 2);
+        }
+        void polygon(const std::vector<cxy> &v)
+        {
+            points(eDrawOp::polygon, v);
+        }
+        void arc(
+            int x, int y, double r,
+            double sa, double ea)
+        {
+            add(eDrawOp::arc, {x, y, milli(r), milli(sa), milli(ea)});
+        }
+        void circle(int x0, int y0, double r)
+        {
+            add(eDrawOp::circle, {x0, y0, (int)r});
+        }
+        /// @param[in] v left, top or left, top, width, height
+        void text(
+            const std::string &t,
+            const std::vector<int> &v)
+        {
+            auto &s = current();
+            s.myOp.push_back((unsigned char)eDrawOp::text);
+            s.myCoord.push_back((int)s.myText.size());
+            s.myCoord.push_back((int)v.size());
+            s.myCoord.insert(s.myCoord.end(), v.begin(), v.end());
+            s.myText.push_back(t);
+        }
+        void textxy(
+            const std::string &t,
+            const cxy &xy)
+        {
+            text(
+                t,
+                {(int)xy.x, (int)xy.y});
+        }
+        void textVertical(bool f = true)
+        {
+            add(eDrawOp::textVertical, {(int)f});
+        }
+        void textHeight(int h)
+        {
+            add(eDrawOp::textHeight, {h});
+        }
+        void textFontName(const std::string &fn)
+        {
+            auto &s = current();
+            s.myOp.push_back((unsigned char)eDrawOp::textFontName);
+            s.myCoord.push_back((int)s.myText.size());
+            s.myText.push_back(fn);
+        }
+
+        /** Replay recorded drawing
+        @param[in] target anything with the shapes drawing methods
+        @param[in] clip left, top, width, height.  Drawing entirely outside is skipped.
+            Omit to replay everything.
+        */
+        template <class T>
+        void replay(T &target, const std::vector<int> &clip = {}) const
+        {
+            sBox box = clip.size() == 4
+                           ? sBox{clip[0], clip[1], clip[0] + clip[2], clip[1] + clip[3]}
+                           : sBox::all();
+            visit(
+                [&](const sOp &op, const sState &st)
+                {
+                    if (op.isDraw() && !box.intersects(op.bounds(st)))
+                        return;
+                    play(target, op);
+                });
+        }
+
+        /** Area that draws differently in another list
+        @param[in] other list, e.g. this scene re-recorded after a change
+        @return left, top, width, height, empty if the lists draw the same.
+            Unclipped text changed has no known extent, so gives a very large area.
+
+        Only the drawing between the first and last differences is compared,
+        so invalidating the area returned and replaying the new list
+        updates the window.
+        */
+        std::vector<int> diff(const displayList &other) const
+        {
+            auto a = flatten();
+            auto b = other.flatten();
+            int na = (int)a.size(), nb = (int)b.size();
+            int first = 0;
+            while (first < na && first < nb && a[first] == b[first])
+                first++;
+            int last = 0;
+            while (last < na - first && last < nb - first &&
+                   a[na - 1 - last] == b[nb - 1 - last])
+                last++;
+            sBox changed = sBox::none();
+            for (int k = first; k < na - last; k++)
+                changed.add(a[k].myBox);
+            for (int k = first; k < nb - last; k++)
+                changed.add(b[k].myBox);
+            if (changed.isEmpty())
+                return {};
+            return {changed.left, changed.top,
+                    changed.right - changed.left, changed.bottom - changed.top};
+        }
+
+        /// left, top, width, height of everything drawn, empty if nothing
+        std::vector<int> bounds() const
+        {
+            sBox all = sBox::none();
+            for (auto &f : flatten())
+                all.add(f.myBox);
+            if (all.isEmpty())
+                return {};
+            return {all.left, all.top, all.right - all.left, all.bottom - all.top};
+        }
+
+    private:
+        struct sSegment
+        {
+            int myID;
+            bool myfValid;
+            std::vector<unsigned char> myOp;
+            std::vector<int> myCoord;
+            std::vector<std::string> myText;
+        };
+        std::vector<sSegment> mySegment;
+        int myCurrent; // segment being recorded
+
+        /// box, right and bottom exclusive
+        struct sBox
+        {
+            int left, top, right, bottom;
+
+            static sBox none()
+            {
+                return {INT_MAX, INT_MAX, INT_MIN, INT_MIN};
+            }
+            static sBox all()
+            {
+                return {INT_MIN / 4, INT_MIN / 4, INT_MAX / 4, INT_MAX / 4};
+            }
+            bool isEmpty() const
+            {
+                return left >= right || top >= bottom;
+            }
+            void add(const sBox &b)
+            {
+                if (b.isEmpty())
+                    return;
+                left = std::min(left, b.left);
+                top = std::min(top, b.top);
+                right = std::max(right, b.right);
+                bottom = std::max(bottom, b.bottom);
+            }
+            bool intersects(const sBox &b) const
+            {
+                return b.left < right && left < b.right && b.top < bottom && top < b.bottom;
+            }
+        };
+
+        /// drawing state when an op is replayed
+        struct sState
+        {
+            int color, bgcolor, transparent, penThick, fill, textVertical, textHeight;
+            const std::string *font;
+
+            bool operator==(const sState &o) const
+            {
+                return color == o.color && bgcolor == o.bgcolor &&
+                       transparent == o.transparent && penThick == o.penThick &&
+                       fill == o.fill && textVertical == o.textVertical &&
+                       textHeight == o.textHeight &&
+                       (font == o.font || (font && o.font && *font == *o.font));
+            }
+        };
+
+        /// one decoded op
+        struct sOp
+        {
+            eDrawOp op;
+            const int *c; // coordinates
+            int n;        // coordinate count
+            const std::string *text;
+
+            bool isDraw() const
+            {
+                return op >= eDrawOp::pixel;
+            }
+
+            /// pixels the op can touch, empty for state changes
+            sBox bounds(const sState &st) const
+            {
+                sBox b = sBox::none();
+                auto point = [&](int x, int y)
+                {
+                    b.add({x, y, x + 1, y + 1});
+                };
+                switch (op)
+                {
+                case eDrawOp::pixel:
+                    point(c[0], c[1]);
+                    return b;
+                case eDrawOp::line:
+                    point(c[0], c[1]);
+                    point(c[2], c[3]);
+                    break;
+                case eDrawOp::rectangle:
+                    point(c[0], c[1]);
+                    point(c[0] + c[2], c[1] + c[3]);
+                    break;
+                case eDrawOp::segments:
+                    for (int k = 0; k < 2 * c[0]; k++)
+                        point(c[1 + 2 * k], c[2 + 2 * k]);
+                    break;
+                case eDrawOp::polyLine:
+                case eDrawOp::polygon:
+                    for (int k = 0; k < c[0]; k++)
+                        point(c[1 + 2 * k], c[2 + 2 * k]);
+                    break;
+                case eDrawOp::arc:
+                case eDrawOp::circle:
+                {
+                    int r = op == eDrawOp::arc ? (c[2] + 999) / 1000 : c[2];
+                    point(c[0] - r, c[1] - r);
+                    point(c[0] + r, c[1] + r);
+                    break;
+                }
+                case eDrawOp::text:
+                    if (c[1] != 4 || st.textVertical)
+                        return sBox::all(); // extent unknown
+                    point(c[2], c[3]);
+                    point(c[2] + c[4], c[3] + c[5]);
+                    return b;
+                default:
+                    return b;
+                }
+                if (b.isEmpty())
+                    return b;
+                // allow for pen thickness
+                int t = std::max(1, st.penThick);
+                return {b.left - t, b.top - t, b.right + t, b.bottom + t};
+            }
+        };
+
+        /// op with everything that decides how it draws, for diff
+        struct sFlat
+        {
+            sOp myOp;
+            sState myState;
+            sBox myBox;
+
+            bool operator==(const sFlat &o) const
+            {
+                if (myOp.op != o.myOp.op || myOp.n != o.myOp.n || !(myState == o.myState))
+                    return false;
+                if (myOp.op == eDrawOp::text || myOp.op == eDrawOp::textFontName)
+                {
+                    // coordinates start with the text index, which can differ
+                    if (*myOp.text != *o.myOp.text)
+                        return false;
+                    return std::equal(myOp.c + 1, myOp.c + myOp.n, o.myOp.c + 1);
+                }
+                return std::equal(myOp.c, myOp.c + myOp.n, o.myOp.c);
+            }
+        };
+
+        int find(int id) const
+        {
+            for (int k = 0; k < (int)mySegment.size(); k++)
+                if (mySegment[k].myID == id)
+                    return k;
+            return -1;
+        }
+
+        sSegment &current()
+        {
+            if (myCurrent < 0)
+                segment(0);
+            return mySegment[myCurrent];
+        }
+
+        void add(eDrawOp op, std::initializer_list<int> coord)
+        {
+            auto &s = current();
+            s.myOp.push_back((unsigned char)op);
+            s.myCoord.insert(s.myCoord.end(), coord);
+        }
+
+        void points(eDrawOp op, const std::vector<cxy> &v)
+        {
+            auto &s = current();
+            s.myOp.push_back((unsigned char)op);
+            s.myCoord.push_back((int)v.size());
+            for (auto &p : v)
+            {
+                s.myCoord.push_back((int)p.x);
+                s.myCoord.push_back((int)p.y);
+            }
+        }
+
+        static int milli(double v)
+        {
+            return (int)std::lround(v * 1000);
+        }
+
+        /// call f( op, state ) for each op in the valid segments, in order
+        template <class F>
+        void visit(F f) const
+        {
+            sState st{0, 0xFFFFFF, 0, 1, 0, 0, 20, nullptr};
+            for (auto &s : mySegment)
+            {
+                if (!s.myfValid)
+                    continue;
+                const int *c = s.myCoord.data();
+                for (auto code : s.myOp)
+                {
+                    sOp op{(eDrawOp)code, c, 0, nullptr};
+                    switch (op.op)
+                    {
+                    case eDrawOp::color:
+                        st.color = c[0];
+                        op.n = 1;
+                        break;
+                    case eDrawOp::bgcolor:
+                        st.bgcolor = c[0];
+                        op.n = 1;
+                        break;
+                    case eDrawOp::transparent:
+                        st.transparent = c[0];
+                        op.n = 1;
+                        break;
+                    case eDrawOp::penThick:
+                        st.penThick = c[0];
+                        op.n = 1;
+                        break;
+                    case eDrawOp::fill:
+                        st.fill = c[0];
+                        op.n = 1;
+                        break;
+                    case eDrawOp::textVertical:
+                        st.textVertical = c[0];
+                        op.n = 1;
+                        break;
+                    case eDrawOp::textHeight:
+                        st.textHeight = c[0];
+                        op.n = 1;
+                        break;
+                    case eDrawOp::textFontName:
+                        op.text = &s.myText[c[0]];
+                        st.font = op.text;
+                        op.n = 1;
+                        break;
+                    case eDrawOp::pixel:
+                        op.n = 2;
+                        break;
+                    case eDrawOp::line:
+                    case eDrawOp::rectangle:
+                        op.n = 4;
+                        break;
+                    case eDrawOp::polyLine:
+                    case eDrawOp::polygon:
+                        op.n = 1 + 2 * c[0];
+                        break;
+                    case eDrawOp::segments:
+                        op.n = 1 + 4 * c[0];
+                        break;
+                    case eDrawOp::arc:
+                        op.n = 5;
+                        break;
+                    case eDrawOp::circle:
+                        op.n = 3;
+                        break;
+                    case eDrawOp::text:
+                        op.text = &s.myText[c[0]];
+                        op.n = 2 + c[1];
+                        break;
+                    }
+                    f(op, st);
+                    c += op.n;
+                }
+            }
+        }
+
+        std::vector<sFlat> flatten() const
+        {
+            std::vector<sFlat> ret;
+            visit(
+                [&](const sOp &op, const sState &st)
+                { ret.push_back({op, st, op.bounds(st)}); });
+            return ret;
+        }
+
+        template <class T>
+        static void play(T &target, const sOp &op)
+        {
+            const int *c = op.c;
+            switch (op.op)
+            {
+            case eDrawOp::color:
+                target.color(c[0]);
+                break;
+            case eDrawOp::bgcolor:
+                target.bgcolor(c[0]);
+                break;
+            case eDrawOp::transparent:
+                target.transparent(c[0] != 0);
+                break;
+            case eDrawOp::penThick:
+                target.penThick(c[0]);
+                break;
+            case eDrawOp::fill:
+                target.fill(c[0] != 0);
+                break;
+            case eDrawOp::textVertical:
+                target.textVertical(c[0] != 0);
+                break;
+            case eDrawOp::textHeight:
+                target.textHeight(c[0]);
+                break;
+            case eDrawOp::textFontName:
+                target.textFontName(*op.text);
+                break;
+            case eDrawOp::pixel:
+                target.pixel(c[0], c[1]);
+                break;
+            case eDrawOp::line:
+                target.line(std::vector<int>(c, c + 4));
+                break;
+            case eDrawOp::rectangle:
+                target.rectangle(std::vector<int>(c, c + 4));
+                break;
+            case eDrawOp::segments:
+                target.segments(std::vector<int>(c + 1, c + 1 + 4 * c[0]));
+                break;
+            case eDrawOp::polyLine:
+            {
+                std::vector<cxy> v;
+                v.reserve(c[0]);
+                for (int k = 0; k < c[0]; k++)
+                    v.emplace_back(c[1 + 2 * k], c[2 + 2 * k]);
+                target.polyLine(v);
+                break;
+            }
+            case eDrawOp::polygon:
+                target.polygon(std::vector<int>(c + 1, c + 1 + 2 * c[0]));
+                break;
+            case eDrawOp::arc:
+                target.arc(c[0], c[1], c[2] / 1000.0, c[3] / 1000.0, c[4] / 1000.0);
+                break;
+            case eDrawOp::circle:
+                target.circle(c[0], c[1], c[2]);
+                break;
+            case eDrawOp::text:
+                target.text(*op.text, std::vector<int>(c + 2, c + 2 + c[1]));
+                break;
+            }
+        }
+    };
+
+    /** In memory drawing target, for testing display lists without a window
+
+    Has the shapes drawing methods, rasterized into a pixel array
+    the way the Windows GDI draws them: lines exclude their last point,
+    polygons are always filled, rectangles and circles when fill is on.
+    Text is not rendered, it is listed in texts().
+    */
+    class displayRaster
+    {
+    public:
+        /** Constructor
+        @param[in] width pixels
+        @param[in] height pixels
+        @param[in] background color
+        */
+        displayRaster(int width, int height, int background = 0xFFFFFF)
+            : myWidth(width), myHeight(height),
+              myPixel((size_t)width * height, background),
+              myColor(0), myPenThick(1), myfFill(false), myCalls(0)
+        {
+        }
+
+        int width() const
+        {
+            return myWidth;
+        }
+        int height() const
+        {
+            return myHeight;
+        }
+        /// color of pixel, -1 if outside
+        int get(int x, int y) const
+        {
+            if (x < 0 || y < 0 || x >= myWidth || y >= myHeight)
+                return -1;
+            return myPixel[(size_t)y * myWidth + x];
+        }
+        bool operator==(const displayRaster &o) const
+        {
+            return myWidth == o.myWidth && myPixel == o.myPixel;
+        }
+        /// number of drawing calls made, not counting color and other settings
+        int calls() const
+        {
+            return myCalls;
+        }
+        /// text drawn, with its left, top or left, top, width, height
+        const std::vector<std::pair<std::string, std::vector<int>>> &texts() const
+        {
+            return myText;
+        }
+
+        void color(int r, int g, int b)
+        {
+            color(r | (g << 8) | (b << 16));
+        }
+        void color(int c)
+        {
+            myColor = c;
+        }
+        void bgcolor(int) {}
+        void bgcolor(int, int, int) {}
+        void transparent(bool = true) {}
+        void penThick(int t)
+        {
+            myPenThick = std::max(1, t);
+        }
+        void fill(bool f = true)
+        {
+            myfFill = f;
+        }
+        void textVertical(bool = true) {}
+        void textHeight(int) {}
+        void textFontName(const std::string &) {}
+
+        void pixel(int x, int y)
+        {
+            myCalls++;
+            set(x, y);
+        }
+        void line(const std::vector<int> &v)
+        {
+            myCalls++;
+            segment(v[0], v[1], v[2], v[3]);
+        }
+        void line(const cxy &p1, const cxy &p2)
+        {
+            line({(int)p1.x, (int)p1.y,
+                  (int)p2.x, (int)p2.y});
+        }
+        /// @param[in] v x1, y1, x2, y2 of each segment
+        void segments(const std::vector<int> &v)
+        {
+            myCalls++;
+            for (int k = 0; k + 3 < (int)v.size(); k += 4)
+                segment(v[k], v[k + 1], v[k + 2], v[k + 3]);
+        }
+        void polyLine(const std::vector<cxy> &v)
+        {
+            myCalls++;
+            for (int k = 1; k < (int)v.size(); k++)
+                segment((int)v[k - 1].x, (int)v[k - 1].y, (int)v[k].x, (int)v[k].y);
+        }
+        void rectangle(const std::vector<int> &v)
+        {
+            myCalls++;
+            int l = v[0], t = v[1], r = v[0] + v[2], b = v[1] + v[3];
+            if (!myfFill)
+            {
+                segment(l, t, r, t);
+                segment(r, t, r, b);
+                segment(r, b, l, b);
+                segment(l, b, l, t);
+                return;
+            }
+            span(l, r, t, b);
+        }
+        void rectangle(
+            const cxy &topleft,
+            const cxy &widthHeight)
+        {
+            rectangle(
+                {(int)topleft.x, (int)topleft.y,
+                 (int)widthHeight.x, (int)widthHeight.y});
+        }
+        /// @param[in] v x0,y0,x1,y1,...
+        void polygon(const std::vector<int> &v)
+        {
+            myCalls++;
+            int n = (int)v.size() / 2;
+            if (!n)
+                return;
+
+            // even-odd fill, sampled at pixel centers
+            int top = INT_MAX, bottom = INT_MIN;
+            for (int k = 0; k < n; k++)
+            {
+                top = std::min(top, v[2 * k + 1]);
+                bottom = std::max(bottom, v[2 * k + 1]);
+            }
+            for (int y = std::max(0, top); y < std::min(myHeight, bottom); y++)
+            {
+                double yc = y + 0.5;
+                std::vector<double> cross;
+                for (int k = 0; k < n; k++)
+                {
+                    int j = (k + 1) % n;
+                    double y1 = v[2 * k + 1], y2 = v[2 * j + 1];
+                    if ((y1 <= yc) == (y2 <= yc))
+                        continue;
+                    double x1 = v[2 * k], x2 = v[2 * j];
+                    cross.push_back(x1 + (yc - y1) * (x2 - x1) / (y2 - y1));
+                }
+                std::sort(cross.begin(), cross.end());
+                for (int k = 0; k + 1 < (int)cross.size(); k += 2)
+                    span((int)std::ceil(cross[k] - 0.5), (int)std::ceil(cross[k + 1] - 0.5), y, y + 1);
+            }
+            for (int k = 0; k < n; k++)
+            {
+                int j = (k + 1) % n;
+                segment(v[2 * k], v[2 * k + 1], v[2 * j], v[2 * j + 1]);
+            }
+        }
+        void polygon(const std::vector<cxy> &v)
+        {
+            std::vector<int> pp;
+            for (auto &p : v)
+            {
+                pp.push_back((int)p.x);
+                pp.push_back((int)p.y);
+            }
+            polygon(pp);
+        }
+        /// arc anti-clockwise from sa to ea, degrees from 3 o'clock
+        void arc(
+            int x, int y, double r,
+            double sa, double ea)
+        {
+            myCalls++;
+            double span = ea - sa;
+            while (span <= 0)
+                span += 360;
+            int steps = std::max(8, (int)(r * span * M_PI / 180));
+            for (int k = 0; k <= steps; k++)
+            {
+                double a = (sa + span * k / steps) * M_PI / 180;
+                stamp((int)std::lround(x + r * cos(a)), (int)std::lround(y - r * sin(a)));
+            }
+        }
+        void circle(int x0, int y0, double r)
+        {
+            myCalls++;
+            int ir = (int)r;
+            if (myfFill)
+                for (int dy = -ir; dy <= ir; dy++)
+                {
+                    int dx = (int)std::sqrt((double)ir * ir - (double)dy * dy);
+                    span(x0 - dx, x0 + dx + 1, y0 + dy, y0 + dy + 1);
+                }
+            int steps = std::max(8, (int)(2 * M_PI * r));
+            for (int k = 0; k < steps; k++)
+            {
+                double a = 2 * M_PI * k / steps;
+                stamp((int)std::lround(x0 + r * cos(a)), (int)std::lround(y0 - r * sin(a)));
+            }
+        }
+        void text(
+            const std::string &t,
+            const std::vector<int> &v)
+        {
+            myCalls++;
+            myText.push_back(std::make_pair(t, v));
+        }
+        void textxy(
+            const std::string &t,
+            const cxy &xy)
+        {
+            text(
+                t,
+                {(int)xy.x, (int)xy.y});
+        }
+
+    private:
+        int myWidth;
+        int myHeight;
+        std::vector<int> myPixel;
+        int myColor;
+        int myPenThick;
+        bool myfFill;
+        int myCalls;
+        std::vector<std::pair<std::string, std::vector<int>>> myText;
+
+        void set(int x, int y)
+        {
+            if (x < 0 || y < 0 || x >= myWidth || y >= myHeight)
+                return;
+            myPixel[(size_t)y * myWidth + x] = myColor;
+        }
+        /// pen sized square at point
+        void stamp(int x, int y)
+        {
+            int h = (myPenThick - 1) / 2;
+            span(x - h, x - h + myPenThick, y - h, y - h + myPenThick);
+        }
+        /// fill left <= x < right, top <= y < bottom
+        void span(int left, int right, int top, int bottom)
+        {
+            left = std::max(0, left);
+            right = std::min(myWidth, right);
+            top = std::max(0, top);
+            bottom = std::min(myHeight, bottom);
+            for (int y = top; y < bottom; y++)
+                for (int x = left; x < right; x++)
+                    myPixel[(size_t)y * myWidth + x] = myColor;
+        }
+        /// Bresenham, excluding the last point
+        void segment(int x1, int y1, int x2, int y2)
+        {
+            int dx = std::abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+            int dy = -std::abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+            int err = dx + dy;
+            while (x1 != x2 || y1 != y2)
+            {
+                stamp(x1, y1);
+                int e2 = 2 * err;
+                if (e2 >= dy)
+                {
+                    err += dy;
+                    x1 += sx;
+                }
+                if (e2 <= dx)
+                {
+                    err += dx;
+                    y1 += sy;
+                }
+            }
+        }
+    };
+}
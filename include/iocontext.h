@@ -0,0 +1,511 @@
+#pragma once
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <cerrno>
+
+namespace wex
+{
+    /** @brief Socket readiness event loop
+
+    Sockets are non-blocking.  Instead of a thread blocking in each read,
+    the application asks to be told when a socket is ready, with watch(),
+    and the loop polls every watched socket together ( WSAPoll on windows, poll elsewhere ).
+    When a socket is ready its handler runs on a loop thread, and can read or accept without blocking.
+    So any number of sockets share one thread.
+
+    Also run are functions posted from any thread, and timers.
+
+    With more than one thread, the threads take turns to poll
+    while the others run the handlers that are ready.
+
+    A watch fires once.  To keep reading, call watch() again from the handler.
+
+    <pre>
+    wex::ioContext io;
+    io.start( 2 );
+    io.watch( socket, wex::ioContext::eWait::read, [&]
+    {
+        recv( socket, ... );
+    });
+    ...
+    std::cout << io.pending() << " operations waiting, "
+              << io.dispatchLatencyMean() << " usecs mean dispatch latency\n";
+    ...
+    io.stop();
+    </pre>
+
+    stop() and the destructor join the threads, so they must not be called from a handler.
+    */
+    class ioContext
+    {
+    public:
+#ifdef _WIN32
+        typedef SOCKET socket_t;
+        static const socket_t invalidSocket = INVALID_SOCKET;
+#else
+        typedef int socket_t;
+        static const socket_t invalidSocket = -1;
+#endif
+        /// what a watch waits for
+        enum class eWait
+        {
+            read,  ///< data, a connection to accept, or the peer closed
+            write, ///< room to send, or a connect completed
+        };
+
+        ioContext()
+            : myfRunning(false), myfPolling(false), myNextID(1),
+              myWakeSocket(invalidSocket), myBusy(0),
+              myCompleted(0), myDispatched(0), myLatencyTotal(0), myLatencyMax(0)
+        {
+#ifdef _WIN32
+            WSADATA wsaData;
+            WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+            wakeSocket();
+        }
+        /** DTOR
+
+        Stops the context, joining its threads.
+        */
+        ~ioContext()
+        {
+            stop();
+            closeSocket(myWakeSocket);
+#ifdef _WIN32
+            WSACleanup();
+#endif
+        }
+
+        /** Start threads
+        @param[in] threadCount number of threads, default 1
+
+        Does nothing if already running.
+        */
+        void start(int threadCount = 1)
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            if (myfRunning)
+                return;
+            if (threadCount < 1)
+                threadCount = 1;
+            myfRunning = true;
+            for (int k = 0; k < threadCount; k++)
+                myThread.emplace_back(&ioContext::worker, this);
+        }
+
+        /** Stop the context
+
+        Blocks until the threads have exited.
+        A handler already running completes normally.
+        Watches, timers and posted functions not yet run are discarded.
+        */
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myfRunning = false;
+                myWatch.clear();
+                myTimer.clear();
+                myReady.clear();
+            }
+            myCV.notify_all();
+            wake();
+            for (auto &t : myThread)
+                t.join();
+            myThread.clear();
+        }
+
+        bool isRunning() const
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            return myfRunning;
+        }
+
+        /** Call a function when a socket is ready
+        @param[in] s the socket, non-blocking
+        @param[in] w what to wait for
+        @param[in] ready function to run on a loop thread when the socket is ready, or has an error
+
+        The watch fires once.
+        */
+        void watch(
+            socket_t s,
+            eWait w,
+            std::function<void()> ready)
+        {
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myWatch.push_back({myNextID++, s, w, ready});
+            }
+            wake();
+        }
+
+        /** Remove the watches and timers of a socket
+        @param[in] s the socket
+
+        Their handlers will not run.
+        If a handler for the socket is running on another thread
+        this waits for it to return, so the socket can then be closed safely.
+        */
+        void cancel(socket_t s)
+        {
+            std::unique_lock<std::mutex> lck(myMutex);
+            myWatch.erase(
+                std::remove_if(
+                    myWatch.begin(), myWatch.end(),
+                    [s](const sWatch &w)
+                    { return w.s == s; }),
+                myWatch.end());
+            myTimer.erase(
+                std::remove_if(
+                    myTimer.begin(), myTimer.end(),
+                    [s](const sTimer &t)
+                    { return t.s == s; }),
+                myTimer.end());
+            myReady.erase(
+                std::remove_if(
+                    myReady.begin(), myReady.end(),
+                    [s](const sOperation &op)
+                    { return op.s == s; }),
+                myReady.end());
+            auto self = std::this_thread::get_id();
+            myCV.wait(
+                lck,
+                [&]
+                {
+                    for (auto &r : myRunning)
+                        if (r.second == s && r.first != self)
+                            return false;
+                    return true;
+                });
+        }
+
+        /** Run a function on a loop thread
+        @param[in] f the function
+
+        If the context has not been started
+        the function waits until it is.
+        */
+        void post(std::function<void()> f)
+        {
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myReady.push_back({invalidSocket, f, std::chrono::steady_clock::now()});
+            }
+            myCV.notify_one();
+            wake();
+        }
+
+        /** Run a function on a loop thread after a delay
+        @param[in] delay
+        @param[in] f the function
+        @param[in] s socket the timer belongs to, cancel( s ) removes the timer
+        */
+        void after(
+            std::chrono::milliseconds delay,
+            std::function<void()> f,
+            socket_t s = invalidSocket)
+        {
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myTimer.push_back({std::chrono::steady_clock::now() + delay, s, f});
+            }
+            wake();
+        }
+
+        /// @name Counters
+        ///@{
+
+        /// number of threads
+        int threadCount() const
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            return (int)myThread.size();
+        }
+        /// watches, timers and functions waiting or running
+        int pending() const
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            return (int)(myWatch.size() + myTimer.size() + myReady.size()) + myBusy;
+        }
+        /// handlers ready, waiting for a free thread
+        int queued() const
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            return (int)myReady.size();
+        }
+        /// handlers run since construction
+        long long completed() const
+        {
+            return myCompleted;
+        }
+        /// mean time in microseconds from a handler being ready until a thread started it
+        double dispatchLatencyMean() const
+        {
+            long long c = myDispatched;
+            if (!c)
+                return 0;
+            return (double)myLatencyTotal / c;
+        }
+        /// maximum time in microseconds from a handler being ready until a thread started it
+        double dispatchLatencyMax() const
+        {
+            return (double)myLatencyMax;
+        }
+        ///@}
+
+        /// @name Socket helpers, the same on every platform
+        ///@{
+
+        static void closeSocket(socket_t s)
+        {
+            if (s == invalidSocket)
+                return;
+#ifdef _WIN32
+            closesocket(s);
+#else
+            ::close(s);
+#endif
+        }
+        static void nonBlocking(socket_t s)
+        {
+#ifdef _WIN32
+            u_long mode = 1;
+            ioctlsocket(s, FIONBIO, &mode);
+#else
+            fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+        }
+        /// true if the last socket call failed only because it would have blocked
+        static bool wouldBlock()
+        {
+#ifdef _WIN32
+            int e = WSAGetLastError();
+            return e == WSAEWOULDBLOCK || e == WSAEINPROGRESS;
+#else
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS;
+#endif
+        }
+        ///@}
+
+    private:
+        struct sWatch
+        {
+            long long id;
+            socket_t s;
+            eWait w;
+            std::function<void()> ready;
+        };
+        struct sTimer
+        {
+            std::chrono::steady_clock::time_point due;
+            socket_t s;
+            std::function<void()> f;
+        };
+        struct sOperation
+        {
+            socket_t s; // socket watched or timer belongs to, invalid for posted functions
+            std::function<void()> f;
+            std::chrono::steady_clock::time_point ready;
+        };
+
+        mutable std::mutex myMutex;
+        std::condition_variable myCV;
+        std::vector<std::thread> myThread;
+        bool myfRunning;
+        bool myfPolling; // true while a thread is polling
+        long long myNextID;
+        std::vector<sWatch> myWatch;
+        std::vector<sTimer> myTimer;
+        std::deque<sOperation> myReady;
+        std::vector<std::pair<std::thread::id, socket_t>> myRunning;
+
+        // loopback datagram socket that sends to itself, to wake the polling thread
+        socket_t myWakeSocket;
+
+        int myBusy; // handlers running
+        std::atomic<long long> myCompleted;
+        std::atomic<long long> myDispatched;
+        std::atomic<long long> myLatencyTotal;
+        std::atomic<long long> myLatencyMax;
+
+        void wakeSocket()
+        {
+            myWakeSocket = socket(AF_INET, SOCK_DGRAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            socklen_t len = sizeof(addr);
+            if (myWakeSocket == invalidSocket ||
+                bind(myWakeSocket, (sockaddr *)&addr, sizeof(addr)) ||
+                getsockname(myWakeSocket, (sockaddr *)&addr, &len) ||
+                connect(myWakeSocket, (sockaddr *)&addr, sizeof(addr)))
+            {
+                closeSocket(myWakeSocket);
+                throw std::runtime_error("windex ioContext cannot create wake socket");
+            }
+            nonBlocking(myWakeSocket);
+        }
+
+        /// interrupt the poll, so the watches are read again
+        void wake()
+        {
+            char c = 0;
+            ::send(myWakeSocket, &c, 1, 0);
+        }
+        void drainWake()
+        {
+            char buf[64];
+            while (::recv(myWakeSocket, buf, sizeof(buf), 0) > 0)
+            {
+            }
+        }
+
+        void worker()
+        {
+            std::unique_lock<std::mutex> lck(myMutex);
+            while (myfRunning)
+            {
+                if (myReady.size())
+                {
+                    run(lck);
+                    continue;
+                }
+                if (myfPolling)
+                {
+                    // another thread is polling, wait for work it finds
+                    myCV.wait(
+                        lck,
+                        [this]
+                        { return !myfRunning || myReady.size() || !myfPolling; });
+                    continue;
+                }
+                myfPolling = true;
+                poll(lck);
+                myfPolling = false;
+                myCV.notify_all();
+            }
+        }
+
+        /// run the first ready handler, the lock is released while it runs
+        void run(std::unique_lock<std::mutex> &lck)
+        {
+            sOperation op = std::move(myReady.front());
+            myReady.pop_front();
+            myRunning.push_back(std::make_pair(std::this_thread::get_id(), op.s));
+            myBusy++;
+            lck.unlock();
+
+            long long usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - op.ready)
+                                  .count();
+            myDispatched++;
+            myLatencyTotal += usecs;
+            long long mx = myLatencyMax;
+            while (usecs > mx &&
+                   !myLatencyMax.compare_exchange_weak(mx, usecs))
+            {
+            }
+
+            op.f();
+            myCompleted++;
+
+            lck.lock();
+            myBusy--;
+            auto self = std::this_thread::get_id();
+            myRunning.erase(
+                std::find_if(
+                    myRunning.begin(), myRunning.end(),
+                    [&](const std::pair<std::thread::id, socket_t> &r)
+                    { return r.first == self; }));
+            myCV.notify_all();
+        }
+
+        /// wait for sockets, moving handlers that are ready to myReady.  Called with the lock held
+        void poll(std::unique_lock<std::mutex> &lck)
+        {
+            std::vector<pollfd> fds;
+            std::vector<long long> ids;
+            fds.push_back({myWakeSocket, POLLIN, 0});
+            ids.push_back(0);
+            for (auto &w : myWatch)
+            {
+                fds.push_back({w.s, (short)(w.w == eWait::read ? POLLIN : POLLOUT), 0});
+                ids.push_back(w.id);
+            }
+            int timeout = -1;
+            auto now = std::chrono::steady_clock::now();
+            for (auto &t : myTimer)
+            {
+                int ms = (int)std::max(
+                    (long long)0,
+                    (long long)std::chrono::duration_cast<std::chrono::milliseconds>(t.due - now).count() + 1);
+                if (timeout < 0 || ms < timeout)
+                    timeout = ms;
+            }
+
+            lck.unlock();
+#ifdef _WIN32
+            int n = WSAPoll(fds.data(), (ULONG)fds.size(), timeout);
+#else
+            int n = ::poll(fds.data(), fds.size(), timeout);
+#endif
+            lck.lock();
+            if (!myfRunning)
+                return;
+
+            now = std::chrono::steady_clock::now();
+            if (n > 0)
+            {
+                if (fds[0].revents)
+                    drainWake();
+                for (int k = 1; k < (int)fds.size(); k++)
+                {
+                    if (!fds[k].revents)
+                        continue;
+
+                    // the watch may have been cancelled while polling
+                    auto it = std::find_if(
+                        myWatch.begin(), myWatch.end(),
+                        [&](const sWatch &w)
+                        { return w.id == ids[k]; });
+                    if (it == myWatch.end())
+                        continue;
+                    myReady.push_back({it->s, std::move(it->ready), now});
+                    myWatch.erase(it);
+                }
+            }
+            for (int k = 0; k < (int)myTimer.size();)
+            {
+                if (myTimer[k].due > now)
+                {
+                    k++;
+                    continue;
+                }
+                myReady.push_back({myTimer[k].s, std::move(myTimer[k].f), myTimer[k].due});
+                myTimer.erase(myTimer.begin() + k);
+            }
+        }
+    };
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <algorithm>
+#include <charconv>
+
+namespace wex
+{
+    /** Numbers formatted for axis labels, rounded to significant digits
+
+    format() writes into a caller's buffer, with no allocation.
+    label() remembers the labels it has made,
+    so labels repeated on every paint are formatted once.
+
+    <pre>
+        wex::labelFormat F;
+        S.text( F.label( tickValue ), { x, y } );
+    </pre>
+    */
+    class labelFormat
+    {
+    public:
+        /// size of buffer needed by format()
+        static const int bufSize = 48;
+
+        /// @param[in] maxCached labels kept before the cache is cleared
+        labelFormat(int maxCached = 1024)
+            : myMaxCached(maxCached)
+        {
+        }
+
+        /** Format number
+        @param[out] buf at least bufSize chars
+        @param[in] f the number
+        @param[in] digits significant digits
+        @return length written, buf is null terminated
+
+        Fixed notation, rounded to the significant digits,
+        with no decimal places beyond them.
+        https://stackoverflow.com/a/17211620/16582
+        */
+        static int format(char *buf, double f, int digits = 3)
+        {
+            if (f == 0 || !std::isfinite(f))
+            {
+                if (f == 0)
+                    return copy(buf, "0");
+                if (std::isnan(f))
+                    return copy(buf, "nan");
+                return copy(buf, f < 0 ? "-inf" : "inf");
+            }
+            int d = (int)::floor(::log10(f < 0 ? -f : f)) + 1; // digits before decimal point
+            double order = ::pow(10., digits - d);
+            double v = ::round(f * order) / order;
+            int precision = std::max(digits - d, 0);
+            if (std::fabs(v) >= 1e30 || precision > 30)
+                // too long for fixed notation in the buffer
+                return std::snprintf(buf, bufSize, "%.*g", digits, v);
+#if defined(__cpp_lib_to_chars)
+            auto r = std::to_chars(buf, buf + bufSize - 1, v, std::chars_format::fixed, precision);
+            *r.ptr = '\0';
+            return (int)(r.ptr - buf);
+#else
+            return std::snprintf(buf, bufSize, "%.*f", precision, v);
+#endif
+        }
+
+        /** Label for number
+        @param[in] f the number
+        @param[in] digits significant digits
+        @return reference to cached label, valid until the cache is cleared
+        */
+        const std::string &label(double f, int digits = 3)
+        {
+            sKey key{f, digits};
+            auto it = myCache.find(key);
+            if (it != myCache.end())
+                return it->second;
+            if ((int)myCache.size() >= myMaxCached)
+                myCache.clear();
+            char buf[bufSize];
+            int n = format(buf, f, digits);
+            return myCache.emplace(key, std::string(buf, n)).first->second;
+        }
+
+        /// number of labels cached
+        int size() const
+        {
+            return (int)myCache.size();
+        }
+        void clear()
+        {
+            myCache.clear();
+        }
+
+    private:
+        struct sKey
+        {
+            double value;
+            int digits;
+
+            bool operator==(const sKey &o) const
+            {
+                // compare bits, so 0 and -0 are different labels
+                return std::memcmp(&value, &o.value, sizeof(value)) == 0 && digits == o.digits;
+            }
+        };
+        struct sHash
+        {
+            size_t operator()(const sKey &k) const
+            {
+                unsigned long long bits;
+                std::memcpy(&bits, &k.value, sizeof(bits));
+                return std::hash<unsigned long long>()(bits * 31 + k.digits);
+            }
+        };
+        std::unordered_map<sKey, std::string, sHash> myCache;
+        int myMaxCached;
+
+        static int copy(char *buf, const char *s)
+        {
+            int n = (int)std::strlen(s);
+            std::memcpy(buf, s, n + 1);
+            return n;
+        }
+    };
+}
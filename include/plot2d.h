@@ -9,6 +9,7 @@
 #include <cfloat>
 
 #include <wex.h>
+#include "axisticks.h"
 
 // minimum data range that will produce sensible plots
 #define minDataRange 0.000001
@@ -930,7 +931,6 @@ namespace wex
                 double scale;
                 int tickCount = 8;
                 int paxis;
-                int tickPixel;
                 if (myOrient == eOrient::horz)
                 {
                     paxis = ys.YPmin();
@@ -950,53 +950,17 @@ namespace wex
                     scale = (ys.YPmax() - ys.YPmin()) / ys.YVrange();
                 }
 
-                for (double tickValue : tickValues(tickCount, myvmin, myvmax))
-                {
-                    switch (myOrient)
-                    {
-                    case eOrient::horz:
-
-                        tickPixel = xs.XPmin() + scale * (tickValue - xs.XUmin());
-                        S.line(
-                            {tickPixel, paxis - 5,
-                             tickPixel, paxis + 5});
-                        S.text(
-                            numberformat(tickValue),
-                            {tickPixel, paxis + 5,
-                             tickPixel + 50, paxis + 15});
-                        if (myfGrid)
-                        {
-                            for (int kp = paxis;
-                                 kp >= ys.YPmax();
-                                 kp -= 25)
-                            {
-                                S.pixel(tickPixel, kp);
-                                S.pixel(tickPixel, kp + 1);
-                            }
-                        }
-                        break;
-
-                    case eOrient::vert:
-
-                        tickPixel = ys.YPmin() + scale * (tickValue - ys.YVmin());
-                        S.line({paxis - 5, tickPixel,
-                                paxis + 5, tickPixel});
-                        S.text(
-                            numberformat(tickValue),
-                            {paxis - 50, tickPixel, paxis - 5, tickPixel + 15});
-                        if (myfGrid)
-                        {
-                            for (int kp = paxis;
-                                 kp < xs.XPmax();
-                                 kp += 25)
-                            {
-                                S.pixel(kp, tickPixel);
-                                S.pixel(kp + 1, tickPixel);
-                            }
-                        }
-                        break;
-                    }
-                }
+                calcTickValues(tickCount, myvmin, myvmax);
+                if (myOrient == eOrient::horz)
+                    myTicks.horz(
+                        S, myTickValues,
+                        paxis, xs.XPmin(), xs.XUmin(), scale,
+                        myfGrid, ys.YPmax());
+                else
+                    myTicks.vert(
+                        S, myTickValues,
+                        paxis, ys.YPmin(), ys.YVmin(), scale,
+                        myfGrid, xs.XPmax());
             }
 
         private:
@@ -1005,13 +969,16 @@ namespace wex
             double myvmax;
             bool myfEnable;
             bool myfGrid;
+            std::vector<double> myTickValues; // reused on every paint
+            axisTicks myTicks;                // tick labels kept between paints
 
-            std::vector<double> tickValues(
+            /// calculate tick values into myTickValues
+            void calcTickValues(
                 int count,
                 double min,
                 double max)
             {
-                std::vector<double> ret;
+                myTickValues.clear();
                 double tickinc = (max - min) / count;
                 if (tickinc > 1)
                     tickinc = floor(tickinc);
@@ -1020,26 +987,8 @@ namespace wex
                     v < max;
                     v += tickinc)
                 {
-                    ret.push_back(v);
-                }
-                return ret;
-            }
-
-            /** format number with 2 significant digits
-             *    https://stackoverflow.com/a/17211620/16582
-             */
-            std::string numberformat(double f)
-            {
-                if (f == 0)
-                {
-                    return "0";
+                    myTickValues.push_back(v);
                 }
-                int n = 3;                                         // number of significant digits
-                int d = (int)::floor(::log10(f < 0 ? -f : f)) + 1; /*digits before decimal point*/
-                double order = ::pow(10., n - d);
-                std::stringstream ss;
-                ss << std::fixed << std::setprecision(std::max(n - d, 0)) << round(f * order) / order;
-                return ss.str();
             }
         };
 
@@ -1,422 +1,51 @@
 #pragma once
-#include <memory>
-#ifdef windex_has_boost
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
-#endif
+#include <algorithm>
+#include <climits>
+#include "propertymodel.h"
 #include "wex.h"
 namespace wex
 {
-    class propertyGrid;
-
-    /// A name value pair
-    class property
-    {
-    public:
-        property(
-            gui *parent,
-            const std::string &name,
-            const std::string &value)
-            : myName(name), myValue(value), W(windex::get()),
-              myLabel(wex::maker::make<wex::label>(*parent)),
-              myEditbox(wex::maker::make<editbox>(*parent)),
-              myCombobox(wex::maker::make<choice>(*parent)),
-              myCheckbox(wex::maker::make<checkbox>(*parent)),
-              myCategoryExpanded(wex::maker::make<checkbox>(*parent)),
-              myLabelWidth(100),
-              myType(eType::string),
-              myLabelClicked(false)
-        {
-            myLabel.text(myName);
-            myLabel.events().click(
-                [this]
-                {
-                    myLabelClicked = true;
-                });
-            myLabel.events().clickPropogate();
-
-            myEditbox.text(myValue);
-        }
-        property(
-            gui *parent,
-            const std::string &name,
-            bool value)
-            : myName(name), myValue(std::to_string((int)value)), W(windex::get()),
-              myLabel(wex::maker::make<label>(*parent)), myEditbox(wex::maker::make<editbox>(*parent)), myCombobox(wex::maker::make<choice>(*parent)), myCheckbox(wex::maker::make<checkbox>(*parent)), myCategoryExpanded(wex::maker::make<checkbox>(*parent)), myLabelWidth(100), myType(eType::check)
-        {
-            myLabel.text(myName);
-            myCheckbox.check(value);
-            myCheckbox.text("");
-            myCheckbox.events().clickPropogate();
-        }
-
-        // construct a choice property
-        property(
-            gui *parent,
-            const std::string &name,
-            const std::vector<std::string> &value)
-            : myName(name), myValue(""), W(windex::get()), myLabel(wex::maker::make<label>(*parent)), myEditbox(wex::maker::make<editbox>(*parent)), myCombobox(wex::maker::make<choice>(*parent)), myCheckbox(wex::maker::make<checkbox>(*parent)), myCategoryExpanded(wex::maker::make<checkbox>(*parent)), myLabelWidth(100), myType(eType::choice)
-        {
-            myLabel.text(myName);
-            myCombobox.itemHeight(30);
-            for (auto &t : value)
-            {
-                myCombobox.add(t);
-            }
-        }
-        /// construct a category
-        property(
-            gui *parent,
-            const std::string &name)
-            : myName(name), W(windex::get()), myLabel(wex::maker::make<label>(*parent)), myEditbox(wex::maker::make<editbox>(*parent)), myCombobox(wex::maker::make<choice>(*parent)), myCheckbox(wex::maker::make<checkbox>(*parent)), myCategoryExpanded(wex::maker::make<checkbox>(*parent)), myType(eType::category)
-        {
-            myCategoryExpanded.text(myName);
-            myCategoryExpanded.plus();
-            myCategoryExpanded.check();
-            myCategoryExpanded.events().clickPropogate();
-        }
-
-        /// destructor
-        ~property()
-        {
-            myLabel.~label();
-            myEditbox.~editbox();
-            myCategoryExpanded.~checkbox();
-            myCombobox.~choice();
-        }
-        void move(const std::vector<int> &r)
-        {
-            std::vector<int> rl(r);
-            rl[2] = myLabelWidth;
-            myLabel.move(rl);
-
-            // size of edit box
-            std::vector<int> re(r);
-            // right side of label
-            re[0] += myLabelWidth;
-            // window width minus label with minus scroll control
-            re[2] -= myLabelWidth + 25;
-
-            switch (myType)
-            {
-            case eType::string:
-                myCategoryExpanded.move({0, 0, 0, 0});
-                myEditbox.move(re);
-                break;
-            case eType::choice:
-                re[3] *= myCombobox.count();
-                myCombobox.move(re[0], re[1], re[2], re[3]);
-                break;
-            case eType::check:
-                myCheckbox.move(re);
-                break;
-            case eType::category:
-                re = r;
-                re[1] += 0.5 * re[3];
-                re[3] /= 2;
-                myCategoryExpanded.move(re);
-                myLabel.move({0, 0, 0, 0}); // keep unused label out of the way
-                break;
-            }
-        }
-        void labelWidth(int w)
-        {
-            myLabelWidth = w;
-        }
-        void bgcolor(int color)
-        {
-            myLabel.bgcolor(color);
-        }
-
-        bool labelClicked() const
-        {
-            return myLabelClicked;
-        }
-        void labelClicked(bool f)
-        {
-            myLabelClicked = f;
-        }
-        std::string labeltext() const
-        {
-            return myLabel.text();
-        }
-
-        void tabList(bool f = true)
-        {
-            if (myType != eType::string)
-                return;
-            auto s = GetWindowLongPtr(myEditbox.handle(), GWL_STYLE);
-            if (f)
-                s |= WS_TABSTOP;
-            else
-                s &= ~WS_TABSTOP;
-            SetWindowLongPtr(
-                myEditbox.handle(),
-                GWL_STYLE,
-                s);
-        }
-
-        /** Add pop help message when mouse hovers over property label
-        @param[in] tip the help message
-        @param[in] width of multiline tooltip, default single line
-        @return property reference
-    */
-        property &tooltip(const std::string &tip, int width = 0)
-        {
-            myLabel.tooltip(tip, width);
-            return *this;
-        }
-        /** Set property to be readonly
-        @param[in] f true if property should be readonly, default true
-        @return property reference
-
-        A property defaults to editable when constructed.
-    */
-        property &readonly(bool f = true)
-        {
-            myCheckbox.enable(!f);
-            switch (myType)
-            {
-            case eType::string:
-                myEditbox.readonly(f);
-                break;
-            default:
-                break;
-            }
-            return *this;
-        }
-
-        void show(bool f = true)
-        {
-            myLabel.show(f);
-            switch (myType)
-            {
-            case eType::string:
-                myEditbox.show(f);
-                break;
-            case eType::choice:
-                myCombobox.show(f);
-                break;
-            case eType::check:
-                myCheckbox.show(f);
-                break;
-            case eType::category:
-                myLabel.show(false); // keep unused label out of the way
-                myCategoryExpanded.show(f);
-                break;
-            }
-        }
-        /** Update ( redraw ) property child widgets
-
-    Some widgets update nicely when the window containing the property grid resizes
-    Others, most significantly labels, do not.  So application code should
-    handle containing window resizes by calling propertyGrid::update()
-    which will call this method on all properties.
-    */
-        void update()
-        {
-            myLabel.update();
-            myCheckbox.update();
-            myCategoryExpanded.update();
-        }
-
-        const std::string &name() const
-        {
-            return myName;
-        }
-        const std::string value() const
-        {
-            switch (myType)
-            {
-            case eType::string:
-                return myEditbox.text();
-
-            case eType::choice:
-                return myCombobox.selectedText();
-
-            case eType::check:
-                return std::to_string((int)myCheckbox.isChecked());
-                break;
-
-            case eType::category:
-                break;
-            }
-            return std::string("");
-        }
-
-        bool isChecked()
-        {
-            if (myType == eType::check)
-                return myCheckbox.isChecked();
-            return false;
-        }
-        /// set property value
-        property &value(const std::string v)
-        {
-            switch (myType)
-            {
-            case eType::string:
-                myValue = v;
-                myEditbox.text(v);
-                myEditbox.update();
-                break;
-            case eType::choice:
-                if (v.empty())
-                {
-                    myCombobox.select(-1);
-                    break;
-                }
-                myValue = v;
-                myCombobox.select(v);
-                break;
-            default:
-                break;
-            }
-            return *this;
-        }
-        void value_bool(bool v)
-        {
-            switch (myType)
-            {
-            case eType::check:
-                myValue = std::to_string((int)v);
-                myCheckbox.check(v);
-                break;
-            default:
-                // other property types ignore requests to change boolean vaue
-                break;
-            }
-        }
-        /// copy value from gui into myValue attribute
-        void saveValue()
-        {
-            switch (myType)
-            {
-            case eType::string:
-                myValue = myEditbox.text();
-                break;
-            case eType::choice:
-                myValue = myCombobox.selectedText();
-                break;
-            case eType::check:
-                myValue = std::to_string((int)myCheckbox.isChecked());
-                break;
-            case eType::category:
-                break;
-            }
-        }
-
-        // get myValue attribute
-        const std::string savedValue() const
-        {
-            return myValue;
-        }
-
-        bool isCategory() const
-        {
-            return myType == eType::category;
-        }
-        bool isExpanded() const
-        {
-            if (!isCategory())
-                return false;
-            return myCategoryExpanded.isChecked();
-        }
-        void expand(bool f)
-        {
-            myCategoryExpanded.check(f);
-        }
-        /// register function to call when property value changes
-        void change(std::function<void()> f)
-        {
-            switch (myType)
-            {
-            case eType::string:
-                myEditbox.events().change(myEditbox.id(), f);
-                break;
-            case eType::check:
-                myCheckbox.events().click(f);
-                break;
-            default:
-                break;
-            }
-        }
-
-        #ifdef windex_has_boost
-        void BoostPropertyTree(
-            boost::property_tree::ptree &tree,
-            const std::string &catname)
-            const
-        {
-            if (myType == eType::choice)
-                tree.put(
-                    catname + myName + ".value",
-                    myCombobox.selectedText());
-            else
-                tree.put(
-                    catname + myName + ".value",
-                    myValue);
-            tree.put(
-                catname + myName + ".type",
-                std::to_string((int)myType));
-            if (myType == eType::choice)
-            {
-                for (int k = 0; k < myCombobox.count(); k++)
-                    tree.put(
-                        catname + myName + ".choice" + std::to_string(k),
-                        myCombobox.text(k));
-            }
-        }
-        #endif
-
-    private:
-        std::string myName;
-        std::string myValue;
-        wex::windex &W;
-        wex::label &myLabel;
-        wex::editbox &myEditbox;
-        wex::choice &myCombobox;
-        wex::checkbox &myCheckbox;
-        wex::checkbox &myCategoryExpanded;
-        int myLabelWidth;
-        enum class eType
-        {
-            string,
-            choice,
-            check,
-            category
-        } myType;
-        bool myLabelClicked;
-    };
     /** A grid of properties.
 
+    The grid is a view over a propertyModel.
+    It is virtualized: a small pool of editor rows, enough to fill the grid's height,
+    is bound to whichever properties are scrolled into view.
+    So the windows created, and the time to create them,
+    depend on the height of the grid and not on the number of properties.
+
 Add boost to the compiler include search list
 */
     class propertyGrid : public gui
     {
     public:
-        typedef std::shared_ptr<property> prop_t;
+        typedef propertyModel::prop_t prop_t;
 
         propertyGrid(gui *parent)
-            : gui(parent, "windex", WS_CHILD, WS_EX_CONTROLPARENT), myHeight(25), myHeightCategory(2), myWidth(300), myLabelWidth(100), myBGColor(0xc8c8c8), myfScroll(false), myftabstop(false)
+            : gui(parent, "windex", WS_CHILD, WS_EX_CONTROLPARENT), myHeight(25), myHeightCategory(2), myWidth(300), myLabelWidth(100), myBGColor(0xc8c8c8), myfScroll(false), myftabstop(false), myfBinding(false), myLastCategory(-1), myDefer(NULL)
         {
             text("PG");
 
-            // handle click event
-            events().click(
-                [this]
+            // keep display in step with the model
+            myModel.listen(
+                [this](property *P, propertyModel::eChange c)
                 {
-                    labelClick();
-                    visible();
+                    modelChanged(P, c);
                 });
 
             // regsiter NOP event handlers
             change([] {});
             nameClick([](const std::string &) {});
         }
+
+        /// the properties displayed
+        propertyModel &model()
+        {
+            return myModel;
+        }
+
         void clear()
         {
-            myProperty.clear();
+            myModel.clear();
         }
         /** Add string property
         @param[in] name of property
@@ -427,9 +56,7 @@ Add boost to the compiler include search list
             const std::string &name,
             const std::string &value)
         {
-            myProperty.push_back(prop_t(new property(this, name, value)));
-            CommonConstruction();
-            return *myProperty.back().get();
+            return myModel.string(name, value);
         }
         /** Add choice property
         @param[in] name of property
@@ -440,9 +67,7 @@ Add boost to the compiler include search list
             const std::string &name,
             const std::vector<std::string> &choice)
         {
-            myProperty.push_back(prop_t(new property(this, name, choice)));
-            CommonConstruction();
-            return *myProperty.back().get();
+            return myModel.choice(name, choice);
         }
         /** Add boolean property
         @param[in] name of property
@@ -453,16 +78,27 @@ Add boost to the compiler include search list
             const std::string &name,
             bool f)
         {
-            myProperty.push_back(prop_t(new property(this, name, f)));
-            CommonConstruction();
-            return *myProperty.back().get();
+            return myModel.check(name, f);
+        }
+        /// Add integer property, edited as a string
+        property &integer(
+            const std::string &name,
+            long long v)
+        {
+            return myModel.integer(name, v);
+        }
+        /// Add real number property, edited as a string
+        property &real(
+            const std::string &name,
+            double v)
+        {
+            return myModel.real(name, v);
         }
         /// Add categoty
         void category(
             const std::string &name)
         {
-            myProperty.push_back(prop_t(new property(this, name)));
-            CommonConstruction();
+            myModel.category(name);
         }
 
 #ifdef windex_has_boost
@@ -474,45 +110,7 @@ Add boost to the compiler include search list
     */
         void add(boost::property_tree::ptree &pt)
         {
-            // loop over categories
-            for (auto cat : pt)
-            {
-                category(cat.first);
-
-                // loop over properties in category
-                for (auto prop : cat.second)
-                {
-                    int type = pt.get<int>(cat.first + "." + prop.first + "." + "type", 0);
-
-                    switch (type)
-                    {
-                    case 1:
-                    {
-                        // choice property
-
-                        std::vector<std::string> vc;
-                        for (auto ch : prop.second)
-                        {
-                            if (ch.first.find("choice") == 0)
-                            {
-                                vc.push_back(ch.second.data());
-                            }
-                        }
-                        choice(prop.first, vc).value(pt.get<std::string>(cat.first + "." + prop.first + "." + "value"));
-                    }
-                    break;
-
-                    default:
-
-                        // string property
-
-                        string(
-                            prop.first,
-                            pt.get<std::string>(cat.first + "." + prop.first + "." + "value", "missing"));
-                        break;
-                    }
-                }
-            }
+            myModel.add(pt);
         }
 
         /// Get properties as a boost property tree
@@ -522,110 +120,110 @@ Add boost to the compiler include search list
             // ensure that values user sees are stored in value attributes
             saveValues();
 
-            boost::property_tree::ptree tree;
-            std::string catname;
-            for (auto p : myProperty)
-            {
-                if (p->isCategory())
-                {
-                    catname = p->name() + ".";
-                }
-                else
-                {
-                    p->BoostPropertyTree(tree, catname);
-                }
-            }
-            return tree;
+            return myModel.BoostPropertyTree();
         }
 
         /// Get properties as a JSON string
         std::string json()
         {
-            std::stringstream ss;
-            write_json(ss, BoostPropertyTree());
-            return ss.str();
+            saveValues();
+            return myModel.json();
         }
 
-        /** Add properties for a JSON string
+#endif
+
+        /** Add properties from a JSON string
         @param[in] json string
 
-        Throws exception if format error in JSON
+        The properties are all added to the model, then laid out once.
+
+        Throws exception if format error in JSON, and adds nothing
     */
         void addjson(const std::string &json)
         {
-            std::cout << "->addjson\n";
-            std::stringstream ss(json);
-            boost::property_tree::ptree tree;
-            read_json(ss, tree);
-            std::cout << "<-read\n";
-            add(tree);
-            std::cout << "<-addjson\n";
+            myModel.addjson(json);
         }
 
-#endif
-
         /// Add vertical scrollbar
         void scroll()
         {
             myfScroll = true;
             gui::scroll(false);
+
+            // replace the scroll handler, which moves child windows,
+            // by one that binds the pooled rows to the properties scrolled into view
+            events().scrollV([this](int code)
+                             {
+                                 SCROLLINFO si;
+                                 si.cbSize = sizeof(si);
+                                 si.fMask = SIF_POS | SIF_TRACKPOS | SIF_PAGE;
+                                 if (!GetScrollInfo(myHandle, SB_VERT, &si))
+                                     return;
+                                 switch (code)
+                                 {
+                                 case SB_LINEUP:
+                                     si.nPos -= myHeight;
+                                     break;
+                                 case SB_LINEDOWN:
+                                     si.nPos += myHeight;
+                                     break;
+                                 case SB_PAGEUP:
+                                     si.nPos -= si.nPage;
+                                     break;
+                                 case SB_PAGEDOWN:
+                                     si.nPos += si.nPage;
+                                     break;
+                                 case SB_THUMBTRACK:
+                                     si.nPos = si.nTrackPos;
+                                     break;
+                                 default:
+                                     return;
+                                 }
+                                 si.fMask = SIF_POS;
+                                 SetScrollInfo(myHandle, SB_VERT, &si, TRUE);
+                                 bind();
+                                 update(); });
         }
         /// Expand, or contract, category of properties
         void expand(
             const std::string name,
             bool fexpand = true)
         {
-            for (auto &p : myProperty)
-            {
-                if (p->name() == name &&
-                    p->isCategory())
-                {
-                    p->expand(fexpand);
-                    visible();
-                    return;
-                }
-            }
+            property *p = myModel.findCategory(name);
+            if (p)
+                p->expand(fexpand);
         }
         void expandAll(
             bool fexpand = true)
         {
-            for (auto &p : myProperty)
-            {
-                if (p->isCategory())
-                {
-                    p->expand(fexpand);
-                }
-            }
-            visible();
+            myModel.expandAll(fexpand);
         }
         void move(const std::vector<int> &r)
         {
             gui::move(r);
             myWidth = r[2];
+
+            // a taller grid needs more rows
+            unplace();
+            layout();
         }
         void labelWidth(int w)
         {
             myLabelWidth = w;
+            unplace();
+            bind();
         }
 
-        /// force every property to redraw its label
+        /// force every visible row to redraw
         void update()
         {
-            for (auto &p : myProperty)
-                p->update();
             gui::update();
         }
 
         /// get pointer to first property with name, ignoring categories
         property *find(const std::string &name)
         {
-            for (auto &p : myProperty)
-            {
-                //std::cout << "property::find " << name <<" "<< p.name() << "\n";
-                if (p->name() == name)
-                    return p.get();
-            }
-            return nullptr;
+            return myModel.find(name);
         }
 
         /// get pointer to first property with name in a category
@@ -633,30 +231,16 @@ Add boost to the compiler include search list
             const std::string &category,
             const std::string &name)
         {
-            for (auto p = myProperty.begin();
-                 p != myProperty.end();
-                 p++)
-            {
-                if ((*p)->isCategory())
-                {
-                    if ((*p)->name() == category)
-                    {
-                        for (p++;
-                             p != myProperty.end();
-                             p++)
-                        {
-                            if ((*p)->isCategory())
-                                return nullptr;
-                            if ((*p)->name() == name)
-                                return p->get();
-                        }
-                    }
-                }
-            }
-            return nullptr;
+            return myModel.find(category, name);
+        }
+
+        /// get pointer to property with precomputed key
+        property *find(const propertyKey &key)
+        {
+            return myModel.find(key);
         }
 
-        /// get value in editbox of property with name
+        /// get value of property with name
         const std::string value(const std::string &name)
         {
             //std::cout << "PG value " << name << "\n";
@@ -666,7 +250,7 @@ Add boost to the compiler include search list
                 static std::string null;
                 return null;
             }
-            std::string v = p->value();
+            saveValue(*p);
             return p->value();
         }
 
@@ -675,16 +259,20 @@ Add boost to the compiler include search list
             property *p = find(name);
             if (!p)
                 return false;
+            saveValue(*p);
             return p->isChecked();
         }
 
-        /// save values in all property textboxes in the property's myValue attribute
+        /** save values in editor widgets in the property's myValue attribute
+
+        Values are saved as they are edited, but only when the grid receives
+        the editor notifications.  This copies the values from the rows in view
+        in case it does not, for example when the grid is not registered with windex.
+    */
         void saveValues()
         {
-            for (auto &p : myProperty)
-            {
-                p->saveValue();
-            }
+            for (auto &R : myRow)
+                save(R);
         }
 
         int propHeight() const
@@ -696,6 +284,8 @@ Add boost to the compiler include search list
         void propHeight(int h)
         {
             myHeight = h;
+            unplace();
+            layout();
         }
 
         /// set category height low i.e. just one property height, rather than 2x prop height
@@ -705,6 +295,8 @@ Add boost to the compiler include search list
                 myHeightCategory = 1;
             else
                 myHeightCategory = 2;
+            unplace();
+            layout();
         }
         int width() const
         {
@@ -712,7 +304,12 @@ Add boost to the compiler include search list
         }
         int propCount() const
         {
-            return (int)myProperty.size();
+            return myModel.size();
+        }
+        /// number of editor rows created, which depends on grid height, not propCount()
+        int rowCount() const
+        {
+            return (int)myRow.size();
         }
         /// Register function to call when property value has changed
         void change(std::function<void()> f)
@@ -732,16 +329,42 @@ Add boost to the compiler include search list
     */
         void tabList(bool f = true)
         {
-            // set flag so that any properties added later will have the tabstop style
+            // set flag so that any rows added later will have the tabstop style
             myftabstop = f;
 
-            // add tabstop style to existing properties
-            for (auto p : myProperty)
-                p->tabList(f);
+            // add tabstop style to existing rows
+            for (auto &R : myRow)
+                tabList(R);
         }
 
     private:
-        std::vector<prop_t> myProperty; // the properties in the grid
+
+        /// A row of editor widgets, bound to a property while it is in view
+        struct sRow
+        {
+            label *myLabel;
+            editbox *myEditbox;
+            wex::choice *myChoice;
+            checkbox *myCheckbox;
+            checkbox *myCategory;
+            property *myProperty;       ///< bound property, nullptr if row is unused
+            const property *myChoiceOf; ///< property whose choices are loaded in myChoice
+            std::string myTip;          ///< tooltip shown by label
+            int myY;                    ///< position of row in grid window, INT_MIN if not placed
+            bool myfShown;
+        };
+
+        /// A property displayed when scrolled into view
+        struct sLine
+        {
+            int myProperty; ///< index into model
+            int myTop;      ///< pixels from top of grid
+            int myHeight;
+        };
+
+        propertyModel myModel;          // the properties in the grid
+        std::vector<sRow> myRow;        // the pool of editor rows
+        std::vector<sLine> myLine;      // the properties not hidden by a collapsed category
         int myHeight;                   // height of a single property
         int myHeightCategory;
         int myWidth;      // width of grid
@@ -749,86 +372,522 @@ Add boost to the compiler include search list
         int myBGColor;    // grid background color
         bool myfScroll;   // true if scrollbars used
         bool myftabstop;
+        bool myfBinding;     // true while rows are being bound, editor notifications ignored
+        int myLastCategory;  // index of last category added, -1 if none
+        HDWP myDefer;        // batch of widget moves, NULL if moves are immediate
         std::function<void()> onChange;                  // funtion to call when property has changed
         std::function<void(const std::string &)> onName; // functio to call when property name is clicked
 
-        void CommonConstruction()
+        /// Update display after the model has changed
+        void modelChanged(property *P, propertyModel::eChange c)
         {
-            prop_t P = myProperty.back();
-            P->labelWidth(myLabelWidth);
-            P->bgcolor(myBGColor);
-            if (myfScroll)
+            // ignore changes made by the grid while copying editor values into the model
+            if (myfBinding)
+                return;
+            switch (c)
             {
-                //std::cout << "pg scroll range " << ((int)myProperty.size()+1) * myHeight << "\n";
-                scrollRange(
-                    myWidth,
-                    ((int)myProperty.size() + 1) * myHeight);
+            case propertyModel::eChange::add:
+                added();
+                break;
+            case propertyModel::eChange::value:
+                for (auto &R : myRow)
+                    if (R.myProperty == P)
+                        fill(R);
+                break;
+            case propertyModel::eChange::attribute:
+                // the choices may have changed, reload the dropdown
+                for (auto &R : myRow)
+                    if (R.myProperty == P)
+                    {
+                        R.myChoiceOf = nullptr;
+                        fill(R);
+                    }
+                break;
+            case propertyModel::eChange::clear:
+                // rows must not point at deleted properties,
+                // a new property may be allocated at the same address
+                for (auto &R : myRow)
+                {
+                    R.myProperty = nullptr;
+                    R.myChoiceOf = nullptr;
+                }
+                layout();
+                break;
+            case propertyModel::eChange::load:
+                layout();
+                break;
+            case propertyModel::eChange::expand:
+                if (P)
+                    expanded(*P);
+                else
+                    layout();
+                break;
             }
+        }
 
-            visible();
+        /// A property has been appended to the model
+        void added()
+        {
+            int index = myModel.size() - 1;
+            property &P = myModel[index];
 
-            P->change([this]
-                      { onChange(); });
+            // append to the displayed lines, without recalculating the others
+            int h = myHeight;
+            if (P.isCategory())
+            {
+                myLastCategory = index;
+                h *= myHeightCategory;
+            }
+            else if (myLastCategory >= 0 &&
+                     !myModel[myLastCategory].isExpanded())
+                return;
+            int top = 0;
+            if (myLine.size())
+                top = myLine.back().myTop + myLine.back().myHeight;
+            myLine.push_back({index, top, h});
+            if (myfScroll)
+                scrollRange(
+                    myWidth,
+                    top + h);
 
-            if (myftabstop)
-                P->tabList();
+            // bind rows if the new property is in view
+            if (top < scrollTop() + viewHeight())
+                bind();
         }
-        void labelClick()
+
+        /// Calculate the properties that can be displayed, then bind rows to those in view
+        void layout()
         {
-            // search properties for the one whose label was clicked
-            for (auto P : myProperty)
+            myLine.clear();
+            myLastCategory = -1;
+            bool expanded = true; /// true if current category is expanded
+            int top = 0;          /// pixels displayed so far
+            for (int k = 0; k < myModel.size(); k++)
             {
-                if (P->labelClicked())
+                auto &P = myModel[k];
+                if (P.isCategory())
                 {
+                    // category always visible, display takes two rows
+                    myLine.push_back({k, top, myHeightCategory * myHeight});
+                    top += myHeightCategory * myHeight;
+                    expanded = P.isExpanded(); // control visibility of contained properties
+                    myLastCategory = k;
+                }
+                else if (expanded)
+                {
+                    myLine.push_back({k, top, myHeight});
+                    top += myHeight;
+                }
+            }
+            if (myfScroll)
+                scrollRange(
+                    myWidth,
+                    top);
+            bind();
+        }
+
+        /** A category has been expanded or collapsed
 
-                    // run regsitered event handler
-                    onName(P->labeltext());
+        Only the lines of the category's properties are inserted or removed,
+        the lines below are shifted and bind() moves only the rows that have changed.
+        */
+        void expanded(property &C)
+        {
+            // refresh the category's plus sign
+            for (auto &R : myRow)
+                if (R.myProperty == &C)
+                    fill(R);
+
+            // the category's line
+            auto it = std::lower_bound(
+                myLine.begin(), myLine.end(), C.index(),
+                [](const sLine &l, int index)
+                { return l.myProperty < index; });
+            if (it == myLine.end() || it->myProperty != C.index())
+                return;
+            int line = (int)(it - myLine.begin()) + 1;
+            int top = it->myTop + it->myHeight;
 
-                    // clear the clicked flag
-                    P->labelClicked(false);
+            int delta;
+            if (C.isExpanded())
+            {
+                std::vector<sLine> add;
+                for (int k = C.index() + 1;
+                     k < myModel.size() && !myModel[k].isCategory();
+                     k++)
+                {
+                    add.push_back({k, top, myHeight});
+                    top += myHeight;
                 }
+                myLine.insert(myLine.begin() + line, add.begin(), add.end());
+                line += (int)add.size();
+                delta = (int)add.size() * myHeight;
+            }
+            else
+            {
+                int end = line;
+                while (end < (int)myLine.size() &&
+                       !myModel[myLine[end].myProperty].isCategory())
+                    end++;
+                delta = -(end - line) * myHeight;
+                myLine.erase(myLine.begin() + line, myLine.begin() + end);
+            }
+            if (!delta)
+                return;
+            for (int k = line; k < (int)myLine.size(); k++)
+                myLine[k].myTop += delta;
+
+            if (myfScroll)
+            {
+                int bottom = 0;
+                if (myLine.size())
+                    bottom = myLine.back().myTop + myLine.back().myHeight;
+                scrollRange(
+                    myWidth,
+                    bottom);
             }
+            bind();
         }
-        /** Show properties when category is expanded or collapsed
-    */
-        void visible()
+
+        /** Bind the pooled rows to the properties scrolled into view
+
+        Rows already showing the right property at the right place are left alone,
+        the others are moved in one batch of deferred window positions.
+        */
+        void bind()
         {
-            // hide all the properties
-            for (auto P : myProperty)
-                P->show(false);
+            int height = viewHeight();
+            int top = scrollTop();
 
-            // show properties in expanded categories
-            bool expanded = true; /// true if current category is expanded
-            int index = 0;        /// number of property heights displayed so far
-            for (auto P : myProperty)
+            // enough rows to fill the grid, with partial rows at top and bottom
+            pool(height / myHeight + 2);
+
+            // first line whose bottom is below the top of the view
+            auto first = std::upper_bound(
+                myLine.begin(), myLine.end(), top,
+                [](int y, const sLine &l)
+                { return y < l.myTop + l.myHeight; });
+            int line = (int)(first - myLine.begin());
+
+            myfBinding = true;
+            myDefer = BeginDeferWindowPos(5 * (int)myRow.size());
+            for (auto &R : myRow)
             {
-                if (P->isCategory())
+                if (line < (int)myLine.size() &&
+                    myLine[line].myTop - top < height)
                 {
-                    //std::cout << "cat " << P.name()  << " at " << index << "\n";
-                    P->move({0, index * myHeight, myWidth, myHeightCategory * myHeight}); // category always visible
-                    P->show();
-                    index += myHeightCategory;  // display takes two rows
-                    expanded = P->isExpanded(); // control visibility of contained properties
+                    const sLine &L = myLine[line];
+                    property &P = myModel[L.myProperty];
+                    int y = L.myTop - top;
+                    line++;
+                    if (R.myProperty == &P)
+                    {
+                        if (R.myY != y)
+                            place(R, L, y);
+                        continue;
+                    }
+
+                    // keep any edit not yet saved
+                    save(R);
+
+                    R.myProperty = &P;
+                    fill(R);
+                    place(R, L, y);
                 }
-                else if (expanded)
+                else if (R.myfShown)
                 {
-                    //std::cout << "show " << P.name() <<" at "<< index << "\n";
-                    P->move({0, index * myHeight, myWidth, myHeight}); // property is visible
-                    P->show();
-                    index++; // displays in one row
+                    save(R);
+                    R.myProperty = nullptr;
+                    hideRow(R);
                 }
-                else
+            }
+            if (myDefer)
+                EndDeferWindowPos(myDefer);
+            myDefer = NULL;
+            myfBinding = false;
+        }
+
+        /// true for properties edited in an editbox
+        static bool isText(property::eType t)
+        {
+            return t == property::eType::string ||
+                   t == property::eType::integer ||
+                   t == property::eType::real;
+        }
+
+        /// Move row to show its property at y
+        void place(sRow &R, const sLine &line, int y)
+        {
+            property &P = *R.myProperty;
+            std::vector<int> r{0, y, myWidth, line.myHeight};
+
+            std::vector<int> rl(r);
+            rl[2] = myLabelWidth;
+
+            // size of edit box
+            std::vector<int> re(r);
+            // right side of label
+            re[0] += myLabelWidth;
+            // window width minus label with minus scroll control
+            re[2] -= myLabelWidth + 25;
+
+            std::vector<int> hide;
+            property::eType t = P.type();
+            defer(*R.myLabel, t != property::eType::category ? rl : hide);
+            defer(*R.myEditbox, isText(t) ? re : hide);
+            defer(*R.myCheckbox, t == property::eType::check ? re : hide);
+            if (t == property::eType::choice)
+            {
+                // tall enough for the dropdown list to appear
+                re[3] = std::max(200, re[3] * (int)P.choices().size());
+                defer(*R.myChoice, re);
+            }
+            else
+                defer(*R.myChoice, hide);
+            if (t == property::eType::category)
+            {
+                re = r;
+                re[1] += re[3] / 2;
+                re[3] /= 2;
+                defer(*R.myCategory, re);
+            }
+            else
+                defer(*R.myCategory, hide);
+
+            R.myY = y;
+            R.myfShown = true;
+        }
+
+        /** Move and show a widget, or hide it, in the current batch
+        @param[in] w the widget
+        @param[in] r location and size, empty to hide
+        */
+        void defer(gui &w, const std::vector<int> &r)
+        {
+            UINT flags = SWP_NOZORDER | SWP_NOACTIVATE;
+            int x = 0, y = 0, cx = 0, cy = 0;
+            if (r.size() == 4)
+            {
+                x = r[0];
+                y = r[1];
+                cx = r[2];
+                cy = r[3];
+                flags |= SWP_SHOWWINDOW;
+            }
+            else
+                flags |= SWP_NOMOVE | SWP_NOSIZE | SWP_HIDEWINDOW;
+
+            // if the batch could not grow, it has been abandoned, so move immediatly
+            if (myDefer)
+                myDefer = DeferWindowPos(myDefer, w.handle(), NULL, x, y, cx, cy, flags);
+            if (!myDefer)
+                SetWindowPos(w.handle(), NULL, x, y, cx, cy, flags);
+        }
+
+        /// Force every row to be moved next time it is bound, after the geometry has changed
+        void unplace()
+        {
+            for (auto &R : myRow)
+                R.myY = INT_MIN;
+        }
+
+        /// Copy property into the row's editor widgets
+        void fill(sRow &R)
+        {
+            property &P = *R.myProperty;
+            bool f = myfBinding;
+            myfBinding = true;
+            switch (P.type())
+            {
+            case property::eType::choice:
+                R.myLabel->text(P.name());
+                if (R.myChoiceOf != &P)
                 {
-                    //std::cout << "hide " << P.name() << "\n";
-                    P->move({0, 0, 0, 0}); // invisible property
-                    P->show(false);
+                    R.myChoice->clear();
+                    for (auto &t : P.choices())
+                        R.myChoice->add(t);
+                    R.myChoiceOf = &P;
                 }
+                if (P.value().empty())
+                    R.myChoice->select(-1);
+                else
+                    R.myChoice->select(P.value());
+                R.myChoice->enable(!P.isReadonly());
+                break;
+            case property::eType::check:
+                R.myLabel->text(P.name());
+                R.myCheckbox->check(P.isChecked());
+                R.myCheckbox->enable(!P.isReadonly());
+                break;
+            case property::eType::category:
+                R.myCategory->text(P.name());
+                R.myCategory->check(P.isExpanded());
+                break;
+            default:
+                R.myLabel->text(P.name());
+                R.myEditbox->text(P.value());
+                R.myEditbox->readonly(P.isReadonly());
+                break;
             }
-            if (myfScroll)
-                scrollRange(
-                    myWidth,
-                    index * myHeight);
-            update();
+            if (R.myTip != P.tooltip())
+            {
+                R.myLabel->tooltip(P.tooltip(), P.tooltipWidth());
+                R.myTip = P.tooltip();
+            }
+
+            // windex draws these itself, so they need repainting even if they have not moved
+            InvalidateRect(R.myLabel->handle(), NULL, true);
+            InvalidateRect(R.myCheckbox->handle(), NULL, true);
+            InvalidateRect(R.myCategory->handle(), NULL, true);
+            myfBinding = f;
+        }
+
+        /// Copy value from the row's editor widgets into the bound property
+        void save(sRow &R)
+        {
+            property *P = R.myProperty;
+            if (!P)
+                return;
+            bool f = myfBinding;
+            myfBinding = true;
+            switch (P->type())
+            {
+            case property::eType::choice:
+                if (R.myChoice->selectedIndex() >= 0)
+                    P->value(R.myChoice->selectedText());
+                break;
+            case property::eType::check:
+                P->value_bool(R.myCheckbox->isChecked());
+                break;
+            case property::eType::category:
+                break;
+            default:
+                P->value(R.myEditbox->text());
+                break;
+            }
+            myfBinding = f;
+        }
+
+        /// Copy value from editor widgets, if property is in view, into the model
+        void saveValue(property &P)
+        {
+            for (auto &R : myRow)
+                if (R.myProperty == &P)
+                    save(R);
+        }
+
+        /// Hide the row's widgets
+        void hideRow(sRow &R)
+        {
+            std::vector<int> hide;
+            defer(*R.myLabel, hide);
+            defer(*R.myEditbox, hide);
+            defer(*R.myChoice, hide);
+            defer(*R.myCheckbox, hide);
+            defer(*R.myCategory, hide);
+            R.myY = INT_MIN;
+            R.myfShown = false;
+        }
+
+        /// Grow the pool of editor rows
+        void pool(int count)
+        {
+            while ((int)myRow.size() < count)
+            {
+                int k = (int)myRow.size();
+                sRow R;
+                R.myLabel = &maker::make<label>(*this);
+                R.myEditbox = &maker::make<editbox>(*this);
+                R.myChoice = &maker::make<wex::choice>(*this);
+                R.myCheckbox = &maker::make<checkbox>(*this);
+                R.myCategory = &maker::make<checkbox>(*this);
+                R.myProperty = nullptr;
+                R.myChoiceOf = nullptr;
+                R.myY = INT_MIN;
+                R.myfShown = true;
+
+                R.myLabel->bgcolor(myBGColor);
+                R.myChoice->itemHeight(30);
+                R.myCheckbox->text("");
+                R.myCategory->plus();
+
+                // the handlers find the row by index, the pool vector may reallocate
+                R.myLabel->events().click(
+                    [this, k]
+                    {
+                        if (myRow[k].myProperty)
+                            onName(myRow[k].myProperty->name());
+                    });
+                R.myEditbox->events().change(
+                    R.myEditbox->id(),
+                    [this, k]
+                    { edited(k); });
+                R.myChoice->events().select(
+                    R.myChoice->id(),
+                    [this, k]
+                    { edited(k); });
+                R.myCheckbox->events().click(
+                    [this, k]
+                    { edited(k); });
+                R.myCategory->events().click(
+                    [this, k]
+                    {
+                        property *P = myRow[k].myProperty;
+                        if (P)
+                            P->expand(myRow[k].myCategory->isChecked());
+                    });
+
+                myRow.push_back(R);
+                tabList(myRow.back());
+                hideRow(myRow.back());
+            }
+        }
+
+        /// User has edited the property bound to row k
+        void edited(int k)
+        {
+            if (myfBinding)
+                return;
+            property *P = myRow[k].myProperty;
+            if (!P)
+                return;
+            save(myRow[k]);
+            P->onChange();
+            onChange();
+        }
+
+        void tabList(sRow &R)
+        {
+            auto s = GetWindowLongPtr(R.myEditbox->handle(), GWL_STYLE);
+            if (myftabstop)
+                s |= WS_TABSTOP;
+            else
+                s &= ~WS_TABSTOP;
+            SetWindowLongPtr(
+                R.myEditbox->handle(),
+                GWL_STYLE,
+                s);
+        }
+
+        /// pixels scrolled from top of grid
+        int scrollTop()
+        {
+            if (!myfScroll)
+                return 0;
+            SCROLLINFO si;
+            si.cbSize = sizeof(si);
+            si.fMask = SIF_POS;
+            if (!GetScrollInfo(myHandle, SB_VERT, &si))
+                return 0;
+            return si.nPos;
+        }
+
+        /// height of grid in pixels
+        int viewHeight()
+        {
+            RECT r;
+            GetClientRect(myHandle, &r);
+            return r.bottom - r.top;
         }
     };
 }
@@ -0,0 +1,1170 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cctype>
+#include <stdexcept>
+#include <exception>
+#ifdef windex_has_boost
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#endif
+
+/** @file propertymodel.h
+
+The properties displayed by a propertyGrid, without the windows.
+
+This header uses only the standard library ( and boost when windex_has_boost is defined )
+so it can be used by code that loads, validates and compares configurations
+on any platform, and shares it with the GUI.
+
+<pre>
+    wex::propertyModel M;
+    M.category("Serial");
+    M.string("Port", "COM3");
+    M.integer("Baud", 9600);
+    M.check("Flow control", false);
+
+    M.listen([](wex::property *p, wex::propertyModel::eChange c)
+             {
+                 if (c == wex::propertyModel::eChange::value)
+                     std::cout << p->name() << " is now " << p->value() << "\\n";
+             });
+
+    M.find("Serial", "Baud")->value("115200");
+</pre>
+*/
+
+namespace wex
+{
+    class propertyModel;
+
+    /// What has happened to a property model
+    enum class ePropertyChange
+    {
+        add,       ///< a property has been appended
+        value,     ///< a property value has changed
+        attribute, ///< a property tooltip, readonly flag or choices have changed
+        expand,    ///< a category has been expanded or collapsed, property is nullptr if several
+        clear,     ///< all properties have been removed, property is nullptr
+        load       ///< many properties have been appended at once, property is nullptr
+    };
+
+    /** A streaming JSON reader
+
+    Reads the JSON text in one pass, calling the handler for each value
+    as it is found, without building a tree.  The handler provides
+
+    <pre>
+        void begin(const std::string &key, bool fArray);   // start of object or array
+        void end();                                          // end of object or array
+        void scalar(const std::string &key, const std::string &value, bool fString);
+    </pre>
+
+    key is the member name, or "" for array elements and the top level value.
+    Numbers and the literals true, false and null are passed as their text.
+
+    Throws std::runtime_error if the JSON is not well formed.
+    */
+    class jsonReader
+    {
+    public:
+        template <class H>
+        static void read(const std::string &json, H &handler)
+        {
+            jsonReader R(json);
+            R.ws();
+            R.value(std::string(), handler);
+            R.ws();
+            if (R.myPos != R.myEnd)
+                R.error("unexpected text after value");
+        }
+
+    private:
+        const char *myBegin;
+        const char *myPos;
+        const char *myEnd;
+
+        jsonReader(const std::string &json)
+            : myBegin(json.data()),
+              myPos(json.data()),
+              myEnd(json.data() + json.size())
+        {
+        }
+
+        void error(const char *msg)
+        {
+            throw std::runtime_error(
+                "JSON error at offset " + std::to_string(myPos - myBegin) + ": " + msg);
+        }
+        void ws()
+        {
+            while (myPos != myEnd &&
+                   (*myPos == ' ' || *myPos == '\t' || *myPos == '\n' || *myPos == '\r'))
+                myPos++;
+        }
+        void expect(char c)
+        {
+            ws();
+            if (myPos == myEnd || *myPos != c)
+                error(std::string("expected ").append(1, c).c_str());
+            myPos++;
+        }
+
+        template <class H>
+        void value(const std::string &key, H &h)
+        {
+            if (myPos == myEnd)
+                error("unexpected end");
+            switch (*myPos)
+            {
+            case '{':
+            {
+                myPos++;
+                h.begin(key, false);
+                ws();
+                if (myPos != myEnd && *myPos == '}')
+                    myPos++;
+                else
+                {
+                    while (true)
+                    {
+                        ws();
+                        std::string member = string();
+                        expect(':');
+                        ws();
+                        value(member, h);
+                        ws();
+                        if (myPos != myEnd && *myPos == ',')
+                        {
+                            myPos++;
+                            continue;
+                        }
+                        expect('}');
+                        break;
+                    }
+                }
+                h.end();
+            }
+            break;
+
+            case '[':
+            {
+                myPos++;
+                h.begin(key, true);
+                ws();
+                if (myPos != myEnd && *myPos == ']')
+                    myPos++;
+                else
+                {
+                    while (true)
+                    {
+                        ws();
+                        value(std::string(), h);
+                        ws();
+                        if (myPos != myEnd && *myPos == ',')
+                        {
+                            myPos++;
+                            continue;
+                        }
+                        expect(']');
+                        break;
+                    }
+                }
+                h.end();
+            }
+            break;
+
+            case '"':
+                h.scalar(key, string(), true);
+                break;
+
+            default:
+            {
+                // number or literal
+                const char *start = myPos;
+                while (myPos != myEnd &&
+                       (isalnum((unsigned char)*myPos) || *myPos == '-' || *myPos == '+' || *myPos == '.'))
+                    myPos++;
+                std::string token(start, myPos);
+                if (token.empty())
+                    error("expected value");
+                if (isalpha((unsigned char)token[0]) &&
+                    token != "true" && token != "false" && token != "null")
+                    error("unknown literal");
+                h.scalar(key, token, false);
+            }
+            break;
+            }
+        }
+
+        /// read quoted string, with escapes decoded to UTF-8
+        std::string string()
+        {
+            if (myPos == myEnd || *myPos != '"')
+                error("expected string");
+            myPos++;
+            std::string ret;
+            while (true)
+            {
+                // copy run of plain characters
+                const char *start = myPos;
+                while (myPos != myEnd && *myPos != '"' && *myPos != '\\')
+                    myPos++;
+                ret.append(start, myPos);
+                if (myPos == myEnd)
+                    error("unterminated string");
+                if (*myPos++ == '"')
+                    return ret;
+                if (myPos == myEnd)
+                    error("unterminated string");
+                switch (*myPos++)
+                {
+                case '"':
+                    ret += '"';
+                    break;
+                case '\\':
+                    ret += '\\';
+                    break;
+                case '/':
+                    ret += '/';
+                    break;
+                case 'b':
+                    ret += '\b';
+                    break;
+                case 'f':
+                    ret += '\f';
+                    break;
+                case 'n':
+                    ret += '\n';
+                    break;
+                case 'r':
+                    ret += '\r';
+                    break;
+                case 't':
+                    ret += '\t';
+                    break;
+                case 'u':
+                {
+                    unsigned cp = hex4();
+                    if (cp >= 0xD800 && cp < 0xDC00 &&
+                        myEnd - myPos >= 6 && myPos[0] == '\\' && myPos[1] == 'u')
+                    {
+                        myPos += 2;
+                        unsigned lo = hex4();
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    }
+                    utf8(ret, cp);
+                }
+                break;
+                default:
+                    error("bad escape");
+                }
+            }
+        }
+        unsigned hex4()
+        {
+            if (myEnd - myPos < 4)
+                error("bad unicode escape");
+            unsigned v = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                char c = *myPos++;
+                v <<= 4;
+                if (c >= '0' && c <= '9')
+                    v += c - '0';
+                else if (c >= 'a' && c <= 'f')
+                    v += c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F')
+                    v += c - 'A' + 10;
+                else
+                    error("bad unicode escape");
+            }
+            return v;
+        }
+        static void utf8(std::string &s, unsigned cp)
+        {
+            if (cp < 0x80)
+                s += (char)cp;
+            else if (cp < 0x800)
+            {
+                s += (char)(0xC0 | (cp >> 6));
+                s += (char)(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000)
+            {
+                s += (char)(0xE0 | (cp >> 12));
+                s += (char)(0x80 | ((cp >> 6) & 0x3F));
+                s += (char)(0x80 | (cp & 0x3F));
+            }
+            else
+            {
+                s += (char)(0xF0 | (cp >> 18));
+                s += (char)(0x80 | ((cp >> 12) & 0x3F));
+                s += (char)(0x80 | ((cp >> 6) & 0x3F));
+                s += (char)(0x80 | (cp & 0x3F));
+            }
+        }
+    };
+
+    /// A name value pair
+    class property
+    {
+    public:
+        /// The value types, numbered as they are in the JSON type field
+        enum class eType
+        {
+            string,
+            choice,
+            check,
+            category,
+            integer,
+            real
+        };
+
+        /** construct a property
+        @param[in] name
+        @param[in] type
+        @param[in] value initial value, as text
+
+        Usually constructed by one of the propertyModel methods that add properties
+        */
+        property(
+            const std::string &name,
+            eType type,
+            const std::string &value = "")
+            : myName(name), myValue(value),
+              myType(type),
+              myfExpanded(type == eType::category)
+        {
+        }
+
+        /** Add pop help message when mouse hovers over property label
+        @param[in] tip the help message
+        @param[in] width of multiline tooltip, default single line
+        @return property reference
+    */
+        property &tooltip(const std::string &tip, int width = 0)
+        {
+            myTip = tip;
+            myTipWidth = width;
+            notify(ePropertyChange::attribute);
+            return *this;
+        }
+        const std::string &tooltip() const
+        {
+            return myTip;
+        }
+        int tooltipWidth() const
+        {
+            return myTipWidth;
+        }
+        /** Set property to be readonly
+        @param[in] f true if property should be readonly, default true
+        @return property reference
+
+        A property defaults to editable when constructed.
+    */
+        property &readonly(bool f = true)
+        {
+            myfReadonly = f;
+            notify(ePropertyChange::attribute);
+            return *this;
+        }
+        bool isReadonly() const
+        {
+            return myfReadonly;
+        }
+
+        const std::string &name() const
+        {
+            return myName;
+        }
+        eType type() const
+        {
+            return myType;
+        }
+        /// position in model
+        int index() const
+        {
+            return myIndex;
+        }
+        /// the strings a choice property can select from
+        const std::vector<std::string> &choices() const
+        {
+            return myChoice;
+        }
+        void choices(const std::vector<std::string> &choice)
+        {
+            myChoice = choice;
+            notify(ePropertyChange::attribute);
+        }
+
+        const std::string value() const
+        {
+            if (myType == eType::category)
+                return std::string("");
+            return myValue;
+        }
+        bool isChecked() const
+        {
+            return myType == eType::check && myValue == "1";
+        }
+        /// value of integer property, 0 if not a valid integer
+        long long integer() const
+        {
+            return std::strtoll(myValue.c_str(), nullptr, 10);
+        }
+        /// value of real property, 0 if not a valid number
+        double real() const
+        {
+            return std::strtod(myValue.c_str(), nullptr);
+        }
+
+        /** set property value
+        @param[in] v the new value, as text.  A check property takes "0" or "1"
+        @return property reference
+
+        The value is not validated, call isValid() for that.
+        Listeners are notified only if the value changes.
+    */
+        property &value(const std::string v)
+        {
+            if (myType == eType::category || v == myValue)
+                return *this;
+            myValue = v;
+            notify(ePropertyChange::value);
+            return *this;
+        }
+        void value_bool(bool v)
+        {
+            switch (myType)
+            {
+            case eType::check:
+                value(std::to_string((int)v));
+                break;
+            default:
+                // other property types ignore requests to change boolean vaue
+                break;
+            }
+        }
+        /// set value of integer property
+        void integer(long long v)
+        {
+            value(std::to_string(v));
+        }
+        /// set value of real property
+        void real(double v)
+        {
+            value(format(v));
+        }
+
+        /// Kept for compatibility, the value is stored as it is edited
+        void saveValue()
+        {
+        }
+
+        // get myValue attribute
+        const std::string savedValue() const
+        {
+            return myValue;
+        }
+
+        /// true if the value can be read as the property type
+        bool isValid() const
+        {
+            const char *s = myValue.c_str();
+            char *end;
+            switch (myType)
+            {
+            case eType::integer:
+                std::strtoll(s, &end, 10);
+                return !myValue.empty() && *end == '\0';
+            case eType::real:
+                std::strtod(s, &end);
+                return !myValue.empty() && *end == '\0';
+            case eType::check:
+                return myValue == "0" || myValue == "1";
+            case eType::choice:
+                if (myValue.empty())
+                    return true;
+                for (auto &c : myChoice)
+                    if (c == myValue)
+                        return true;
+                return false;
+            default:
+                return true;
+            }
+        }
+
+        /// true if values are equal, numerically for integer and real properties
+        bool isSameValue(const property &other) const
+        {
+            if (myType == other.myType && isValid() && other.isValid())
+            {
+                if (myType == eType::integer)
+                    return integer() == other.integer();
+                if (myType == eType::real)
+                    return real() == other.real();
+            }
+            return myValue == other.myValue;
+        }
+
+        bool isCategory() const
+        {
+            return myType == eType::category;
+        }
+        bool isExpanded() const
+        {
+            if (!isCategory())
+                return false;
+            return myfExpanded;
+        }
+        void expand(bool f)
+        {
+            if (!isCategory() || f == myfExpanded)
+                return;
+            myfExpanded = f;
+            notify(ePropertyChange::expand);
+        }
+        /// register function to call when user changes property value in a view
+        void change(std::function<void()> f)
+        {
+            myOnChange = f;
+        }
+        /// call function registered by change()
+        void onChange() const
+        {
+            if (myOnChange)
+                myOnChange();
+        }
+
+#ifdef windex_has_boost
+        void BoostPropertyTree(
+            boost::property_tree::ptree &tree,
+            const std::string &catname)
+            const
+        {
+            tree.put(
+                catname + myName + ".value",
+                myValue);
+            tree.put(
+                catname + myName + ".type",
+                std::to_string((int)myType));
+            if (myType == eType::choice)
+            {
+                for (int k = 0; k < (int)myChoice.size(); k++)
+                    tree.put(
+                        catname + myName + ".choice" + std::to_string(k),
+                        myChoice[k]);
+            }
+        }
+#endif
+
+    private:
+        friend class propertyModel;
+
+        std::string myName;
+        std::string myValue;
+        eType myType;
+        std::vector<std::string> myChoice;
+        std::string myTip;
+        int myTipWidth = 0;
+        bool myfReadonly = false;
+        bool myfExpanded;
+        std::function<void()> myOnChange;
+        propertyModel *myModel = nullptr; ///< model containing this property
+        int myIndex = -1;                 ///< position in model
+
+        void notify(ePropertyChange c);
+
+        static std::string format(double v)
+        {
+            std::ostringstream ss;
+            ss << std::setprecision(15) << v;
+            return ss.str();
+        }
+    };
+
+    /** A lookup key for propertyModel::find()
+
+    The names are hashed when the key is constructed,
+    so code that polls the same properties repeatedly
+    can construct the keys once and avoid hashing on every lookup.
+    */
+    struct propertyKey
+    {
+        std::string category;
+        std::string name;
+        std::size_t hash;
+
+        propertyKey(
+            const std::string &category,
+            const std::string &name)
+            : category(category), name(name)
+        {
+            std::size_t h = std::hash<std::string>()(category);
+            hash = h ^ (std::hash<std::string>()(name) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+        }
+        bool operator==(const propertyKey &other) const
+        {
+            return hash == other.hash &&
+                   name == other.name &&
+                   category == other.category;
+        }
+        /// hash function for unordered containers, returns the precomputed hash
+        struct hasher
+        {
+            std::size_t operator()(const propertyKey &k) const
+            {
+                return k.hash;
+            }
+        };
+    };
+
+    /// A difference between two property models
+    struct sPropertyDiff
+    {
+        enum class eKind
+        {
+            changed, ///< in both, with different values
+            removed, ///< only in the first model
+            added    ///< only in the other model
+        } kind;
+        std::string category;
+        std::string name;
+        std::string value;      ///< value in the first model
+        std::string otherValue; ///< value in the other model
+    };
+
+    /** An ordered list of properties, grouped by categories
+
+    A property belongs to the category most recently added before it.
+    Properties added before any category belong to the unnamed category "".
+    */
+    class propertyModel
+    {
+    public:
+        typedef std::shared_ptr<property> prop_t;
+
+        typedef ePropertyChange eChange;
+        typedef std::function<void(property *, eChange)> listener_t;
+
+        propertyModel() = default;
+
+        // listeners and back pointers belong to one model
+        propertyModel(const propertyModel &) = delete;
+        propertyModel &operator=(const propertyModel &) = delete;
+
+        /** Add string property
+        @param[in] name of property
+        @param[in] value initial value
+        @return reference to property
+    */
+        property &string(
+            const std::string &name,
+            const std::string &value)
+        {
+            return add(new property(name, property::eType::string, value));
+        }
+        /** Add choice property
+        @param[in] name of property
+        @param[in] choice vector of choices to be selected from
+        @return reference to property
+    */
+        property &choice(
+            const std::string &name,
+            const std::vector<std::string> &choice)
+        {
+            auto P = new property(name, property::eType::choice);
+            P->myChoice = choice;
+            return add(P);
+        }
+        /** Add boolean property
+        @param[in] name of property
+        @param[in] f default
+        @return reference to property
+    */
+        property &check(
+            const std::string &name,
+            bool f)
+        {
+            return add(new property(name, property::eType::check, std::to_string((int)f)));
+        }
+        /// Add integer property
+        property &integer(
+            const std::string &name,
+            long long v)
+        {
+            return add(new property(name, property::eType::integer, std::to_string(v)));
+        }
+        /// Add real number property
+        property &real(
+            const std::string &name,
+            double v)
+        {
+            return add(new property(name, property::eType::real, property::format(v)));
+        }
+        /// Add category
+        property &category(
+            const std::string &name)
+        {
+            return add(new property(name, property::eType::category));
+        }
+
+        /// Remove all properties
+        void clear()
+        {
+            myProperty.clear();
+            myNameIndex.clear();
+            myKeyIndex.clear();
+            myCategoryIndex.clear();
+            myCategory.clear();
+            myfFirstCategory = true;
+            notify(nullptr, eChange::clear);
+        }
+
+        int size() const
+        {
+            return (int)myProperty.size();
+        }
+        property &operator[](int index)
+        {
+            return *myProperty[index];
+        }
+        const property &operator[](int index) const
+        {
+            return *myProperty[index];
+        }
+        std::vector<prop_t>::const_iterator begin() const
+        {
+            return myProperty.begin();
+        }
+        std::vector<prop_t>::const_iterator end() const
+        {
+            return myProperty.end();
+        }
+
+        /// get pointer to first property with name, nullptr if none
+        property *find(const std::string &name)
+        {
+            auto it = myNameIndex.find(name);
+            if (it == myNameIndex.end())
+                return nullptr;
+            return it->second;
+        }
+
+        /** get pointer to first property with name in a category, nullptr if none
+        @param[in] category name, "" for properties added before the first category
+        @param[in] name of property
+
+        When two categories have the same name, only the first is searched.
+    */
+        property *find(
+            const std::string &category,
+            const std::string &name)
+        {
+            return find(propertyKey(category, name));
+        }
+
+        /// get pointer to property with precomputed key, nullptr if none
+        property *find(const propertyKey &key)
+        {
+            auto it = myKeyIndex.find(key);
+            if (it == myKeyIndex.end())
+                return nullptr;
+            return it->second;
+        }
+
+        /// get pointer to first category with name, nullptr if none
+        property *findCategory(const std::string &name)
+        {
+            auto it = myCategoryIndex.find(name);
+            if (it == myCategoryIndex.end())
+                return nullptr;
+            return it->second;
+        }
+
+        /// Expand, or collapse, every category
+        void expandAll(bool fexpand = true)
+        {
+            for (auto &p : myProperty)
+                if (p->isCategory())
+                    p->myfExpanded = fexpand;
+            notify(nullptr, eChange::expand);
+        }
+
+        /// properties whose values cannot be read as their type
+        std::vector<property *> invalid()
+        {
+            std::vector<property *> ret;
+            for (auto &p : myProperty)
+                if (!p->isValid())
+                    ret.push_back(p.get());
+            return ret;
+        }
+
+        /** Compare with another model
+        @param[in] other model
+        @return differences, properties matched by category and name
+
+        Categories themselves are not compared, only the properties they contain.
+    */
+        std::vector<sPropertyDiff> diff(const propertyModel &other) const
+        {
+            std::vector<sPropertyDiff> ret;
+            auto mine = keyed();
+            auto theirs = other.keyed();
+            for (auto &m : mine)
+            {
+                auto t = theirs.find(m.first);
+                if (t == theirs.end())
+                    ret.push_back({sPropertyDiff::eKind::removed,
+                                   m.first.first, m.first.second,
+                                   m.second->value(), ""});
+                else if (!m.second->isSameValue(*t->second))
+                    ret.push_back({sPropertyDiff::eKind::changed,
+                                   m.first.first, m.first.second,
+                                   m.second->value(), t->second->value()});
+            }
+            for (auto &t : theirs)
+                if (mine.find(t.first) == mine.end())
+                    ret.push_back({sPropertyDiff::eKind::added,
+                                   t.first.first, t.first.second,
+                                   "", t.second->value()});
+            return ret;
+        }
+
+        /** Register function to call when the model changes
+        @param[in] f function, passed the property that changed and what happened to it
+
+        Views register here to keep their display in step with the model.
+    */
+        void listen(listener_t f)
+        {
+            myListener.push_back(f);
+        }
+
+#ifdef windex_has_boost
+        /** Add properties from boost property tree
+        @param[in] pt property tree
+
+        Top level becomes categories
+        Second level becomes properties
+    */
+        void add(boost::property_tree::ptree &pt)
+        {
+            sBulk bulk(*this);
+
+            // loop over categories
+            for (auto cat : pt)
+            {
+                category(cat.first);
+
+                // loop over properties in category
+                for (auto prop : cat.second)
+                {
+                    std::string path = cat.first + "." + prop.first + ".";
+                    int type = pt.get<int>(path + "type", 0);
+
+                    switch ((property::eType)type)
+                    {
+                    case property::eType::choice:
+                    {
+                        std::vector<std::string> vc;
+                        for (auto ch : prop.second)
+                        {
+                            if (ch.first.find("choice") == 0)
+                            {
+                                vc.push_back(ch.second.data());
+                            }
+                        }
+                        choice(prop.first, vc).value(pt.get<std::string>(path + "value"));
+                    }
+                    break;
+
+                    case property::eType::check:
+                        check(prop.first, pt.get<std::string>(path + "value", "0") == "1");
+                        break;
+
+                    case property::eType::integer:
+                        integer(prop.first, 0).value(pt.get<std::string>(path + "value", "missing"));
+                        break;
+
+                    case property::eType::real:
+                        real(prop.first, 0).value(pt.get<std::string>(path + "value", "missing"));
+                        break;
+
+                    default:
+                        string(
+                            prop.first,
+                            pt.get<std::string>(path + "value", "missing"));
+                        break;
+                    }
+                }
+            }
+        }
+
+        /// Get properties as a boost property tree
+        boost::property_tree::ptree
+        BoostPropertyTree() const
+        {
+            boost::property_tree::ptree tree;
+            std::string catname;
+            for (auto &p : myProperty)
+            {
+                if (p->isCategory())
+                {
+                    catname = p->name() + ".";
+                }
+                else
+                {
+                    p->BoostPropertyTree(tree, catname);
+                }
+            }
+            return tree;
+        }
+
+        /// Get properties as a JSON string
+        std::string json() const
+        {
+            std::stringstream ss;
+            write_json(ss, BoostPropertyTree());
+            return ss.str();
+        }
+#endif
+
+        /** Add properties from a JSON string
+        @param[in] json string
+
+        The JSON has the layout written by json()
+        <pre>
+        { "category": { "name": { "type": 0, "value": "text" }, ... }, ... }
+        </pre>
+        A property may also be given as "name": value, which adds a string property.
+        Every top level member must be a category object.
+
+        The text is read in one pass by jsonReader, without boost,
+        and listeners get a single load notification when all the properties have been added.
+
+        Throws std::runtime_error if format error in JSON.
+        Nothing is added then, and listeners are not notified.
+    */
+        void addjson(const std::string &json)
+        {
+            sBulk bulk(*this);
+            sJSONLoader loader(*this);
+            jsonReader::read(json, loader);
+        }
+
+    private:
+        friend class property;
+
+        std::vector<prop_t> myProperty;
+        std::vector<listener_t> myListener;
+
+        // indices, first property wins when names are repeated
+        std::unordered_map<std::string, property *> myNameIndex;
+        std::unordered_map<propertyKey, property *, propertyKey::hasher> myKeyIndex;
+        std::unordered_map<std::string, property *> myCategoryIndex;
+        std::string myCategory = "";   // category properties are being added to
+        bool myfFirstCategory = true; // false if myCategory repeats an earlier category name
+        int myBulk = 0;                // depth of bulk loads in progress, add notifications held back
+
+        /** Hold back add notifications until destroyed, then send one load notification
+
+        If destroyed by an exception, the properties added are removed instead
+        and there is no notification, so a failed load leaves the model as it was.
+        */
+        struct sBulk
+        {
+            propertyModel &M;
+            int size;
+            std::string category;
+            bool fFirstCategory;
+            int exceptions;
+            sBulk(propertyModel &m)
+                : M(m),
+                  size(m.size()),
+                  category(m.myCategory),
+                  fFirstCategory(m.myfFirstCategory),
+                  exceptions(std::uncaught_exceptions())
+            {
+                M.myBulk++;
+            }
+            ~sBulk()
+            {
+                M.myBulk--;
+                if (std::uncaught_exceptions() > exceptions)
+                    M.truncate(size, category, fFirstCategory);
+                else if (M.myBulk == 0)
+                    M.notify(nullptr, eChange::load);
+            }
+        };
+
+        /// jsonReader handler that adds the properties read
+        struct sJSONLoader
+        {
+            propertyModel &M;
+            int depth = 0;
+            std::string name;
+            int type = 0;
+            std::string value;
+            bool fValue = false;
+            std::vector<std::string> choice;
+
+            sJSONLoader(propertyModel &m) : M(m)
+            {
+            }
+            void begin(const std::string &key, bool)
+            {
+                depth++;
+                if (depth == 2)
+                    M.category(key);
+                else if (depth == 3)
+                {
+                    name = key;
+                    type = 0;
+                    value.clear();
+                    fValue = false;
+                    choice.clear();
+                }
+            }
+            void end()
+            {
+                if (depth == 3)
+                    add();
+                depth--;
+            }
+            void scalar(const std::string &key, const std::string &v, bool)
+            {
+                switch (depth)
+                {
+                case 1:
+                    throw std::runtime_error(
+                        "JSON error: top level member \"" + key + "\" is not a category");
+                case 2:
+                    M.string(key, v);
+                    break;
+                case 3:
+                    if (key == "type")
+                        type = std::atoi(v.c_str());
+                    else if (key == "value")
+                    {
+                        if (!fValue)
+                            value = v;
+                        fValue = true;
+                    }
+                    else if (key.find("choice") == 0)
+                        choice.push_back(v);
+                    break;
+                default:
+                    break;
+                }
+            }
+            void add()
+            {
+                switch ((property::eType)type)
+                {
+                case property::eType::choice:
+                {
+                    auto P = new property(name, property::eType::choice, value);
+                    P->myChoice.swap(choice);
+                    M.add(P);
+                }
+                break;
+                case property::eType::check:
+                    M.check(name, value == "1" || value == "true");
+                    break;
+                case property::eType::integer:
+                case property::eType::real:
+                    M.add(new property(name, (property::eType)type, fValue ? value : "missing"));
+                    break;
+                default:
+                    M.string(name, fValue ? value : "missing");
+                    break;
+                }
+            }
+        };
+
+        property &add(property *P)
+        {
+            P->myModel = this;
+            P->myIndex = (int)myProperty.size();
+            myProperty.push_back(prop_t(P));
+            myNameIndex.emplace(P->name(), P);
+            if (P->isCategory())
+            {
+                myCategory = P->name();
+                myfFirstCategory = myCategoryIndex.emplace(P->name(), P).second;
+            }
+            else if (myfFirstCategory)
+                myKeyIndex.emplace(propertyKey(myCategory, P->name()), P);
+            if (!myBulk)
+                notify(P, eChange::add);
+            return *P;
+        }
+
+        /// remove the properties added after the first size, and restore the category being added to
+        void truncate(int size, const std::string &category, bool fFirstCategory)
+        {
+            std::string cat = category;
+            for (int k = size; k < (int)myProperty.size(); k++)
+            {
+                property *P = myProperty[k].get();
+                auto n = myNameIndex.find(P->name());
+                if (n != myNameIndex.end() && n->second == P)
+                    myNameIndex.erase(n);
+                if (P->isCategory())
+                {
+                    cat = P->name();
+                    auto c = myCategoryIndex.find(cat);
+                    if (c != myCategoryIndex.end() && c->second == P)
+                        myCategoryIndex.erase(c);
+                }
+                else
+                {
+                    auto key = myKeyIndex.find(propertyKey(cat, P->name()));
+                    if (key != myKeyIndex.end() && key->second == P)
+                        myKeyIndex.erase(key);
+                }
+            }
+            myProperty.resize(size);
+            myCategory = category;
+            myfFirstCategory = fFirstCategory;
+        }
+
+        void notify(property *P, eChange c)
+        {
+            for (auto &f : myListener)
+                f(P, c);
+        }
+
+        /// properties, not categories, keyed by category and name
+        std::map<std::pair<std::string, std::string>, const property *> keyed() const
+        {
+            std::map<std::pair<std::string, std::string>, const property *> ret;
+            std::string cat;
+            for (auto &p : myProperty)
+            {
+                if (p->isCategory())
+                    cat = p->name();
+                else
+                    ret.insert(std::make_pair(std::make_pair(cat, p->name()), p.get()));
+            }
+            return ret;
+        }
+    };
+
+    inline void property::notify(ePropertyChange c)
+    {
+        if (myModel)
+            myModel->notify(this, c);
+    }
+}
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include "tablemodel.h"
+
 namespace wex
 {
 
@@ -6,6 +9,16 @@ namespace wex
      * The values are displayed in rows of columns.
      * The first column is assumed to be the row index.
      * The row index is returned when the row is clicked.
+     *
+     * The rows are pulled from a tableProvider, through a cache,
+     * only when they are scrolled into view.
+     * set() stores the values in a provider,
+     * provider() connects the table to application code that fetches rows on demand,
+     * or to a tableColumnProvider holding typed columns.
+     *
+     * Rows are rowHeight() pixels high.  scroll() adds a scrollbar
+     * which, like the mouse wheel, scrolls by pixel.  Only the rows
+     * scrolled into view are drawn, the rest are moved by blitting.
      * 
      * Usage:
      <pre>
@@ -15,6 +28,7 @@ namespace wex
         table &table1 = maker::make<table>(form);
         table1.move(10, 10, 350, 100);
         table1.set(table1data);
+        table1.scroll();
         form.events().asyncReadComplete(
         [&](int id)
         {
@@ -28,8 +42,11 @@ namespace wex
     public:
         table(gui *parent)
             : gui(parent),
-              myRowDisplayCount(25),
-              myRowStart(0)
+              myRowHeight(20),
+              myTop(0),
+              myfScroll(false),
+              myScrollMax(-1),
+              myScrollPage(-1)
         {
             registerEventHandlers();
             text("");
@@ -40,9 +57,9 @@ namespace wex
          * 
          * @param val 2D vector of values.  The inner vector contains the column value of one row
          */
-        void set(const std::vector<std::vector<std::string>> &val)
+        void set(std::vector<std::vector<std::string>> val)
         {
-            myContents = val;
+            provider(std::make_shared<tableVectorProvider>(std::move(val)));
         }
         /**
          * @brief Set table values
@@ -50,98 +67,199 @@ namespace wex
          * @param val     1D vector of values, column by column
          * @param colcount count of columns in a row
          */
-        void set(const std::vector<std::string> &val, int colcount)
+        void set(std::vector<std::string> val, int colcount)
         {
-            std::vector<std::vector<std::string>> vvs;
-            for (
-                int row = 0;
-                row < val.size() / colcount;
-                row++)
-            {
-                std::vector<std::string> vrow;
-                for (int col = 0; col < colcount; col++)
+            provider(std::make_shared<tableFlatProvider>(std::move(val), colcount));
+        }
+        /**
+         * @brief Set source of table rows
+         *
+         * @param p provider, fetches the rows as they are scrolled into view
+         */
+        void provider(std::shared_ptr<tableProvider> p)
+        {
+            myCache.provider(p);
+            myTop = 0;
+            myScrollMax = -1;
+            scrollRange();
+            update();
+        }
+        /// @brief Discard cached rows, call after the provider's rows change
+        void refresh()
+        {
+            myCache.clear();
+            fit();
+            update();
+        }
+        /// @brief Set maximum number of formatted rows cached
+        void cacheSize(int rows)
+        {
+            myCache.capacity(rows);
+        }
+        /**
+         * @brief Enable background prefetch of rows about to be scrolled into view
+         *
+         * The provider's fetch() is then called from a second thread,
+         * so must be safe to call concurrently
+         */
+        void prefetch(bool f = true)
+        {
+            myCache.prefetch(f);
+        }
+
+        /// @brief Set height of each row, in pixels
+        void rowHeight(int h)
+        {
+            int row = myTop / myRowHeight;
+            myRowHeight = std::max(1, h);
+            myTop = row * myRowHeight;
+            fit();
+            update();
+        }
+        int rowHeight() const
+        {
+            return myRowHeight;
+        }
+
+        /**
+         * @brief Add vertical scrollbar
+         *
+         * The table scrolls by pixel, from the scrollbar or the mouse wheel.
+         */
+        void scroll()
+        {
+            myfScroll = true;
+            gui::scroll(false);
+
+            // replace the scroll handler, which moves child windows,
+            // by one that scrolls the rows
+            events().scrollV(
+                [this](int code)
                 {
-                    // if (col == 0)
-                    //     vrow.push_back(
-                    //         val[row * colcount + col] + " " + val[row * colcount + col + 1]);
-                    // else if (col == 1)
-                    //     continue;
-                    // else
-                        vrow.push_back(val[row * colcount + col]);
-                }
-                vvs.push_back(vrow);
+                    SCROLLINFO si;
+                    si.cbSize = sizeof(si);
+                    si.fMask = SIF_POS | SIF_TRACKPOS | SIF_PAGE;
+                    if (!GetScrollInfo(myHandle, SB_VERT, &si))
+                        return;
+                    switch (code)
+                    {
+                    case SB_LINEUP:
+                        si.nPos -= myRowHeight;
+                        break;
+                    case SB_LINEDOWN:
+                        si.nPos += myRowHeight;
+                        break;
+                    case SB_PAGEUP:
+                        si.nPos -= si.nPage;
+                        break;
+                    case SB_PAGEDOWN:
+                        si.nPos += si.nPage;
+                        break;
+                    case SB_THUMBTRACK:
+                        si.nPos = si.nTrackPos;
+                        break;
+                    default:
+                        return;
+                    }
+                    scrollTo(si.nPos);
+                });
+            scrollRange();
+        }
+
+        /**
+         * @brief Scroll so a pixel is at the top of the window
+         *
+         * @param top pixels from top of first row
+         *
+         * Rows still in view are moved by blitting, only the rows exposed are redrawn.
+         */
+        void scrollTo(int top)
+        {
+            top = std::max(0, std::min(top, maxTop()));
+            int dy = myTop - top;
+            if (!dy)
+                return;
+            myTop = top;
+            if (myfScroll)
+            {
+                SCROLLINFO si;
+                si.cbSize = sizeof(si);
+                si.fMask = SIF_POS;
+                si.nPos = myTop;
+                SetScrollInfo(myHandle, SB_VERT, &si, TRUE);
             }
-            set(vvs);
+            if (std::abs(dy) < viewHeight())
+                ScrollWindowEx(
+                    myHandle, 0, dy,
+                    NULL, NULL, NULL, NULL,
+                    SW_INVALIDATE | SW_ERASE);
+            else
+                InvalidateRect(myHandle, NULL, TRUE);
+            UpdateWindow(myHandle);
+        }
+        /// @brief pixels scrolled from top of first row
+        int scrollTop() const
+        {
+            return myTop;
         }
 
         /// @brief Move display window
         /// @param i increment for row to display at top of window
         void rowInc(int i)
         {
-            myRowStart += i;
-            if (myRowStart < 0)
-                myRowStart = 0;
+            scrollTo(myTop + i * myRowHeight);
         }
 
         void rowLastDisplay()
         {
-            myRowStart = myContents.size() - 1;
+            scrollTo(maxTop());
         }
 
     private:
-        std::vector<std::vector<std::string>> myContents;
-        std::vector<int> myRowID;
-        int myRowDisplayCount;
-        int myRowStart;
+        tableRowCache myCache;
+        int myRowHeight; // pixels
+        int myTop;       // pixels scrolled from top of first row
+        bool myfScroll;
+        int myScrollMax; // scrollbar range as last set
+        int myScrollPage;
 
-        void draw(shapes &S)
+        void draw(PAINTSTRUCT &ps)
         {
-            myRowID.clear();
-
-            if (!myContents.size())
+            if (!myCache.rowCount())
                 return;
 
-            int colCount = myContents[0].size();
+            int colCount = myCache.colCount();
             int colWidth;
-            if( colCount <= 1 )
+            if (colCount <= 1)
                 colWidth = size()[0];
             else
                 colWidth = size()[0] / (colCount - 1);
-            int rowStop;
-            if (myContents.size() < 20)
-            {
-                myRowStart = 0;
-                rowStop = myContents.size();
-            }
-            else
-            {
-                if (myRowStart > myContents.size() - 20)
-                    myRowStart = myContents.size() - 20;
-                rowStop = myRowStart + 30;
-                if (rowStop > myContents.size())
-                    rowStop = myContents.size();
-            }
-            // std::cout << "row " << myRowStart << " to " << myRowStart + rowStop - 1
-            //           << " from " << myContents.size() << "\n";
-            for (int kr = myRowStart; kr < rowStop; kr++)
+
+            // fetch only the rows that need painting
+            int first = (myTop + ps.rcPaint.top) / myRowHeight;
+            int last = (myTop + ps.rcPaint.bottom - 1) / myRowHeight;
+            auto rows = myCache.range(first, last - first + 1);
+
+            wex::shapes S(ps);
+            for (int kr = first; kr < first + (int)rows.size(); kr++)
             {
-                if (myContents[kr].size() > colCount)
+                // the provider may return fewer rows than it counted
+                if (!rows[kr - first])
+                    break;
+                auto &row = *rows[kr - first];
+                if ((int)row.cell.size() > colCount)
                     throw std::runtime_error(
                         "bad col count");
 
-                for (int kc = 0; kc < colCount; kc++)
+                int y = kr * myRowHeight - myTop;
+                for (int kc = 0; kc < (int)row.cell.size(); kc++)
                 {
-                    auto &val = myContents[kr][kc];
+                    auto &val = row.cell[kc];
                     int x, w;
                     if (kc == 0)
                     {
                         x = 0;
                         w = 50;
-
-                        // save the database ID of the row
-                        // so it can be sent if the row is double clicked
-                        // assumes first column contains the db id
-                        myRowID.push_back(atoi(val.c_str()));
                     }
                     else
                     {
@@ -150,30 +268,91 @@ namespace wex
                     }
                     S.text(
                         val,
-                        {x, (kr - myRowStart) * 20,
-                         w - 5, 20});
-                    S.line({x + w - 1, (kr - myRowStart) * 20,
-                            x + w - 1, (kr - myRowStart + 1) * 20});
+                        {x, y,
+                         w - 5, myRowHeight});
+                    S.line({x + w - 1, y,
+                            x + w - 1, y + myRowHeight});
                 }
             }
         }
 
+        /// height of window in pixels
+        int viewHeight()
+        {
+            RECT r;
+            GetClientRect(myHandle, &r);
+            return r.bottom - r.top;
+        }
+
+        /// largest scroll that leaves no gap below the last row
+        int maxTop()
+        {
+            return std::max(0, myCache.rowCount() * myRowHeight - viewHeight());
+        }
+
+        /// fit scrollbar to rows and window, if either changed
+        void scrollRange()
+        {
+            if (!myfScroll)
+                return;
+            int max = std::max(0, myCache.rowCount() * myRowHeight - 1);
+            int page = viewHeight();
+            if (max == myScrollMax && page == myScrollPage)
+                return;
+            myScrollMax = max;
+            myScrollPage = page;
+            SCROLLINFO si;
+            si.cbSize = sizeof(si);
+            si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+            si.nMin = 0;
+            si.nMax = max;
+            si.nPage = page;
+            si.nPos = myTop;
+            SetScrollInfo(myHandle, SB_VERT, &si, TRUE);
+        }
+
+        /// fit scrollbar and scroll position to rows and window, outside of painting
+        void fit()
+        {
+            scrollRange();
+            scrollTo(myTop);
+        }
+
         void registerEventHandlers()
         {
+            events().resize(
+                [this](int w, int h)
+                {
+                    fit();
+                    update();
+                });
+
             events().draw(
                 [&](PAINTSTRUCT &ps)
                 {
-                    wex::shapes S(ps);
-                    draw(S);
+                    draw(ps);
+                });
+
+            events().mouseWheel(
+                [this](int dist)
+                {
+                    // three rows per notch
+                    scrollTo(myTop - dist * 3 * myRowHeight / 120);
                 });
 
             events().click(
                 [this]
                 {
+                    int row = (myTop + getMouseStatus().y) / myRowHeight;
+                    if (row < 0 || row >= myCache.rowCount())
+                        return;
+                    auto r = myCache.row(row);
+                    if (!r)
+                        return;
                     PostMessageA(
                         myParent->handle(),
                         wex::eventMsgID::asyncReadComplete,
-                        myRowID[getMouseStatus().y / 20],
+                        (WPARAM)r->id,
                         0);
                 });
         }
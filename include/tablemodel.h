@@ -0,0 +1,1037 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <stdexcept>
+#include <functional>
+#include <cmath>
+#include <cstring>
+
+/** @file tablemodel.h
+
+The rows displayed by a wex::table, without the windows.
+
+A table pulls its rows from a tableProvider, through a tableRowCache,
+so only the rows scrolled into view are ever fetched and formatted.
+Large numeric tables are best stored in a tableColumnProvider,
+which keeps typed columns and formats a cell only when it is displayed.
+
+<pre>
+    // rows from a query, fetched as they are needed
+    class cQueryRows : public wex::tableProvider
+    {
+    public:
+        int rowCount() override { return myQuery.count(); }
+        int colCount() override { return 4; }
+        void fetch(int first, int count, std::vector<wex::tableRow> &rows) override
+        {
+            for (auto &r : myQuery.rows(first, count))
+                rows.push_back({r.id, {std::to_string(r.id), r.name, r.city, r.phone}});
+        }
+    };
+    table.provider(std::make_shared<cQueryRows>());
+</pre>
+*/
+
+namespace wex
+{
+    /// A formatted row, ready to display
+    struct tableRow
+    {
+        long long id;                  ///< row ID, returned when the row is clicked
+        std::vector<std::string> cell; ///< formatted values, the first is the row ID
+    };
+
+    /** Source of the rows displayed by a table
+
+    The first column is the row ID.
+    */
+    class tableProvider
+    {
+    public:
+        virtual ~tableProvider() {}
+
+        virtual int rowCount() = 0;
+        virtual int colCount() = 0;
+
+        /** Fetch formatted rows
+        @param[in] first index of first row
+        @param[in] count of rows, all in range
+        @param[out] rows the rows fetched are appended here
+
+        If the row cache prefetches, this is called from the prefetch thread too,
+        so it must be safe to call concurrently.
+        */
+        virtual void fetch(int first, int count, std::vector<tableRow> &rows) = 0;
+    };
+
+    /** Rows stored as strings, row by row
+
+    The row ID is read from the first column, once, when the row is fetched.
+    */
+    class tableVectorProvider : public tableProvider
+    {
+    public:
+        tableVectorProvider(std::vector<std::vector<std::string>> val)
+            : myContents(std::move(val))
+        {
+        }
+        int rowCount() override
+        {
+            return (int)myContents.size();
+        }
+        int colCount() override
+        {
+            if (!myContents.size())
+                return 0;
+            return (int)myContents[0].size();
+        }
+        void fetch(int first, int count, std::vector<tableRow> &rows) override
+        {
+            for (int r = first; r < first + count; r++)
+            {
+                auto &v = myContents[r];
+                rows.push_back({v.size() ? std::atoll(v[0].c_str()) : 0, v});
+            }
+        }
+
+    private:
+        std::vector<std::vector<std::string>> myContents;
+    };
+
+    /** Rows stored as strings in one vector, row after row
+
+    Avoids the copy to a vector of rows.
+    */
+    class tableFlatProvider : public tableProvider
+    {
+    public:
+        tableFlatProvider(std::vector<std::string> val, int colcount)
+            : myContents(std::move(val)), myColCount(colcount)
+        {
+        }
+        int rowCount() override
+        {
+            if (myColCount <= 0)
+                return 0;
+            return (int)(myContents.size() / myColCount);
+        }
+        int colCount() override
+        {
+            return myColCount;
+        }
+        void fetch(int first, int count, std::vector<tableRow> &rows) override
+        {
+            for (int r = first; r < first + count; r++)
+            {
+                auto b = myContents.begin() + (size_t)r * myColCount;
+                rows.push_back({std::atoll(b->c_str()),
+                                std::vector<std::string>(b, b + myColCount)});
+            }
+        }
+
+    private:
+        std::vector<std::string> myContents;
+        int myColCount;
+    };
+
+    /** Rows stored column by column, as typed values
+
+    Each column is a vector of one type:
+    64 bit integers, doubles, or strings encoded as indices into a dictionary
+    of the distinct strings.  Numbers take 8 bytes a cell, instead of a string,
+    and are formatted only when their row is fetched for display.
+
+    The row IDs are stored as integers and displayed as the first column,
+    so column 0 is the row ID and the columns added are numbered from 1.
+    If no IDs are set, the row index is the row ID.
+
+    All columns must have the same length.  Do not change the columns
+    while a table with prefetch enabled is displaying them.
+
+    <pre>
+        auto P = std::make_shared<wex::tableColumnProvider>();
+        P->ids(id);
+        P->textColumn(name);
+        P->realColumn(price, 2);
+        table.provider(P);
+    </pre>
+    */
+    class tableColumnProvider : public tableProvider
+    {
+    public:
+        enum class eType
+        {
+            int64,
+            real,
+            text
+        };
+
+        tableColumnProvider()
+            : myRowCount(-1)
+        {
+        }
+
+        /// Set the row IDs
+        void ids(std::vector<long long> id)
+        {
+            length(id.size());
+            myID = std::move(id);
+        }
+
+        /// Add column of integers, returns column index
+        int int64Column(std::vector<long long> v)
+        {
+            length(v.size());
+            myColumn.emplace_back(eType::int64);
+            myColumn.back().myInt = std::move(v);
+            return (int)myColumn.size();
+        }
+
+        /** Add column of doubles, returns column index
+        @param[in] v the values
+        @param[in] precision digits displayed after the decimal point
+        */
+        int realColumn(std::vector<double> v, int precision = 2)
+        {
+            length(v.size());
+            myColumn.emplace_back(eType::real);
+            myColumn.back().myReal = std::move(v);
+            myColumn.back().myPrecision = precision;
+            return (int)myColumn.size();
+        }
+
+        /// Add column of strings, stored once each in a dictionary, returns column index
+        int textColumn(const std::vector<std::string> &v)
+        {
+            length(v.size());
+            myColumn.emplace_back(eType::text);
+            auto &c = myColumn.back();
+            c.myCode.reserve(v.size());
+            std::unordered_map<std::string, int> lookup;
+            for (auto &s : v)
+            {
+                auto it = lookup.find(s);
+                if (it == lookup.end())
+                {
+                    it = lookup.emplace(s, (int)c.myDict.size()).first;
+                    c.myDict.push_back(s);
+                }
+                c.myCode.push_back(it->second);
+            }
+            return (int)myColumn.size();
+        }
+
+        /** Add column of strings already dictionary encoded, returns column index
+        @param[in] code index into dict of each value
+        @param[in] dict the distinct strings
+        */
+        int textColumn(std::vector<int> code, std::vector<std::string> dict)
+        {
+            length(code.size());
+            for (int k : code)
+                if (k < 0 || k >= (int)dict.size())
+                    throw std::runtime_error(
+                        "tableColumnProvider text code out of dictionary");
+            myColumn.emplace_back(eType::text);
+            myColumn.back().myCode = std::move(code);
+            myColumn.back().myDict = std::move(dict);
+            return (int)myColumn.size();
+        }
+
+        int rowCount() override
+        {
+            return std::max(0, myRowCount);
+        }
+        int colCount() override
+        {
+            return 1 + (int)myColumn.size();
+        }
+
+        /// type of column, the row ID column is int64
+        eType type(int col) const
+        {
+            if (col == 0)
+                return eType::int64;
+            return myColumn[col - 1].myType;
+        }
+        long long id(int row) const
+        {
+            if (myID.size())
+                return myID[row];
+            return row;
+        }
+        long long int64(int row, int col) const
+        {
+            if (col == 0)
+                return id(row);
+            return myColumn[col - 1].myInt[row];
+        }
+        double real(int row, int col) const
+        {
+            return myColumn[col - 1].myReal[row];
+        }
+        /// index of text value in column dictionary
+        int code(int row, int col) const
+        {
+            return myColumn[col - 1].myCode[row];
+        }
+        const std::string &text(int row, int col) const
+        {
+            auto &c = myColumn[col - 1];
+            return c.myDict[c.myCode[row]];
+        }
+        /// distinct strings in text column
+        const std::vector<std::string> &dictionary(int col) const
+        {
+            return myColumn[col - 1].myDict;
+        }
+
+        /// cell value, formatted for display
+        std::string format(int row, int col) const
+        {
+            switch (type(col))
+            {
+            case eType::int64:
+                return std::to_string(int64(row, col));
+            case eType::real:
+            {
+                char buf[64];
+                double v = real(row, col);
+                int n = std::snprintf(buf, sizeof(buf), "%.*f",
+                                      myColumn[col - 1].myPrecision, v);
+                if (n < 0 || n >= (int)sizeof(buf))
+                    std::snprintf(buf, sizeof(buf), "%g", v);
+                return buf;
+            }
+            case eType::text:
+                return text(row, col);
+            }
+            return "";
+        }
+
+        void fetch(int first, int count, std::vector<tableRow> &rows) override
+        {
+            int cols = colCount();
+            for (int r = first; r < first + count; r++)
+            {
+                tableRow row{id(r), std::vector<std::string>(cols)};
+                for (int c = 0; c < cols; c++)
+                    row.cell[c] = format(r, c);
+                rows.push_back(std::move(row));
+            }
+        }
+
+    private:
+        struct sColumn
+        {
+            eType myType;
+            int myPrecision;
+            std::vector<long long> myInt;
+            std::vector<double> myReal;
+            std::vector<int> myCode;
+            std::vector<std::string> myDict;
+
+            sColumn(eType t)
+                : myType(t), myPrecision(0)
+            {
+            }
+        };
+        std::vector<long long> myID; // empty if the row index is the row ID
+        std::vector<sColumn> myColumn;
+        int myRowCount; // -1 until the first column or IDs are set
+
+        /// check length of new column
+        void length(size_t n)
+        {
+            if (myRowCount < 0)
+                myRowCount = (int)n;
+            else if ((int)n != myRowCount)
+                throw std::runtime_error(
+                    "tableColumnProvider columns must all have the same length");
+        }
+    };
+
+    /// Sort key for tableIndexProvider::sort()
+    struct tableSortKey
+    {
+        int col;          ///< column index, 0 is the row ID
+        bool fDescending; ///< true for largest first
+    };
+
+    /** A sorted and filtered view of another provider's rows
+
+    The view is a vector of indices into the base provider's rows,
+    so sorting and filtering never copy a row,
+    and reset() restores the base order.
+
+    Columns of a tableColumnProvider are compared by type:
+    numbers as numbers, text in dictionary order which is ranked once per sort.
+    Columns of other providers are fetched once per sort and compared as strings.
+
+    After changing the view, call table::refresh() to redraw.
+
+    <pre>
+        auto view = std::make_shared<wex::tableIndexProvider>(columns);
+        table.provider(view);
+
+        // by city, then most expensive first
+        view->sort({{2, false}, {3, true}});
+        // only rows with a price
+        view->filter([&](int row)
+                     { return columns->real(row, 3) > 0; });
+        table.refresh();
+    </pre>
+    */
+    class tableIndexProvider : public tableProvider
+    {
+    public:
+        tableIndexProvider(std::shared_ptr<tableProvider> base)
+            : myBase(base),
+              myColumns(std::dynamic_pointer_cast<tableColumnProvider>(base))
+        {
+            reset();
+        }
+
+        /// Show all base rows, in base order
+        void reset()
+        {
+            std::vector<int> index(myBase->rowCount());
+            for (int k = 0; k < (int)index.size(); k++)
+                index[k] = k;
+            swap(index);
+            mySortKeys.clear();
+        }
+
+        /** Sort the rows in view
+        @param[in] keys columns to sort by, most significant first
+        @param[in] threads 1 sorts on the calling thread, 0 uses one thread per core.
+            Views smaller than about 64K rows are always sorted on the calling thread.
+
+        The sort is stable, so rows equal in every key keep their order.
+        */
+        void sort(const std::vector<tableSortKey> &keys, int threads = 0)
+        {
+            // each key read once from the provider, into a flat array over the base rows
+            std::vector<std::vector<unsigned long long>> key;
+            for (auto &k : keys)
+                key.push_back(sortKey(k));
+            auto less = [&](int a, int b)
+            {
+                for (auto &k : key)
+                    if (k[a] != k[b])
+                        return k[a] < k[b];
+                return false;
+            };
+
+            std::vector<int> index = myIndex;
+            int n = (int)index.size();
+            if (threads <= 0)
+                threads = std::max(1, (int)std::thread::hardware_concurrency());
+            int chunks = std::max(1, std::min(threads, n / 65536));
+
+            // sort chunks in parallel, then merge neighbours until one is left
+            std::vector<int> bound(chunks + 1);
+            for (int c = 0; c <= chunks; c++)
+                bound[c] = (int)((long long)n * c / chunks);
+            run(chunks, [&](int c)
+                { radixSort(index.data() + bound[c], bound[c + 1] - bound[c], key); });
+            for (int width = 1; width < chunks; width *= 2)
+            {
+                int merges = (chunks + 2 * width - 1) / (2 * width);
+                run(merges, [&](int m)
+                    {
+                        int first = 2 * width * m;
+                        int mid = std::min(first + width, chunks);
+                        int last = std::min(first + 2 * width, chunks);
+                        if (mid < last)
+                            std::inplace_merge(
+                                index.begin() + bound[first],
+                                index.begin() + bound[mid],
+                                index.begin() + bound[last],
+                                less); });
+            }
+            swap(index);
+            mySortKeys = keys;
+        }
+
+        /** Keep only the rows in view that match
+        @param[in] pred called with the base row index, returns true to keep the row
+        */
+        void filter(std::function<bool(int)> pred)
+        {
+            std::vector<int> index;
+            for (int r : myIndex)
+                if (pred(r))
+                    index.push_back(r);
+            swap(index);
+        }
+
+        /** Find first row in view where a column starts with some text
+        @param[in] col column index
+        @param[in] prefix text to search for
+        @return view row index, or -1 if not found
+
+        If the view is sorted in ascending text order on this column,
+        this is a binary search.
+        */
+        int search(int col, const std::string &prefix)
+        {
+            int n = (int)myIndex.size();
+            auto starts = [&](const std::string &s)
+            {
+                return s.compare(0, prefix.size(), prefix) == 0;
+            };
+            bool fText = !myColumns || myColumns->type(col) == tableColumnProvider::eType::text;
+            if (fText && col > 0 && mySortKeys.size() && mySortKeys[0].col == col && !mySortKeys[0].fDescending)
+            {
+                auto it = std::partition_point(
+                    myIndex.begin(), myIndex.end(),
+                    [&](int r)
+                    { return cell(r, col) < prefix; });
+                if (it != myIndex.end() && starts(cell(*it, col)))
+                    return (int)(it - myIndex.begin());
+                return -1;
+            }
+            if (myColumns)
+            {
+                for (int k = 0; k < n; k++)
+                    if (starts(fText ? myColumns->text(myIndex[k], col) : myColumns->format(myIndex[k], col)))
+                        return k;
+                return -1;
+            }
+            const int block = 1024;
+            for (int k = 0; k < n; k += block)
+            {
+                std::vector<tableRow> rows;
+                fetch(k, std::min(block, n - k), rows);
+                for (int r = 0; r < (int)rows.size(); r++)
+                    if (starts(rows[r].cell[col]))
+                        return k + r;
+            }
+            return -1;
+        }
+
+        /// base row index of each row in view
+        const std::vector<int> &index() const
+        {
+            return myIndex;
+        }
+        /// base row index of a row in view
+        int baseRow(int row) const
+        {
+            return myIndex[row];
+        }
+
+        int rowCount() override
+        {
+            return (int)myIndex.size();
+        }
+        int colCount() override
+        {
+            return myBase->colCount();
+        }
+        void fetch(int first, int count, std::vector<tableRow> &rows) override
+        {
+            // copy the base rows wanted, so a slow base fetch does not block a sort
+            std::vector<int> base;
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                count = std::max(0, std::min(count, (int)myIndex.size() - first));
+                base.assign(myIndex.begin() + first, myIndex.begin() + first + count);
+            }
+
+            // one base fetch for each run of consecutive base rows
+            int k = 0;
+            while (k < count)
+            {
+                int runStart = k;
+                k++;
+                while (k < count && base[k] == base[k - 1] + 1)
+                    k++;
+                myBase->fetch(base[runStart], k - runStart, rows);
+            }
+        }
+
+    private:
+        std::shared_ptr<tableProvider> myBase;
+        std::shared_ptr<tableColumnProvider> myColumns; // null if base is not columnar
+        std::vector<int> myIndex;                       // base row of each row in view
+        std::vector<tableSortKey> mySortKeys;           // of current order, empty if unsorted
+        std::mutex myMutex;                             // guards myIndex against prefetch
+
+        /** Sort key of every base row
+        @return unsigned integers in the same order as the cells, descending keys inverted
+        */
+        std::vector<unsigned long long> sortKey(const tableSortKey &k)
+        {
+            const unsigned long long sign = 1ULL << 63;
+            int n = myBase->rowCount();
+            std::vector<unsigned long long> key(n);
+            if (myColumns)
+            {
+                switch (myColumns->type(k.col))
+                {
+                case tableColumnProvider::eType::int64:
+                    for (int r = 0; r < n; r++)
+                        key[r] = (unsigned long long)myColumns->int64(r, k.col) ^ sign;
+                    break;
+                case tableColumnProvider::eType::real:
+                    for (int r = 0; r < n; r++)
+                        key[r] = realKey(myColumns->real(r, k.col));
+                    break;
+                case tableColumnProvider::eType::text:
+                {
+                    // rank of each dictionary entry
+                    auto &dict = myColumns->dictionary(k.col);
+                    std::vector<int> order(dict.size());
+                    for (int d = 0; d < (int)order.size(); d++)
+                        order[d] = d;
+                    std::sort(order.begin(), order.end(),
+                              [&](int a, int b)
+                              { return dict[a] < dict[b]; });
+                    std::vector<int> rank(dict.size());
+                    for (int d = 0; d < (int)order.size(); d++)
+                        rank[order[d]] = d;
+                    for (int r = 0; r < n; r++)
+                        key[r] = rank[myColumns->code(r, k.col)];
+                }
+                break;
+                }
+            }
+            else
+            {
+                // other providers sort on the row ID or the formatted text
+                std::vector<std::string> cell(k.col ? n : 0);
+                const int block = 4096;
+                for (int first = 0; first < n; first += block)
+                {
+                    std::vector<tableRow> rows;
+                    myBase->fetch(first, std::min(block, n - first), rows);
+                    for (int r = 0; r < (int)rows.size(); r++)
+                        if (k.col == 0)
+                            key[first + r] = (unsigned long long)rows[r].id ^ sign;
+                        else
+                            cell[first + r] = std::move(rows[r].cell[k.col]);
+                }
+                if (k.col)
+                {
+                    std::vector<int> order(n);
+                    for (int r = 0; r < n; r++)
+                        order[r] = r;
+                    std::sort(order.begin(), order.end(),
+                              [&](int a, int b)
+                              { return cell[a] < cell[b]; });
+                    unsigned long long rank = 0;
+                    for (int d = 0; d < n; d++)
+                    {
+                        if (d && cell[order[d]] != cell[order[d - 1]])
+                            rank++;
+                        key[order[d]] = rank;
+                    }
+                }
+            }
+            if (k.fDescending)
+                for (auto &v : key)
+                    v = ~v;
+            return key;
+        }
+
+        /// double as an unsigned integer in the same order, NaN is larger than any number
+        static unsigned long long realKey(double x)
+        {
+            if (std::isnan(x))
+                return ~0ULL;
+            if (x == 0)
+                x = 0; // -0 sorts with 0
+            unsigned long long u;
+            std::memcpy(&u, &x, sizeof u);
+            return (u >> 63) ? ~u : u | (1ULL << 63);
+        }
+
+        /** Stable sort of base rows, least significant key first, one byte at a time
+
+        Bytes that are the same in every row are skipped,
+        so a key of small integers takes one or two passes.
+        */
+        static void radixSort(int *index, int n, const std::vector<std::vector<unsigned long long>> &key)
+        {
+            std::vector<unsigned long long> v(n), vOut(n);
+            std::vector<int> row(index, index + n), rowOut(n);
+            for (int k = (int)key.size() - 1; k >= 0; k--)
+            {
+                for (int r = 0; r < n; r++)
+                    v[r] = key[k][row[r]];
+
+                // the byte counts do not change as the rows move
+                std::vector<int> count(8 * 256);
+                for (auto x : v)
+                    for (int b = 0; b < 8; b++)
+                        count[b * 256 + ((x >> (8 * b)) & 255)]++;
+
+                for (int b = 0; b < 8; b++)
+                {
+                    int *c = &count[b * 256];
+                    if (*std::max_element(c, c + 256) == n)
+                        continue;
+                    int start = 0;
+                    for (int d = 0; d < 256; d++)
+                    {
+                        int m = c[d];
+                        c[d] = start;
+                        start += m;
+                    }
+                    for (int r = 0; r < n; r++)
+                    {
+                        int d = c[(v[r] >> (8 * b)) & 255]++;
+                        vOut[d] = v[r];
+                        rowOut[d] = row[r];
+                    }
+                    v.swap(vOut);
+                    row.swap(rowOut);
+                }
+            }
+            std::copy(row.begin(), row.end(), index);
+        }
+
+        /// cell text for search
+        std::string cell(int row, int col)
+        {
+            if (myColumns)
+                return myColumns->text(row, col);
+            std::vector<tableRow> rows;
+            myBase->fetch(row, 1, rows);
+            return rows[0].cell[col];
+        }
+
+        void swap(std::vector<int> &index)
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            myIndex.swap(index);
+        }
+
+        /// run f( 0 ) to f( count-1 ), each on its own thread
+        template <class F>
+        static void run(int count, F f)
+        {
+            std::vector<std::thread> pool;
+            for (int k = 1; k < count; k++)
+                pool.emplace_back(f, k);
+            f(0);
+            for (auto &t : pool)
+                t.join();
+        }
+    };
+
+    /** Least recently used cache of formatted rows
+
+    Rows missing from the cache are fetched from the provider,
+    one fetch call for each run of consecutive missing rows.
+
+    With prefetch enabled, a background thread fetches the rows
+    just beyond those requested, in the direction of scrolling,
+    so they are cached before they are needed.
+    */
+    class tableRowCache
+    {
+    public:
+        typedef std::shared_ptr<const tableRow> row_t;
+
+        /// @param[in] capacity maximum number of rows cached
+        tableRowCache(int capacity = 4096)
+            : myCapacity(capacity),
+              myLastFirst(0),
+              myHits(0), myMisses(0),
+              myPrefetchPages(2),
+              myfPrefetch(false),
+              myfStop(false),
+              myfRequest(false),
+              myGeneration(0)
+        {
+        }
+        ~tableRowCache()
+        {
+            prefetch(false);
+        }
+        tableRowCache(const tableRowCache &) = delete;
+        tableRowCache &operator=(const tableRowCache &) = delete;
+
+        /// Set source of rows, clearing the cache
+        void provider(std::shared_ptr<tableProvider> p)
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            myProvider = p;
+            myGeneration++;
+            myfRequest = false;
+            myLRU.clear();
+            myIndex.clear();
+            myLastFirst = 0;
+        }
+        std::shared_ptr<tableProvider> provider() const
+        {
+            return myProvider;
+        }
+
+        /** Discard cached rows, after the provider's rows have changed
+
+        Rows being fetched, by the prefetch thread or another range() call, are discarded too.
+        */
+        void clear()
+        {
+            provider(myProvider);
+        }
+
+        /// Set maximum number of rows cached
+        void capacity(int rows)
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            myCapacity = std::max(1, rows);
+            evict();
+        }
+
+        /** Enable background prefetch
+        @param[in] f true to enable
+        @param[in] pages how many requests' worth of rows to prefetch
+        */
+        void prefetch(bool f, int pages = 2)
+        {
+            myPrefetchPages = std::max(1, pages);
+            if (f == myfPrefetch)
+                return;
+            myfPrefetch = f;
+            if (f)
+            {
+                myfStop = false;
+                myWorker = std::thread(&tableRowCache::worker, this);
+            }
+            else
+            {
+                {
+                    std::lock_guard<std::mutex> lck(myMutex);
+                    myfStop = true;
+                }
+                myCV.notify_one();
+                myWorker.join();
+            }
+        }
+
+        int rowCount()
+        {
+            if (!myProvider)
+                return 0;
+            return myProvider->rowCount();
+        }
+        int colCount()
+        {
+            if (!myProvider)
+                return 0;
+            return myProvider->colCount();
+        }
+
+        /** Get rows, fetching any that are not cached
+        @param[in] first index of first row
+        @param[in] count of rows
+        @return the rows, fewer than count if the table ends, null if the provider returned fewer
+
+        The rows returned stay valid after they are evicted from the cache.
+        */
+        std::vector<row_t> range(int first, int count)
+        {
+            std::vector<row_t> ret;
+            if (!myProvider)
+                return ret;
+            int total = myProvider->rowCount();
+            first = std::max(0, first);
+            count = std::max(0, std::min(count, total - first));
+            ret.resize(count);
+
+            // look up cached rows, fetch missing runs
+            std::unique_lock<std::mutex> lck(myMutex);
+            int k = 0;
+            while (k < count)
+            {
+                if (lookup(first + k, ret[k]))
+                {
+                    myHits++;
+                    k++;
+                    continue;
+                }
+                int runStart = k;
+                while (k < count && !myIndex.count(first + k))
+                    k++;
+                myMisses += k - runStart;
+                unsigned generation = myGeneration;
+                lck.unlock();
+                std::vector<tableRow> rows;
+                myProvider->fetch(first + runStart, k - runStart, rows);
+                lck.lock();
+                for (int r = 0; r < (int)rows.size(); r++)
+                {
+                    // returned, but not cached if the cache was cleared while fetching
+                    if (generation == myGeneration)
+                        ret[runStart + r] = insert(first + runStart + r, std::move(rows[r]));
+                    else
+                        ret[runStart + r] = std::make_shared<const tableRow>(std::move(rows[r]));
+                }
+            }
+            evict();
+
+            // ask for the rows beyond these, in the direction of scrolling
+            if (myfPrefetch && count && first != myLastFirst)
+            {
+                int n = count * myPrefetchPages;
+                if (first > myLastFirst)
+                    myRequestFirst = first + count;
+                else
+                    myRequestFirst = first - n;
+                myRequestCount = n;
+                myfRequest = true;
+                myCV.notify_one();
+            }
+            myLastFirst = first;
+            return ret;
+        }
+
+        /// Get one row, fetching it if not cached
+        row_t row(int index)
+        {
+            auto r = range(index, 1);
+            if (!r.size())
+                return row_t();
+            return r[0];
+        }
+
+        /// true if row is cached
+        bool isCached(int index)
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            return myIndex.count(index) > 0;
+        }
+        /// number of rows cached
+        int size()
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            return (int)myLRU.size();
+        }
+        /// rows returned from cache by range()
+        int hits() const
+        {
+            return myHits;
+        }
+        /// rows fetched from provider by range()
+        int misses() const
+        {
+            return myMisses;
+        }
+
+    private:
+        typedef std::list<std::pair<int, row_t>> lru_t;
+
+        std::shared_ptr<tableProvider> myProvider;
+        lru_t myLRU; // most recently used first
+        std::unordered_map<int, lru_t::iterator> myIndex;
+        int myCapacity;
+        int myLastFirst; // first row of previous range request
+        int myHits;
+        int myMisses;
+        int myPrefetchPages;
+        bool myfPrefetch;
+
+        // prefetch thread
+        std::thread myWorker;
+        std::mutex myMutex;
+        std::condition_variable myCV;
+        bool myfStop;
+        bool myfRequest;
+        int myRequestFirst;
+        int myRequestCount;
+        unsigned myGeneration; // incremented when the cache is cleared
+
+        /// find cached row and mark it most recently used, lock held
+        bool lookup(int index, row_t &row)
+        {
+            auto it = myIndex.find(index);
+            if (it == myIndex.end())
+                return false;
+            myLRU.splice(myLRU.begin(), myLRU, it->second);
+            row = it->second->second;
+            return true;
+        }
+
+        /// add fetched row, lock held
+        row_t insert(int index, tableRow &&r)
+        {
+            row_t row;
+            if (lookup(index, row))
+                return row; // fetched meanwhile by the other thread
+            row = std::make_shared<const tableRow>(std::move(r));
+            myLRU.emplace_front(index, row);
+            myIndex[index] = myLRU.begin();
+            return row;
+        }
+
+        /// remove least recently used rows beyond capacity, lock held
+        void evict()
+        {
+            while ((int)myLRU.size() > myCapacity)
+            {
+                myIndex.erase(myLRU.back().first);
+                myLRU.pop_back();
+            }
+        }
+
+        void worker()
+        {
+            std::unique_lock<std::mutex> lck(myMutex);
+            while (true)
+            {
+                myCV.wait(lck, [this]
+                          { return myfStop || myfRequest; });
+                if (myfStop)
+                    return;
+                myfRequest = false;
+                auto provider = myProvider;
+                if (!provider)
+                    continue;
+                int first = std::max(0, myRequestFirst);
+                int last = std::min(myRequestFirst + myRequestCount, provider->rowCount());
+
+                // fetch missing runs, without holding the lock
+                int k = first;
+                while (k < last && !myfStop && !myfRequest)
+                {
+                    if (myIndex.count(k))
+                    {
+                        k++;
+                        continue;
+                    }
+                    int runStart = k;
+                    while (k < last && !myIndex.count(k))
+                        k++;
+                    unsigned generation = myGeneration;
+                    lck.unlock();
+                    std::vector<tableRow> rows;
+                    provider->fetch(runStart, k - runStart, rows);
+                    lck.lock();
+
+                    // discard if the cache was cleared while fetching,
+                    // the rows may be from before a sort or filter
+                    if (generation != myGeneration)
+                        break;
+
+                    for (int r = 0; r < (int)rows.size(); r++)
+                        insert(runStart + r, std::move(rows[r]));
+                }
+                evict();
+            }
+        }
+    };
+}
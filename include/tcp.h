@@ -1,9 +1,15 @@
 #pragma once
+#ifndef _WIN32
+
+// POSIX epoll / io_uring backend, same server / client / send / run surface
+#include "tcpposix.h"
+
+#else
 #include <winsock2.h>
+#include <ws2tcpip.h>
 #include <windows.h>
+#include "iocontext.h"
 #include "wex.h"
-#include "ctcp.h"
-#include "await.h"
 
 namespace wex
 {
@@ -12,6 +18,10 @@ namespace wex
      * Events ( peer connection, read completion ) generate
      * messages to the parent window specified in the constructor.
      *
+     * The socket is non-blocking, waits for connections and data run on an I/O context.
+     * By default each tcp starts its own context with one thread,
+     * call context() to share one context, and its threads, between several sockets.
+     *
      * For sample code, see https://github.com/JamesBremner/windex/blob/master/demo/tcpdemo.cpp
      */
     class tcp : public gui
@@ -20,10 +30,29 @@ namespace wex
         /** CTOR
         @param[in] parent window that will receive event messages
     */
-        tcp(gui *parent) : gui(parent)
+        tcp(gui *parent) : gui(parent),
+                           myContext(&myOwnContext),
+                           mySocket(ioContext::invalidSocket),
+                           myListen(ioContext::invalidSocket),
+                           myConnecting(ioContext::invalidSocket),
+                           myfRetry(true)
         {
-            // Run asynchronous wait handler in its own thread
-            run();
+        }
+        /// DTOR closes the sockets, so no handler runs on a deleted tcp
+        ~tcp()
+        {
+            close();
+        }
+
+        /** Run socket operations on a shared I/O context
+         * @param[in] io the context, started by application code
+         *
+         * Call this before client(), server() or read().
+         * The context must outlive this tcp.
+         */
+        void context(ioContext &io)
+        {
+            myContext = &io;
         }
 
         /** Configure client() blocking
@@ -33,48 +62,24 @@ namespace wex
          */
         void RetryConnectServer(bool f)
         {
-            myTCP.RetryConnectServer(f);
+            myfRetry = f;
         }
 
         /** Create client socket connected to server
         @param[in] ipaddr IP address or name of server, defaults to same computer
         @param[in] port defaults to 27678
+
+        Returns immediatly.
+        sends eventMsgID::tcpServerAccept message to parent window when connected
     */
         void client(
             const std::string &ipaddr = "127.0.0.1",
             const std::string &port = "27678")
         {
-            myTCP.server(ipaddr, port);
-
-            // wait for connection to server
-            myWaiter(
-                [&]
-                {
-                    myTCP.serverWait();
-                },
-                [this]
-                {
-                    // check that server succesfully was connected to
-                    if (!myTCP.isConnected())
-                    {
-                        std::cout << "wex::tcp failed connection to server" << std::endl;
-                        return;
-                    }
-                    else
-                    {
-                        std::cout << "wex::tcp connected to server" << std::endl;
-                    }
-
-                    // send message to parent window announcing success
-                    if (!PostMessageA(
-                            myParent->handle(),
-                            WM_APP + 2,
-                            myID,
-                            0))
-                    {
-                        std::cout << "Post Message Error\n";
-                    }
-                });
+            close();
+            myServerAddress = ipaddr;
+            myPort = port;
+            connect();
         }
 
         /** Create server socket waiting for connection requests
@@ -90,13 +95,24 @@ namespace wex
     */
         void server(const std::string &port = "27654")
         {
-            myTCP.server("", port);
+            closeConnection();
+            if (myListen == ioContext::invalidSocket || port != myPort)
+                listen(port);
 
-            myWaiter(
-                [&]
-                { myTCP.acceptClient(); },
+            io().watch(
+                myListen,
+                ioContext::eWait::read,
                 [this]
                 {
+                    ioContext::socket_t s = accept(myListen, NULL, NULL);
+                    if (s == ioContext::invalidSocket)
+                    {
+                        // not a connection after all, keep waiting
+                        server(myPort);
+                        return;
+                    }
+                    ioContext::nonBlocking(s);
+                    mySocket = s;
                     std::cout << "connected" << std::endl;
                     PostMessageA(
                         myParent->handle(),
@@ -109,20 +125,22 @@ namespace wex
         /// true if valid connection
         bool isConnected()
         {
-            return myTCP.isConnected();
+            return mySocket != ioContext::invalidSocket;
         }
 
         /** send message to peer
          * @param[in] msg
+         *
+         * Blocks until the message is sent, or the connection fails
          */
         void send(const std::string &msg)
         {
             std::cout << "wex::tcp::send " << msg << "\n";
-            myTCP.send(msg);
+            send(msg.data(), (int)msg.size());
         }
         void send(const std::vector<unsigned char> &msg)
         {
-            myTCP.send(msg);
+            send((const char *)msg.data(), (int)msg.size());
         }
 
         /** asynchronous read message on tcp connection
@@ -139,11 +157,31 @@ namespace wex
          */
         void read()
         {
-            myWaiter(
-                [this]
-                { myTCP.read(); },
+            if (!isConnected())
+                throw std::runtime_error("wex::tcp read no connection");
+            io().watch(
+                mySocket,
+                ioContext::eWait::read,
                 [this]
                 {
+                    char buf[1024];
+                    int n = ::recv(mySocket, buf, sizeof(buf), 0);
+                    if (n < 0 && ioContext::wouldBlock())
+                    {
+                        // spurious, keep waiting
+                        read();
+                        return;
+                    }
+                    if (n <= 0)
+                    {
+                        // closed by peer, or error
+                        ioContext::closeSocket(mySocket);
+                        mySocket = ioContext::invalidSocket;
+                        myMsg.clear();
+                    }
+                    else
+                        myMsg.assign(buf, n);
+
                     // post read complete message
                     PostMessageA(
                         myParent->handle(),
@@ -153,29 +191,200 @@ namespace wex
                 });
         }
 
+        /** Close connection and stop listening
+         *
+         * Waits for a handler running on this socket to finish, then no more events are sent.
+         */
+        void close()
+        {
+            closeConnection();
+            if (myConnecting != ioContext::invalidSocket)
+            {
+                myContext->cancel(myConnecting);
+                ioContext::closeSocket(myConnecting);
+                myConnecting = ioContext::invalidSocket;
+            }
+            if (myListen != ioContext::invalidSocket)
+            {
+                myContext->cancel(myListen);
+                ioContext::closeSocket(myListen);
+                myListen = ioContext::invalidSocket;
+            }
+        }
+
         /// Get last message from peer
         std::string readMsg() const
         {
-            return myTCP.readMsg();
+            return myMsg;
         }
         std::string serverPort() const
         {
-            return myTCP.serverPort();
+            return myPort;
         }
 
     private:
-        std::string myRemoteAddress;
+        std::string myServerAddress;
+        std::string myPort;
 
-        raven::set::cTCP myTCP;
-        raven::await::cAwait myWaiter;
+        // the context is declared first, so is destroyed after the sockets are closed
+        ioContext myOwnContext;
+        ioContext *myContext;
 
-        /// Run asynchronous wait handler in its own thread
-        void run()
+        ioContext::socket_t mySocket; // connection to peer
+        ioContext::socket_t myListen; // server listening for clients
+        ioContext::socket_t myConnecting; // client connecting to server
+        bool myfRetry;
+        std::string myMsg;
+
+        /// context to run socket operations, starting own context on first use
+        ioContext &io()
+        {
+            if (myContext == &myOwnContext &&
+                !myOwnContext.isRunning())
+                myOwnContext.start();
+            return *myContext;
+        }
+
+        void closeConnection()
         {
-            std::thread t(
-                raven::await::cAwait::run,
-                &myWaiter);
-            t.detach();
+            if (mySocket == ioContext::invalidSocket)
+                return;
+            myContext->cancel(mySocket);
+            ioContext::closeSocket(mySocket);
+            mySocket = ioContext::invalidSocket;
+        }
+
+        void listen(const std::string &port)
+        {
+            if (myListen != ioContext::invalidSocket)
+            {
+                myContext->cancel(myListen);
+                ioContext::closeSocket(myListen);
+            }
+            myPort = port;
+            addrinfo hints{}, *result;
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_protocol = IPPROTO_TCP;
+            hints.ai_flags = AI_PASSIVE;
+            if (getaddrinfo(NULL, port.c_str(), &hints, &result))
+                throw std::runtime_error("wex::tcp getaddrinfo failed");
+            myListen = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+            if (myListen == ioContext::invalidSocket ||
+                bind(myListen, result->ai_addr, (int)result->ai_addrlen) ||
+                ::listen(myListen, SOMAXCONN))
+            {
+                freeaddrinfo(result);
+                ioContext::closeSocket(myListen);
+                myListen = ioContext::invalidSocket;
+                throw std::runtime_error("wex::tcp listen failed " + std::to_string(WSAGetLastError()));
+            }
+            freeaddrinfo(result);
+            ioContext::nonBlocking(myListen);
+        }
+
+        /// start connecting to server, completes on the I/O context
+        void connect()
+        {
+            addrinfo hints{}, *result;
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_protocol = IPPROTO_TCP;
+            if (getaddrinfo(myServerAddress.c_str(), myPort.c_str(), &hints, &result))
+                throw std::runtime_error("wex::tcp getaddrinfo failed");
+            ioContext::socket_t s = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+            if (s == ioContext::invalidSocket)
+            {
+                freeaddrinfo(result);
+                throw std::runtime_error("wex::tcp socket failed");
+            }
+            ioContext::nonBlocking(s);
+            myConnecting = s;
+            int ret = ::connect(s, result->ai_addr, (int)result->ai_addrlen);
+            freeaddrinfo(result);
+            if (ret && !ioContext::wouldBlock())
+            {
+                connectFailed();
+                return;
+            }
+            io().watch(
+                s,
+                ioContext::eWait::write,
+                [this, s]
+                {
+                    int error = 0;
+                    int len = sizeof(error);
+                    getsockopt(s, SOL_SOCKET, SO_ERROR, (char *)&error, &len);
+                    if (error)
+                    {
+                        connectFailed();
+                        return;
+                    }
+                    myConnecting = ioContext::invalidSocket;
+                    mySocket = s;
+                    std::cout << "wex::tcp connected to server" << std::endl;
+
+                    // send message to parent window announcing success
+                    if (!PostMessageA(
+                            myParent->handle(),
+                            WM_APP + 2,
+                            myID,
+                            0))
+                    {
+                        std::cout << "Post Message Error\n";
+                    }
+                });
+        }
+        /** connection attempt on myConnecting failed
+
+        The retry timer belongs to the failed socket, kept open until then,
+        so that close() cancels the retry.
+        */
+        void connectFailed()
+        {
+            if (!myfRetry)
+            {
+                ioContext::closeSocket(myConnecting);
+                myConnecting = ioContext::invalidSocket;
+                std::cout << "wex::tcp failed connection to server" << std::endl;
+                return;
+            }
+            io().after(
+                std::chrono::seconds(1),
+                [this]
+                {
+                    ioContext::closeSocket(myConnecting);
+                    myConnecting = ioContext::invalidSocket;
+                    try
+                    {
+                        connect();
+                    }
+                    catch (std::runtime_error &e)
+                    {
+                        std::cout << e.what() << std::endl;
+                    }
+                },
+                myConnecting);
+        }
+
+        void send(const char *p, int n)
+        {
+            while (n > 0 && isConnected())
+            {
+                int sent = ::send(mySocket, p, n, 0);
+                if (sent > 0)
+                {
+                    p += sent;
+                    n -= sent;
+                    continue;
+                }
+                if (!ioContext::wouldBlock())
+                    return;
+
+                // wait for room to send
+                WSAPOLLFD fd{mySocket, POLLOUT, 0};
+                WSAPoll(&fd, 1, -1);
+            }
         }
     };
     /** @brief Read/Write to TCP/IP socket, client or server
@@ -315,3 +524,4 @@ namespace wex
     };
 
 }
+#endif
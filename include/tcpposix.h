@@ -0,0 +1,778 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#if defined(__NR_io_uring_setup) && defined(IORING_RECV_MULTISHOT)
+#define windex_has_uring
+#endif
+
+namespace wex
+{
+    /** @brief Socket event loop behind the POSIX cSocket
+
+    The loop thread reports to its owner through onAccept(), onData() and onClosed().
+    listen() and connection() may be called from any thread.
+    */
+    class tcpBackend
+    {
+    public:
+        /// size of each read, so the framing is the same for every backend
+        static const int bufSize = 65536;
+
+        std::function<void(int fd)> onAccept;
+        std::function<void(const char *p, int n)> onData;
+        std::function<void(int fd)> onClosed;
+
+        virtual ~tcpBackend() {}
+
+        /// accept connections on a listening socket
+        virtual void listen(int fd) = 0;
+
+        /// read a connected socket until it closes
+        virtual void connection(int fd) = 0;
+
+        /// run the loop, until stop()
+        virtual void run() = 0;
+
+        /// stop the loop, from any thread
+        virtual void stop() = 0;
+    };
+
+    /// Readiness loop on epoll
+    class tcpEpoll : public tcpBackend
+    {
+    public:
+        tcpEpoll()
+            : myBuffer(bufSize), myfStop(false)
+        {
+            myEpoll = epoll_create1(EPOLL_CLOEXEC);
+            myWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (myEpoll < 0 || myWake < 0)
+                throw std::runtime_error("windex tcp epoll failed " + std::string(strerror(errno)));
+            add(myWake);
+        }
+        ~tcpEpoll()
+        {
+            ::close(myWake);
+            ::close(myEpoll);
+        }
+        void listen(int fd) override
+        {
+            myListen = fd;
+            add(fd);
+        }
+        void connection(int fd) override
+        {
+            add(fd);
+        }
+        void run() override
+        {
+            myfStop = false;
+            epoll_event ev[16];
+            while (!myfStop)
+            {
+                int n = epoll_wait(myEpoll, ev, 16, -1);
+                if (n < 0 && errno != EINTR)
+                    return;
+                for (int k = 0; k < n && !myfStop; k++)
+                {
+                    int fd = ev[k].data.fd;
+                    if (fd == myWake)
+                    {
+                        uint64_t v;
+                        while (::read(myWake, &v, sizeof(v)) > 0)
+                        {
+                        }
+                    }
+                    else if (fd == myListen)
+                        accept();
+                    else
+                        read(fd);
+                }
+            }
+        }
+        void stop() override
+        {
+            myfStop = true;
+            uint64_t v = 1;
+            ::write(myWake, &v, sizeof(v));
+        }
+
+    private:
+        int myEpoll;
+        int myWake;
+        int myListen = -1;
+        std::vector<char> myBuffer;
+        std::atomic<bool> myfStop;
+
+        void add(int fd)
+        {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(myEpoll, EPOLL_CTL_ADD, fd, &ev);
+        }
+        void accept()
+        {
+            while (true)
+            {
+                int fd = ::accept4(myListen, NULL, NULL, SOCK_CLOEXEC);
+                if (fd < 0)
+                    return;
+                onAccept(fd);
+            }
+        }
+        /// read until the socket would block, one onData() for each read
+        void read(int fd)
+        {
+            while (true)
+            {
+                int n = ::recv(fd, myBuffer.data(), bufSize, 0);
+                if (n > 0)
+                {
+                    onData(myBuffer.data(), n);
+                    continue;
+                }
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                    return;
+
+                // closed by peer, or error
+                epoll_ctl(myEpoll, EPOLL_CTL_DEL, fd, NULL);
+                onClosed(fd);
+                return;
+            }
+        }
+    };
+
+#ifdef windex_has_uring
+    /** Completion loop on io_uring
+
+    - one multishot accept on the listening socket
+    - one multishot recv on the connection, into a ring of provided buffers
+      registered with the kernel, so there is no submission for each read
+    - submissions are batched and submitted together with the wait for completions
+    */
+    class tcpUring : public tcpBackend
+    {
+    public:
+        /// @param[in] buffers number of provided buffers, a power of 2
+        tcpUring(int buffers = 64)
+            : myBufCount(buffers), myfStop(false)
+        {
+            io_uring_params p{};
+            myRing = (int)syscall(__NR_io_uring_setup, 256, &p);
+            if (myRing < 0)
+                throw std::runtime_error("windex tcp io_uring unavailable " + std::string(strerror(errno)));
+
+            // map the submission and completion rings
+            mySQSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            myCQSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            if (p.features & IORING_FEAT_SINGLE_MMAP)
+                mySQSize = myCQSize = std::max(mySQSize, myCQSize);
+            mySQPtr = mmap(0, mySQSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, myRing, IORING_OFF_SQ_RING);
+            myCQPtr = (p.features & IORING_FEAT_SINGLE_MMAP)
+                          ? mySQPtr
+                          : mmap(0, myCQSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, myRing, IORING_OFF_CQ_RING);
+            mySQESize = p.sq_entries * sizeof(io_uring_sqe);
+            mySQE = (io_uring_sqe *)mmap(0, mySQESize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, myRing, IORING_OFF_SQES);
+            if (mySQPtr == MAP_FAILED || myCQPtr == MAP_FAILED || mySQE == MAP_FAILED)
+            {
+                ::close(myRing);
+                throw std::runtime_error("windex tcp io_uring mmap failed");
+            }
+            char *sq = (char *)mySQPtr;
+            mySQHead = (unsigned *)(sq + p.sq_off.head);
+            mySQTail = (unsigned *)(sq + p.sq_off.tail);
+            mySQMask = *(unsigned *)(sq + p.sq_off.ring_mask);
+            mySQEntries = p.sq_entries;
+            mySQArray = (unsigned *)(sq + p.sq_off.array);
+            mySQLocalTail = *mySQTail;
+            char *cq = (char *)myCQPtr;
+            myCQHead = (unsigned *)(cq + p.cq_off.head);
+            myCQTail = (unsigned *)(cq + p.cq_off.tail);
+            myCQMask = *(unsigned *)(cq + p.cq_off.ring_mask);
+            myCQE = (io_uring_cqe *)(cq + p.cq_off.cqes);
+
+            // ring of provided buffers
+            myBuffer.resize((size_t)myBufCount * bufSize);
+            myBufRingSize = myBufCount * sizeof(io_uring_buf);
+            myBufRing = (io_uring_buf_ring *)mmap(0, myBufRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+            io_uring_buf_reg reg{};
+            reg.ring_addr = (unsigned long long)myBufRing;
+            reg.ring_entries = myBufCount;
+            reg.bgid = 0;
+            if (myBufRing == MAP_FAILED ||
+                syscall(__NR_io_uring_register, myRing, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+            {
+                unmap();
+                throw std::runtime_error("windex tcp io_uring buffer ring failed " + std::string(strerror(errno)));
+            }
+            myBufTail = 0;
+            for (int b = 0; b < myBufCount; b++)
+                recycle(b);
+            publishBuffers();
+
+            myWake = eventfd(0, EFD_CLOEXEC);
+        }
+        ~tcpUring()
+        {
+            unmap();
+            ::close(myWake);
+        }
+
+        /// true if the kernel allows io_uring
+        static bool isAvailable()
+        {
+            io_uring_params p{};
+            int fd = (int)syscall(__NR_io_uring_setup, 4, &p);
+            if (fd < 0)
+                return false;
+            ::close(fd);
+            return true;
+        }
+
+        void listen(int fd) override
+        {
+            action(eTag::accept, fd);
+        }
+        void connection(int fd) override
+        {
+            action(eTag::recv, fd);
+        }
+        void run() override
+        {
+            myfStop = false;
+            prepWake();
+            while (!myfStop)
+            {
+                actions();
+
+                // one system call submits everything prepared and waits for a completion
+                submit(true);
+
+                unsigned head = *myCQHead;
+                unsigned tail = __atomic_load_n(myCQTail, __ATOMIC_ACQUIRE);
+                for (; head != tail; head++)
+                    complete(myCQE[head & myCQMask]);
+                __atomic_store_n(myCQHead, head, __ATOMIC_RELEASE);
+                publishBuffers();
+            }
+        }
+        void stop() override
+        {
+            myfStop = true;
+            wake();
+        }
+
+    private:
+        enum class eTag
+        {
+            wake,
+            accept,
+            recv
+        };
+
+        int myRing;
+        size_t mySQSize, myCQSize, mySQESize;
+        void *mySQPtr;
+        void *myCQPtr;
+        io_uring_sqe *mySQE;
+        unsigned *mySQHead, *mySQTail, *mySQArray;
+        unsigned mySQMask, mySQEntries, mySQLocalTail;
+        unsigned mySQSubmitted = 0;
+        unsigned *myCQHead, *myCQTail;
+        unsigned myCQMask;
+        io_uring_cqe *myCQE;
+
+        int myBufCount;
+        std::vector<char> myBuffer;
+        size_t myBufRingSize;
+        io_uring_buf_ring *myBufRing;
+        unsigned short myBufTail;
+
+        int myWake;
+        uint64_t myWakeValue;
+        std::atomic<bool> myfStop;
+
+        // requests from other threads
+        std::mutex myMutex;
+        std::deque<std::pair<eTag, int>> myAction;
+
+        void unmap()
+        {
+            ::close(myRing);
+            munmap(mySQE, mySQESize);
+            if (myCQPtr != mySQPtr)
+                munmap(myCQPtr, myCQSize);
+            munmap(mySQPtr, mySQSize);
+            if (myBufRing != MAP_FAILED)
+                munmap(myBufRing, myBufRingSize);
+        }
+
+        static unsigned long long tag(eTag t, int fd)
+        {
+            return ((unsigned long long)t << 32) | (unsigned)fd;
+        }
+
+        void action(eTag t, int fd)
+        {
+            {
+                std::lock_guard<std::mutex> lck(myMutex);
+                myAction.push_back(std::make_pair(t, fd));
+            }
+            wake();
+        }
+        void actions()
+        {
+            std::lock_guard<std::mutex> lck(myMutex);
+            for (auto &a : myAction)
+            {
+                if (a.first == eTag::accept)
+                    prepAccept(a.second);
+                else
+                    prepRecv(a.second);
+            }
+            myAction.clear();
+        }
+        void wake()
+        {
+            uint64_t v = 1;
+            ::write(myWake, &v, sizeof(v));
+        }
+
+        /// next free submission entry, cleared
+        io_uring_sqe &sqe()
+        {
+            if (mySQLocalTail - __atomic_load_n(mySQHead, __ATOMIC_ACQUIRE) >= mySQEntries)
+                submit(false);
+            unsigned index = mySQLocalTail & mySQMask;
+            io_uring_sqe &e = mySQE[index];
+            memset(&e, 0, sizeof(e));
+            mySQArray[index] = index;
+            mySQLocalTail++;
+            return e;
+        }
+        void submit(bool fWait)
+        {
+            __atomic_store_n(mySQTail, mySQLocalTail, __ATOMIC_RELEASE);
+            unsigned count = mySQLocalTail - mySQSubmitted;
+            while (true)
+            {
+                int ret = (int)syscall(
+                    __NR_io_uring_enter, myRing, count, fWait ? 1 : 0,
+                    fWait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+                if (ret >= 0)
+                {
+                    mySQSubmitted += ret;
+                    return;
+                }
+                if (errno != EINTR && errno != EBUSY && errno != EAGAIN)
+                    return;
+                if (!fWait)
+                    return;
+                count = 0;
+            }
+        }
+
+        void prepWake()
+        {
+            auto &e = sqe();
+            e.opcode = IORING_OP_READ;
+            e.fd = myWake;
+            e.addr = (unsigned long long)&myWakeValue;
+            e.len = sizeof(myWakeValue);
+            e.user_data = tag(eTag::wake, myWake);
+        }
+        void prepAccept(int fd)
+        {
+            auto &e = sqe();
+            e.opcode = IORING_OP_ACCEPT;
+            e.fd = fd;
+            e.ioprio = IORING_ACCEPT_MULTISHOT;
+            e.accept_flags = SOCK_CLOEXEC;
+            e.user_data = tag(eTag::accept, fd);
+        }
+        void prepRecv(int fd)
+        {
+            auto &e = sqe();
+            e.opcode = IORING_OP_RECV;
+            e.fd = fd;
+            e.ioprio = IORING_RECV_MULTISHOT;
+            e.flags = IOSQE_BUFFER_SELECT;
+            e.buf_group = 0;
+            e.user_data = tag(eTag::recv, fd);
+        }
+
+        /// give a buffer back to the kernel, visible after publishBuffers()
+        void recycle(int bid)
+        {
+            // not myBufRing->bufs, which C++ places after an empty struct in the kernel header
+            io_uring_buf &b = ((io_uring_buf *)myBufRing)[myBufTail & (myBufCount - 1)];
+            b.addr = (unsigned long long)(myBuffer.data() + (size_t)bid * bufSize);
+            b.len = bufSize;
+            b.bid = bid;
+            myBufTail++;
+        }
+        void publishBuffers()
+        {
+            __atomic_store_n(&myBufRing->tail, myBufTail, __ATOMIC_RELEASE);
+        }
+
+        void complete(const io_uring_cqe &c)
+        {
+            eTag t = (eTag)(c.user_data >> 32);
+            int fd = (int)(c.user_data & 0xFFFFFFFF);
+            bool fMore = c.flags & IORING_CQE_F_MORE;
+            switch (t)
+            {
+            case eTag::wake:
+                prepWake();
+                break;
+
+            case eTag::accept:
+                if (c.res >= 0)
+                    onAccept(c.res);
+                if (!fMore && !myfStop)
+                    prepAccept(fd);
+                break;
+
+            case eTag::recv:
+                if (c.res > 0)
+                {
+                    int bid = c.flags >> IORING_CQE_BUFFER_SHIFT;
+                    onData(myBuffer.data() + (size_t)bid * bufSize, c.res);
+                    recycle(bid);
+                    if (!fMore)
+                        prepRecv(fd);
+                }
+                else if (c.res == -ENOBUFS)
+                {
+                    // all buffers were in use, they have been recycled since
+                    publishBuffers();
+                    prepRecv(fd);
+                }
+                else if (!fMore)
+                    // closed by peer, or error
+                    onClosed(fd);
+                break;
+            }
+        }
+    };
+#endif
+
+    /** @brief Read/Write to TCP/IP socket, client or server, POSIX backend
+
+    The same server / client / send / run surface as the windows cSocket,
+    reading with io_uring where the kernel allows it, otherwise with epoll.
+    The read handler is called once for each read from the socket,
+    up to tcpBackend::bufSize bytes, with either backend.
+
+    Handlers run in the thread that calls run().
+
+    One connection at a time: while a client is connected, other clients are refused.
+
+    <pre>
+    wex::cSocket S;
+    S.server(
+        "27654",
+        [](std::string &port)
+        { std::cout << "client connected\n"; },
+        [](std::string &port, const std::string &msg)
+        { std::cout << msg; });
+    S.run();
+    </pre>
+    */
+    class cSocket
+    {
+    public:
+        enum class eBackend
+        {
+            automatic, ///< io_uring if the kernel allows it, otherwise epoll
+            epoll,
+            uring
+        };
+
+        /** CTOR
+        @param[in] backend
+
+        Throws runtime_error if io_uring is asked for and not available
+        */
+        cSocket(eBackend backend = eBackend::automatic)
+            : myListen(-1), myConn(-1),
+              myfRetry(true),
+              myConnectHandler([](std::string &) {}),
+              myReadHandler([](std::string &, const std::string &) {}),
+              myBytesRead(0), myReads(0)
+        {
+            if (backend == eBackend::automatic)
+                backend = isUringAvailable() ? eBackend::uring : eBackend::epoll;
+            myBackendType = backend;
+#ifdef windex_has_uring
+            if (backend == eBackend::uring)
+                myBackend.reset(new tcpUring());
+#endif
+            if (backend == eBackend::epoll)
+                myBackend.reset(new tcpEpoll());
+            if (!myBackend)
+                throw std::runtime_error("windex tcp io_uring not built");
+
+            myBackend->onAccept = [this](int fd)
+            { accepted(fd); };
+            myBackend->onData = [this](const char *p, int n)
+            {
+                myReadHandler(myPort, std::string(p, n));
+                myReads++;
+                myBytesRead += n;
+            };
+            myBackend->onClosed = [this](int fd)
+            { closed(fd); };
+        }
+        ~cSocket()
+        {
+            stop();
+            if (myThread.joinable())
+                myThread.join();
+            myBackend.reset();
+            if (myConn >= 0)
+                ::close(myConn);
+            if (myListen >= 0)
+                ::close(myListen);
+        }
+
+        /// true if the kernel allows io_uring
+        static bool isUringAvailable()
+        {
+#ifdef windex_has_uring
+            return tcpUring::isAvailable();
+#else
+            return false;
+#endif
+        }
+        eBackend backend() const
+        {
+            return myBackendType;
+        }
+
+        /** Start server
+         * @param[in] port to listen for clients, "0" for any free port
+         * @param[in] connectHandler event handler to call when client connects
+         * @param[in] readHandler event handler to call when client sends a message
+         *
+         * Throws runtime_error if the port cannot be listened on
+         */
+        void server(
+            const std::string &port,
+            std::function<void(std::string &port)> connectHandler,
+            std::function<void(std::string &port, const std::string &msg)> readHandler)
+        {
+            myIpaddr = "";
+            myConnectHandler = connectHandler;
+            myReadHandler = readHandler;
+
+            myListen = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            int on = 1;
+            setsockopt(myListen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            addr.sin_port = htons((unsigned short)atoi(port.c_str()));
+            socklen_t len = sizeof(addr);
+            if (myListen < 0 ||
+                bind(myListen, (sockaddr *)&addr, sizeof(addr)) ||
+                ::listen(myListen, SOMAXCONN) ||
+                getsockname(myListen, (sockaddr *)&addr, &len))
+                throw std::runtime_error("windex tcp listen failed " + std::string(strerror(errno)));
+            myPort = std::to_string(ntohs(addr.sin_port));
+            fcntl(myListen, F_SETFL, fcntl(myListen, F_GETFL, 0) | O_NONBLOCK);
+            myBackend->listen(myListen);
+        }
+
+        /** Configure client() blocking
+         *
+         * true: keep trying until connection made ( default on construction )
+         * false: if connection refused return after one attempt
+         */
+        void RetryConnectServer(bool f)
+        {
+            myfRetry = f;
+        }
+
+        /** Connect to server
+         * @param[in] ipaddr
+         * @param[in] port
+         * @param[in] readhandler event handler to call when server sends a message
+         *
+         * Blocks until connected, or refused if RetryConnectServer( false )
+         */
+        void client(
+            const std::string &ipaddr,
+            const std::string &port,
+            std::function<void(std::string &port, const std::string &msg)> readHandler)
+        {
+            myIpaddr = ipaddr;
+            myPort = port;
+            myReadHandler = readHandler;
+
+            addrinfo hints{}, *result;
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_STREAM;
+            if (getaddrinfo(ipaddr.c_str(), port.c_str(), &hints, &result))
+                throw std::runtime_error("windex tcp cannot resolve " + ipaddr);
+            while (true)
+            {
+                int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (::connect(fd, result->ai_addr, result->ai_addrlen) == 0)
+                {
+                    connected(fd);
+                    break;
+                }
+                ::close(fd);
+                if (!myfRetry)
+                {
+                    std::cout << "windex tcp connection to server refused\n";
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+            freeaddrinfo(result);
+        }
+
+        bool isConnected()
+        {
+            return myConn >= 0;
+        }
+
+        /** Send message to connected peer
+
+        Blocks until sent, or the connection fails
+        */
+        void send(const std::string &msg)
+        {
+            const char *p = msg.data();
+            int n = (int)msg.size();
+            while (n > 0)
+            {
+                int fd = myConn;
+                if (fd < 0)
+                    return;
+                int sent = ::send(fd, p, n, MSG_NOSIGNAL);
+                if (sent > 0)
+                {
+                    p += sent;
+                    n -= sent;
+                    continue;
+                }
+                if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    return;
+                pollfd pfd{fd, POLLOUT, 0};
+                poll(&pfd, 1, 100);
+            }
+        }
+
+        /** Run the event loop, handlers are called from here
+
+        Blocks until stop()
+        */
+        void run()
+        {
+            myBackend->run();
+        }
+        /// Run the event loop in a thread of its own
+        void start()
+        {
+            myThread = std::thread(&cSocket::run, this);
+        }
+
+        /// Stop the event loop, from any thread or a handler
+        void stop()
+        {
+            myBackend->stop();
+        }
+
+        /// port listened on, or connected to
+        std::string serverPort() const
+        {
+            return myPort;
+        }
+        /// @name Counters
+        ///@{
+        long long bytesRead() const
+        {
+            return myBytesRead;
+        }
+        /// number of times the read handler has been called
+        long long reads() const
+        {
+            return myReads;
+        }
+        ///@}
+
+    private:
+        std::unique_ptr<tcpBackend> myBackend;
+        eBackend myBackendType;
+        std::thread myThread;
+        int myListen;
+        std::atomic<int> myConn;
+        bool myfRetry;
+        std::function<void(std::string &port)> myConnectHandler;
+        std::function<void(std::string &port, const std::string &msg)> myReadHandler;
+        std::string myPort;
+        std::string myIpaddr;
+        std::atomic<long long> myBytesRead;
+        std::atomic<long long> myReads;
+
+        void connected(int fd)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            myConn = fd;
+            myBackend->connection(fd);
+        }
+        void accepted(int fd)
+        {
+            if (myConn >= 0)
+            {
+                // one connection at a time
+                ::close(fd);
+                return;
+            }
+            connected(fd);
+            myConnectHandler(myPort);
+        }
+        void closed(int fd)
+        {
+            if (fd == myConn)
+                myConn = -1;
+            ::close(fd);
+            if (myIpaddr.empty())
+                std::cout << "Input Connection closed, waiting for new client\n";
+            else
+                std::cout << "server disconnected\n";
+        }
+    };
+}
@@ -0,0 +1,2037 @@
+// Unit tests for the parts of windex that do not need the windows API
+
+#include <string>
+#include <iostream>
+#include <random>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <pty.h>
+#include "cutest.h"
+#include "com.h"
+#include "cxy.h"
+#include "cxyindex.h"
+#include "cxyzmesh.h"
+#include "cxyclip.h"
+#include "cxysimplify.h"
+#if __has_include(<boost/property_tree/ptree.hpp>)
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#define windex_has_boost
+#endif
+#include "propertymodel.h"
+#include "tablemodel.h"
+#include "displaylist.h"
+#include "labelformat.h"
+#include "axisticks.h"
+#include "iocontext.h"
+#include "tcp.h"
+
+/// pseudo-terminal pair standing in for a serial device
+class cPTY
+{
+public:
+    int master;
+    int slave;
+    std::string name;
+
+    cPTY()
+    {
+        char buf[256];
+        openpty(&master, &slave, buf, NULL, NULL);
+        name = buf;
+
+        // raw mode, so bytes pass through unchanged
+        termios tio;
+        tcgetattr(master, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(master, TCSANOW, &tio);
+    }
+    ~cPTY()
+    {
+        close(slave);
+        close(master);
+    }
+    void write(const std::string &msg)
+    {
+        ::write(master, msg.data(), msg.size());
+    }
+    std::string read(int count)
+    {
+        std::string ret;
+        while ((int)ret.size() < count)
+        {
+            char buf[256];
+            pollfd pfd{master, POLLIN, 0};
+            if (poll(&pfd, 1, 1000) <= 0)
+                break;
+            int n = ::read(master, buf, std::min(count - (int)ret.size(), 256));
+            if (n <= 0)
+                break;
+            ret.append(buf, n);
+        }
+        return ret;
+    }
+};
+
+TEST(com_open)
+{
+    cPTY pty;
+    wex::com port;
+    port.port(pty.name);
+    CHECK(port.open());
+    CHECK(port.isOpen());
+    port.DeviceControlString("baud=115200 parity=N data=8 stop=1");
+    CHECK_EQUAL(115200, port.baud());
+    port.close();
+    CHECK(!port.isOpen());
+
+    wex::com bad;
+    bad.port("/dev/windex_no_such_port");
+    CHECK(!bad.open());
+    CHECK(!bad.errorMsg().empty());
+}
+
+TEST(com_read_write)
+{
+    cPTY pty;
+    wex::com port;
+    port.port(pty.name);
+    port.open();
+
+    // device to port
+    pty.write("hello");
+    port.read(5);
+    auto r = port.readData();
+    CHECK_EQUAL(5, (int)r.size());
+    CHECK_EQUAL(std::string("hello"), std::string(r.begin(), r.end()));
+
+    // port to device
+    CHECK_EQUAL(5, port.write(std::string("world")));
+    CHECK_EQUAL(std::string("world"), pty.read(5));
+}
+
+TEST(com_hangup)
+{
+    cPTY pty;
+    wex::com port;
+    port.port(pty.name);
+    port.open();
+
+    // a read waiting when the device goes away gives up, instead of spinning
+    std::atomic<bool> fDone{false}, fThrow{false};
+    std::thread t([&]
+                  {
+                      try
+                      {
+                          port.read(5);
+                      }
+                      catch (std::runtime_error &)
+                      {
+                          fThrow = true;
+                      }
+                      fDone = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    close(pty.master);
+    pty.master = -1;
+    auto start = std::chrono::steady_clock::now();
+    while (!fDone && std::chrono::steady_clock::now() - start < std::chrono::seconds(2))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(fDone);
+    CHECK(fThrow);
+
+    // wakes the read, if still waiting
+    port.close();
+    t.join();
+}
+
+TEST(com_read_async)
+{
+    cPTY pty;
+    wex::com port;
+    port.port(pty.name);
+    port.open();
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::string> packets;
+    port.asyncReadComplete(
+        [&](int id)
+        {
+            auto r = port.readData();
+            std::lock_guard<std::mutex> lck(mtx);
+            packets.push_back(std::string(r.begin(), r.end()));
+            cv.notify_one();
+            if (packets.size() < 2)
+                port.read_async(3);
+        });
+
+    port.read_async(3);
+    pty.write("abc");
+    pty.write("def");
+
+    std::unique_lock<std::mutex> lck(mtx);
+    cv.wait_for(
+        lck,
+        std::chrono::seconds(2),
+        [&]
+        { return packets.size() == 2; });
+    CHECK_EQUAL(2, (int)packets.size());
+    if (packets.size() == 2)
+    {
+        CHECK_EQUAL(std::string("abc"), packets[0]);
+        CHECK_EQUAL(std::string("def"), packets[1]);
+    }
+}
+
+TEST(com_read_async_latency)
+{
+    cPTY pty;
+    wex::com port;
+    port.port(pty.name);
+    port.open();
+
+    // histogram of delay from device write to completion handler
+    // buckets: < 100us, < 1ms, < 10ms, < 50ms, >= 50ms
+    const int count = 200;
+    std::vector<int> histogram(5, 0);
+    std::vector<double> limit{100, 1000, 10000, 50000};
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool fDone = false;
+    port.asyncReadComplete(
+        [&](int id)
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            fDone = true;
+            cv.notify_one();
+        });
+
+    for (int k = 0; k < count; k++)
+    {
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            fDone = false;
+        }
+        port.read_async(1);
+        auto start = std::chrono::steady_clock::now();
+        pty.write("x");
+        std::unique_lock<std::mutex> lck(mtx);
+        if (!cv.wait_for(
+                lck,
+                std::chrono::seconds(1),
+                [&]
+                { return fDone; }))
+            break;
+        double usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+        int bucket = 0;
+        while (bucket < (int)limit.size() && usecs >= limit[bucket])
+            bucket++;
+        histogram[bucket]++;
+    }
+
+    std::cout << "read_async latency < 100us " << histogram[0]
+              << ", < 1ms " << histogram[1]
+              << ", < 10ms " << histogram[2]
+              << ", < 50ms " << histogram[3]
+              << ", >= 50ms " << histogram[4] << "\n";
+
+    int total = 0;
+    for (int h : histogram)
+        total += h;
+    CHECK_EQUAL(count, total);
+
+    // no completion waits for a polling interval
+    CHECK_EQUAL(0, histogram[4]);
+}
+
+TEST(ioContext)
+{
+    // many socket pairs sharing one thread
+    const int pairs = 50;
+    int sv[pairs][2];
+    for (auto &p : sv)
+    {
+        socketpair(AF_UNIX, SOCK_STREAM, 0, p);
+        wex::ioContext::nonBlocking(p[1]);
+    }
+    wex::ioContext io;
+    io.start();
+    std::mutex mtx;
+    std::condition_variable cv;
+    int reads = 0;
+    std::set<std::thread::id> threads;
+    for (auto &p : sv)
+    {
+        int s = p[1];
+        io.watch(s, wex::ioContext::eWait::read, [&, s]
+                 {
+                     char buf[16];
+                     int n = ::recv(s, buf, sizeof(buf), 0);
+                     std::lock_guard<std::mutex> lck(mtx);
+                     if (n == 1)
+                         reads++;
+                     threads.insert(std::this_thread::get_id());
+                     cv.notify_one(); });
+    }
+    CHECK_EQUAL(pairs, io.pending());
+    for (auto &p : sv)
+        ::send(p[0], "x", 1, 0);
+    {
+        std::unique_lock<std::mutex> lck(mtx);
+        cv.wait_for(lck, std::chrono::seconds(5), [&]
+                    { return reads == pairs; });
+    }
+    CHECK_EQUAL(pairs, reads);
+    CHECK_EQUAL(1, (int)threads.size());
+    CHECK_EQUAL(1, io.threadCount());
+
+    // posted functions and timers
+    std::atomic<int> posted{0};
+    for (int k = 0; k < 100; k++)
+        io.post([&]
+                { posted++; });
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<bool> fTimer{false};
+    io.after(std::chrono::milliseconds(20), [&]
+             { fTimer = true; });
+    while (!fTimer && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(fTimer);
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+    CHECK_EQUAL(100, (int)posted);
+    CHECK(io.completed() >= pairs + 101);
+    std::cout << "ioContext dispatch latency mean " << io.dispatchLatencyMean()
+              << " max " << io.dispatchLatencyMax() << " usecs\n";
+
+    // a cancelled watch does not fire
+    std::atomic<bool> fCancelled{false};
+    io.watch(sv[0][1], wex::ioContext::eWait::read, [&]
+             { fCancelled = true; });
+    io.cancel(sv[0][1]);
+    ::send(sv[0][0], "x", 1, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!fCancelled);
+
+    // stop joins, with a watch outstanding, and the context can be restarted
+    io.watch(sv[1][1], wex::ioContext::eWait::read, [] {});
+    io.stop();
+    CHECK(!io.isRunning());
+    CHECK_EQUAL(0, io.threadCount());
+    CHECK_EQUAL(0, io.pending());
+    io.start(3);
+    CHECK_EQUAL(3, io.threadCount());
+    std::atomic<int> several{0};
+    for (int k = 0; k < 1000; k++)
+        io.post([&]
+                { several++; });
+    start = std::chrono::steady_clock::now();
+    while (several < 1000 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK_EQUAL(1000, (int)several);
+    io.stop();
+
+    for (auto &p : sv)
+    {
+        close(p[0]);
+        close(p[1]);
+    }
+}
+
+TEST(tcpPosix)
+{
+    std::vector<wex::cSocket::eBackend> backends{wex::cSocket::eBackend::epoll};
+    if (wex::cSocket::isUringAvailable())
+        backends.push_back(wex::cSocket::eBackend::uring);
+    for (auto b : backends)
+    {
+        // server, reading a client that sends more than one buffer
+        wex::cSocket S(b);
+        CHECK(b == S.backend());
+        std::atomic<bool> fConnect{false};
+        std::string received;
+        const std::string msg(200000, 'x');
+        S.server(
+            "0",
+            [&](std::string &port)
+            { fConnect = true; },
+            [&](std::string &port, const std::string &m)
+            {
+                received += m;
+                if (received.size() == msg.size())
+                    S.stop();
+            });
+        CHECK(S.serverPort() != "0");
+        S.start();
+
+        // client, replying to the server
+        wex::cSocket C(b);
+        std::string reply;
+        C.client(
+            "127.0.0.1", S.serverPort(),
+            [&](std::string &port, const std::string &m)
+            {
+                reply += m;
+                C.stop();
+            });
+        CHECK(C.isConnected());
+        C.start();
+        C.send(msg);
+
+        // the server loop stops when it has the whole message
+        auto start = std::chrono::steady_clock::now();
+        while (S.bytesRead() < (long long)msg.size() &&
+               std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(fConnect);
+        CHECK_EQUAL((int)msg.size(), (int)S.bytesRead());
+        CHECK(S.reads() >= (long long)msg.size() / wex::tcpBackend::bufSize);
+        CHECK(received == msg);
+
+        // the server's reply reaches the client
+        CHECK(S.isConnected());
+        S.send("pong");
+        start = std::chrono::steady_clock::now();
+        while (C.bytesRead() < 4 &&
+               std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK_EQUAL(4, (int)C.bytesRead());
+    }
+}
+
+TEST(byteRing)
+{
+    wex::cByteRing ring(8);
+    CHECK_EQUAL(8, ring.capacity());
+
+    unsigned char in[] = {1, 2, 3, 4, 5, 6};
+    unsigned char out[8];
+    CHECK_EQUAL(6, ring.write(in, 6));
+    CHECK_EQUAL(4, ring.read(out, 4));
+    CHECK_EQUAL(4, out[3]);
+
+    // wrap around, then overrun
+    CHECK_EQUAL(6, ring.write(in, 6));
+    CHECK_EQUAL(8, ring.size());
+    CHECK_EQUAL(0, ring.write(in, 1));
+    CHECK_EQUAL(8, ring.read(out, 8));
+    CHECK_EQUAL(5, out[0]);
+    CHECK_EQUAL(6, out[7]);
+    CHECK(ring.empty());
+}
+
+TEST(syncFrameParser)
+{
+    wex::syncFrameParser parser;
+    std::vector<std::vector<unsigned char>> frames;
+    auto handler = [&](const std::vector<unsigned char> &f)
+    {
+        frames.push_back(f);
+    };
+
+    auto f1 = parser.encode({1, 2, 3});
+    auto f2 = parser.encode({4, 5});
+    auto bad = parser.encode({6, 7, 8, 9});
+    bad[5] ^= 0xFF;
+
+    // garbage, good frame split across feeds, corrupt frame, good frame
+    std::vector<unsigned char> bytes{0x00, 0x13, 0xAA};
+    bytes.insert(bytes.end(), f1.begin(), f1.end());
+    bytes.insert(bytes.end(), bad.begin(), bad.end());
+    bytes.insert(bytes.end(), f2.begin(), f2.end());
+    parser.feed(bytes.data(), 5, handler);
+    parser.feed(bytes.data() + 5, bytes.size() - 5, handler);
+
+    CHECK_EQUAL(2, (int)frames.size());
+    CHECK_EQUAL(2, (int)parser.frames());
+    CHECK_EQUAL(1, (int)parser.framesLost());
+    if (frames.size() == 2)
+    {
+        CHECK_EQUAL(3, (int)frames[0].size());
+        CHECK_EQUAL(3, frames[0][2]);
+        CHECK_EQUAL(5, frames[1][1]);
+    }
+}
+
+TEST(com_stream)
+{
+    cPTY pty;
+    wex::com port;
+    port.port(pty.name);
+    port.open();
+
+    auto parser = std::make_shared<wex::syncFrameParser>();
+    std::mutex mtx;
+    std::condition_variable cv;
+    int count = 0;
+    port.stream(
+        parser,
+        [&](const std::vector<unsigned char> &frame)
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            count++;
+            cv.notify_one();
+        });
+
+    std::string bytes;
+    for (int k = 0; k < 100; k++)
+    {
+        auto f = parser->encode(std::vector<unsigned char>(k + 1, (unsigned char)k));
+        if (k == 50)
+            f.back() ^= 0xFF;
+        bytes.append(f.begin(), f.end());
+    }
+    pty.write(bytes);
+
+    std::unique_lock<std::mutex> lck(mtx);
+    cv.wait_for(
+        lck,
+        std::chrono::seconds(2),
+        [&]
+        { return count == 99; });
+    CHECK_EQUAL(99, count);
+    auto stats = port.streamStats();
+    CHECK_EQUAL(99, (int)stats.frames);
+    CHECK_EQUAL(1, (int)stats.framesLost);
+    CHECK_EQUAL(0, (int)stats.overrun);
+
+    // the ring cannot be replaced while the reader is streaming into it
+    bool fThrow = false;
+    try
+    {
+        port.stream(parser, [](const std::vector<unsigned char> &) {});
+    }
+    catch (std::runtime_error &)
+    {
+        fThrow = true;
+    }
+    CHECK(fThrow);
+}
+
+/// random star shaped polygon around 0,0
+std::vector<cxy> starPolygon(int n, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> radius(20, 100);
+    std::vector<cxy> poly;
+    for (int k = 0; k < n; k++)
+    {
+        double a = 2 * M_PI * k / n;
+        double r = radius(rng);
+        poly.push_back(cxy(r * cos(a), r * sin(a)));
+    }
+    return poly;
+}
+std::vector<cxy> randomPoints(int n, double range, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> d(-range, range);
+    std::vector<cxy> pts;
+    for (int k = 0; k < n; k++)
+        pts.push_back(cxy(d(rng), d(rng)));
+    return pts;
+}
+
+TEST(preparedPolygon)
+{
+    std::mt19937 rng(42);
+    auto poly = starPolygon(200, rng);
+    auto pts = randomPoints(10001, 120, rng);
+
+    cPreparedPolygon prep(poly);
+    cPreparedPolygon indexed(poly, 32);
+    std::vector<bool> in, inIndexed;
+    prep.classify(pts, in);
+    indexed.classify(pts, inIndexed);
+
+    int mismatch = 0, mismatchIndexed = 0, inCount = 0;
+    for (int k = 0; k < (int)pts.size(); k++)
+    {
+        bool expected = pts[k].isInside(poly);
+        if (expected)
+            inCount++;
+        if (in[k] != expected)
+            mismatch++;
+        if (inIndexed[k] != expected)
+            mismatchIndexed++;
+    }
+    CHECK(inCount > 1000);
+    CHECK_EQUAL(0, mismatch);
+    CHECK_EQUAL(0, mismatchIndexed);
+
+    // time against a point by point cxy::isInside
+#ifdef __AVX2__
+    const char *path = "avx2";
+#else
+    const char *path = "scalar";
+#endif
+    auto many = randomPoints(200000, 120, rng);
+    auto start = std::chrono::steady_clock::now();
+    int manyIn = 0;
+    for (auto &p : many)
+        if (p.isInside(poly))
+            manyIn++;
+    double msecsIsInside = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count() /
+                           1000.0;
+    start = std::chrono::steady_clock::now();
+    prep.classify(many, in);
+    double msecsPrep = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count() /
+                       1000.0;
+    start = std::chrono::steady_clock::now();
+    indexed.classify(many, inIndexed);
+    double msecsIndexed = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count() /
+                          1000.0;
+    std::cout << "classify 200,000 points in 200 vertex polygon: isInside "
+              << msecsIsInside << " ms, " << path << " " << msecsPrep
+              << " ms, indexed " << msecsIndexed << " ms\n";
+    CHECK_EQUAL(manyIn, (int)std::count(in.begin(), in.end(), true));
+    CHECK_EQUAL(manyIn, (int)std::count(inIndexed.begin(), inIndexed.end(), true));
+
+    // square with horizontal edges
+    cPreparedPolygon sq({{0, 0}, {10, 0}, {10, 10}, {0, 10}});
+    CHECK(sq.isInside(cxy(5, 5)));
+    CHECK(!sq.isInside(cxy(15, 5)));
+    CHECK(!sq.isInside(cxy(5, -1)));
+}
+
+std::vector<cxySegment> randomSegments(int n, double range, double length, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> d(0, range);
+    std::uniform_real_distribution<double> l(-length, length);
+    std::vector<cxySegment> segs;
+    for (int k = 0; k < n; k++)
+    {
+        cxy a(d(rng), d(rng));
+        segs.push_back(std::make_pair(a, cxy(a.x + l(rng), a.y + l(rng))));
+    }
+    return segs;
+}
+std::vector<std::pair<int, int>> bruteIntersections(const std::vector<cxySegment> &segs)
+{
+    std::vector<std::pair<int, int>> ret;
+    for (int i = 0; i < (int)segs.size(); i++)
+        for (int j = i + 1; j < (int)segs.size(); j++)
+        {
+            cxy p;
+            if (cxy::isIntersection(p, segs[i].first, segs[i].second, segs[j].first, segs[j].second))
+                ret.push_back(std::make_pair(i, j));
+        }
+    return ret;
+}
+/** compare index queries with brute force
+@return description of first failure, empty if all match
+*/
+template <class T>
+std::string checkSegmentIndex(const T &index, const std::vector<cxySegment> &segs, std::mt19937 &rng)
+{
+    // nearest, compared by distance so that ties do not matter
+    auto pts = randomPoints(50, 1200, rng);
+    for (auto &p : pts)
+    {
+        std::vector<double> d;
+        for (auto &s : segs)
+            d.push_back(cSegmentIndex::dist2(p, s));
+        std::sort(d.begin(), d.end());
+        auto near = index.nearest(p, 5);
+        if (near.size() != 5)
+            return "nearest count";
+        for (int k = 0; k < 5; k++)
+            if (cSegmentIndex::dist2(p, segs[near[k]]) != d[k])
+                return "nearest distance";
+    }
+
+    // range
+    cxy mn(200, 300), mx(450, 380);
+    auto hits = index.range(mn, mx);
+    std::sort(hits.begin(), hits.end());
+    std::vector<int> expected;
+    for (int k = 0; k < (int)segs.size(); k++)
+        if (cSegmentIndex::isInRange(segs[k], mn, mx))
+            expected.push_back(k);
+    if (expected.size() < 10 || hits != expected)
+        return "range";
+
+    // intersections
+    auto crossings = index.intersections();
+    std::sort(crossings.begin(), crossings.end());
+    auto brute = bruteIntersections(segs);
+    if (brute.size() < 100 || crossings != brute)
+        return "intersections";
+
+    return "";
+}
+
+TEST(segmentGrid)
+{
+    std::mt19937 rng(7);
+    auto segs = randomSegments(2000, 1000, 30, rng);
+    cSegmentGrid grid(segs);
+    CHECK_EQUAL(std::string(""), checkSegmentIndex(grid, segs, rng));
+
+    // few long segments in large cells
+    cSegmentGrid coarse(segs, 250);
+    CHECK_EQUAL(std::string(""), checkSegmentIndex(coarse, segs, rng));
+
+    CHECK(cSegmentGrid(std::vector<cxySegment>()).nearest(cxy(0, 0)).empty());
+}
+
+TEST(segmentRTree)
+{
+    std::mt19937 rng(8);
+    auto segs = randomSegments(2000, 1000, 30, rng);
+    cSegmentRTree tree(segs);
+    CHECK_EQUAL(3, tree.height());
+    CHECK_EQUAL(std::string(""), checkSegmentIndex(tree, segs, rng));
+
+    cSegmentRTree small(segs, 4);
+    CHECK_EQUAL(std::string(""), checkSegmentIndex(small, segs, rng));
+
+    // join with a second set
+    auto other = randomSegments(500, 1000, 30, rng);
+    auto joined = cSegmentRTree(segs).join(cSegmentRTree(other));
+    std::sort(joined.begin(), joined.end());
+    std::vector<std::pair<int, int>> brute;
+    for (int i = 0; i < (int)segs.size(); i++)
+        for (int j = 0; j < (int)other.size(); j++)
+        {
+            cxy p;
+            if (cxy::isIntersection(p, segs[i].first, segs[i].second, other[j].first, other[j].second))
+                brute.push_back(std::make_pair(i, j));
+        }
+    CHECK(brute.size() > 10);
+    CHECK(joined == brute);
+
+    CHECK_EQUAL(0, cSegmentRTree(std::vector<cxySegment>()).height());
+}
+
+TEST(segmentIndexScaling)
+{
+    // the size the unit tests run at, larger sizes are timed by benchPosix
+    std::mt19937 rng(12);
+    int n = 10000;
+    auto segs = randomSegments(n, 10 * sqrt((double)n), 5, rng);
+    int grid = (int)cSegmentGrid(segs).intersections().size();
+    int tree = (int)cSegmentRTree(segs).intersections().size();
+    CHECK(grid > n / 100);
+    CHECK_EQUAL(grid, tree);
+}
+
+/// sweep result matches testing every pair, points to the last bit
+static int sweepMismatch(const std::vector<cxySegment> &segs, int &crossings)
+{
+    auto sweep = cSegmentSweep::crossings(segs);
+    auto brute = bruteIntersections(segs);
+    crossings = (int)brute.size();
+    int mismatch = abs((int)brute.size() - (int)sweep.size());
+    for (int k = 0; k < (int)std::min(brute.size(), sweep.size()); k++)
+    {
+        if (sweep[k].first != brute[k].first || sweep[k].second != brute[k].second)
+        {
+            mismatch++;
+            continue;
+        }
+        cxy p;
+        auto &a = segs[brute[k].first];
+        auto &b = segs[brute[k].second];
+        cxy::isIntersection(p, a.first, a.second, b.first, b.second);
+        if (!(p == sweep[k].p))
+            mismatch++;
+    }
+    return mismatch;
+}
+
+TEST(segmentSweep)
+{
+    std::mt19937 rng(9);
+    auto segs = randomSegments(3000, 1000, 30, rng);
+
+    // degenerate cases: vertical, zero length, shared end points, collinear overlap
+    segs.push_back(std::make_pair(cxy(500, 0), cxy(500, 1000)));
+    segs.push_back(std::make_pair(cxy(250, 250), cxy(250, 250)));
+    segs.push_back(std::make_pair(cxy(10, 10), cxy(20, 20)));
+    segs.push_back(std::make_pair(cxy(20, 20), cxy(30, 10)));
+    segs.push_back(std::make_pair(cxy(15, 15), cxy(25, 25)));
+
+    // several segments through one point, and end points on other segments,
+    // in integers so the crossing point is exact with or without FMA contraction
+    int star[][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}, {2, 1}, {1, 2}, {2, -1}, {1, -2}};
+    for (auto &d : star)
+        segs.push_back(std::make_pair(
+            cxy(600 - 20 * d[0], 600 - 20 * d[1]),
+            cxy(600 + 20 * d[0], 600 + 20 * d[1])));
+    segs.push_back(std::make_pair(cxy(600, 600), cxy(700, 650)));
+    segs.push_back(std::make_pair(cxy(550, 700), cxy(600, 600)));
+
+    int crossings;
+    CHECK_EQUAL(0, sweepMismatch(segs, crossings));
+    CHECK(crossings > 100);
+
+    // long segments that all span the sweep line at once
+    std::uniform_real_distribution<double> u(0, 1000);
+    std::vector<cxySegment> fans;
+    for (int k = 0; k < 500; k++)
+        fans.push_back(std::make_pair(cxy(0, u(rng)), cxy(1000, u(rng))));
+    CHECK_EQUAL(0, sweepMismatch(fans, crossings));
+    CHECK(crossings > 10000);
+
+    CHECK(cSegmentSweep::crossings(std::vector<cxySegment>()).empty());
+}
+
+TEST(cxyArray)
+{
+    std::mt19937 rng(11);
+    auto poly = starPolygon(100, rng);
+    cxyArray a(poly);
+    cxyArrayf af(poly);
+    CHECK_EQUAL(100, a.size());
+
+    // views through the cxy polygon methods
+    CHECK_CLOSE(cxy::polygonArea(poly), cxy::polygonArea(a), 1e-6);
+    CHECK_CLOSE(cxy::polygonArea(poly), a.area(), 1e-6);
+    CHECK_CLOSE(cxy::polygonArea(poly), cxy::polygonArea(af), 0.1);
+    auto pts = randomPoints(1000, 120, rng);
+    int mismatch = 0;
+    for (auto &p : pts)
+        if (p.isInside(poly) != p.isInside(a))
+            mismatch++;
+    CHECK_EQUAL(0, mismatch);
+
+    cxy mn, mx;
+    a.bbox(mn, mx);
+    cxy wh = cxy::enclosingWidthHeight(a);
+    CHECK_CLOSE(mx.x - mn.x, wh.x, 1e-9);
+    CHECK_CLOSE(mx.y - mn.y, wh.y, 1e-9);
+
+    // bulk transforms match the single point versions
+    cxy origin(3, 4);
+    a.rotate(0.7, origin);
+    a.zoom(1.5);
+    a.translate(cxy(10, -2));
+    af.rotate(0.7, origin);
+    double err = 0, errf = 0;
+    for (int k = 0; k < (int)poly.size(); k++)
+    {
+        cxy p = poly[k].rotate(0.7, origin);
+        cxy q = p;
+        q.zoom(1.5);
+        q += cxy(10, -2);
+        err = std::max(err, sqrt(q.dist2(a[k])));
+        errf = std::max(errf, sqrt(p.dist2(af[k])));
+    }
+    CHECK(err < 1e-9);
+    CHECK(errf < 1e-3);
+
+    // centroid of a square
+    cxyArray sq(std::vector<cxy>{{0, 0}, {4, 0}, {4, 2}, {0, 2}});
+    CHECK_CLOSE(2, sq.centroid().x, 1e-9);
+    CHECK_CLOSE(1, sq.centroid().y, 1e-9);
+    CHECK_CLOSE(8, sq.area(), 1e-9);
+    CHECK_EQUAL(4, (int)sq.toVector().size());
+}
+
+TEST(intersectLineTriangle)
+{
+    cxyz p0(0, 0, 0), p1(10, 0, 0), p2(0, 10, 0);
+    cxyz hit = cxyz::intersectLineTriangle(
+        cxyz(2, 3, 5), cxyz(2, 3, -5), p0, p1, p2);
+    CHECK(hit.isValid());
+    CHECK_CLOSE(2, hit.x, 1e-9);
+    CHECK_CLOSE(3, hit.y, 1e-9);
+    CHECK_CLOSE(0, hit.z, 1e-9);
+
+    // misses: outside triangle, segment too short, parallel
+    CHECK(!cxyz::intersectLineTriangle(cxyz(8, 8, 5), cxyz(8, 8, -5), p0, p1, p2).isValid());
+    CHECK(!cxyz::intersectLineTriangle(cxyz(2, 3, 5), cxyz(2, 3, 1), p0, p1, p2).isValid());
+    CHECK(!cxyz::intersectLineTriangle(cxyz(2, 3, 5), cxyz(4, 3, 5), p0, p1, p2).isValid());
+
+    // triangle away from the origin, tilted
+    cxyz q0(5, 5, 5), q1(15, 5, 7), q2(5, 15, 9);
+    hit = cxyz::intersectLineTriangle(cxyz(7, 7, 20), cxyz(7, 7, -20), q0, q1, q2);
+    CHECK(hit.isValid());
+    CHECK_CLOSE(5 + 0.2 * 2 + 0.2 * 4, hit.z, 1e-9);
+}
+
+TEST(cxyzMesh)
+{
+    // terrain height field
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<double> height(0, 10);
+    const int side = 21;
+    std::vector<cxyz> vertices;
+    for (int r = 0; r < side; r++)
+        for (int c = 0; c < side; c++)
+            vertices.push_back(cxyz(c * 10, r * 10, height(rng)));
+    std::vector<std::array<int, 3>> triangles;
+    for (int r = 0; r < side - 1; r++)
+        for (int c = 0; c < side - 1; c++)
+        {
+            int v = r * side + c;
+            triangles.push_back({v, v + 1, v + side});
+            triangles.push_back({v + 1, v + side + 1, v + side});
+        }
+    cxyzMesh mesh(vertices, triangles);
+    CHECK_EQUAL(800, mesh.triangleCount());
+
+    // random lines of sight
+    std::uniform_real_distribution<double> xy(-20, 220), z(-5, 15);
+    std::vector<std::pair<cxyz, cxyz>> segments;
+    for (int k = 0; k < 1001; k++)
+        segments.push_back(std::make_pair(
+            cxyz(xy(rng), xy(rng), z(rng)),
+            cxyz(xy(rng), xy(rng), z(rng))));
+#ifdef __AVX2__
+    const char *path = "avx2";
+#else
+    const char *path = "scalar";
+#endif
+    auto start = std::chrono::steady_clock::now();
+    std::vector<sMeshHit> hits;
+    mesh.intersect(segments, hits);
+    double msecsBVH = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count() /
+                      1000.0;
+    CHECK_EQUAL(1001, (int)hits.size());
+
+    // nearest hit by testing every triangle
+    start = std::chrono::steady_clock::now();
+    std::vector<cxyz> brute;
+    for (auto &s : segments)
+    {
+        cxyz best;
+        double bestd2 = DBL_MAX;
+        for (auto &t : triangles)
+        {
+            cxyz p = cxyz::intersectLineTriangle(
+                s.first, s.second, vertices[t[0]], vertices[t[1]], vertices[t[2]]);
+            if (!p.isValid())
+                continue;
+            cxyz v = s.first.vect(p);
+            double d2 = v.dot(v);
+            if (d2 < bestd2)
+            {
+                bestd2 = d2;
+                best = p;
+            }
+        }
+        brute.push_back(best);
+    }
+    double msecsBrute = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count() /
+                        1000.0;
+    std::cout << "1001 segments against 800 triangles: brute force " << msecsBrute
+              << " ms, bvh " << path << " " << msecsBVH << " ms\n";
+
+    int hitCount = 0, mismatch = 0;
+    for (int k = 0; k < (int)segments.size(); k++)
+    {
+        auto &best = brute[k];
+        if (best.isValid())
+            hitCount++;
+        if (best.isValid() != (hits[k].triangle >= 0))
+            mismatch++;
+        else if (best.isValid())
+        {
+            cxyz v = best.vect(hits[k].p);
+            if (v.dot(v) > 1e-12)
+                mismatch++;
+        }
+
+        // single segment matches packet
+        auto single = mesh.intersect(segments[k].first, segments[k].second);
+        if (single.triangle != hits[k].triangle)
+            mismatch++;
+    }
+    CHECK(hitCount > 100);
+    CHECK_EQUAL(0, mismatch);
+}
+
+/// area of polygon, positive if counter clockwise with y up
+double signedArea(const std::vector<cxy> &polygon)
+{
+    double a = 0;
+    int n = (int)polygon.size();
+    for (int i = 0, j = n - 1; i < n; j = i++)
+        a += polygon[j].x * polygon[i].y - polygon[i].x * polygon[j].y;
+    return a / 2;
+}
+
+/// area of boolean operation result, holes subtracted
+double totalArea(const std::vector<std::vector<cxy>> &polygons)
+{
+    double a = 0;
+    for (auto &p : polygons)
+        a += signedArea(p);
+    return a;
+}
+
+TEST(polygonClip)
+{
+    std::vector<cxy> sq1{{0, 0}, {4, 0}, {4, 4}, {0, 4}};
+    std::vector<cxy> sq2{{2, 2}, {6, 2}, {6, 6}, {2, 6}};
+    CHECK(cPolygonClip::isConvex(sq1));
+
+    // Sutherland-Hodgman
+    CHECK_CLOSE(4, cxy::polygonArea(cPolygonClip::clipConvex(sq1, sq2)), 1e-9);
+    CHECK(cPolygonClip::clipConvex(sq1, {{10, 10}, {11, 10}, {11, 11}}).empty());
+
+    // Greiner-Hormann on convex
+    CHECK_CLOSE(4, totalArea(cPolygonClip::intersection(sq1, sq2)), 1e-9);
+    CHECK_CLOSE(28, totalArea(cPolygonClip::unite(sq1, sq2)), 1e-9);
+    CHECK_CLOSE(12, totalArea(cPolygonClip::difference(sq1, sq2)), 1e-9);
+    CHECK_EQUAL(1, (int)cPolygonClip::unite(sq1, sq2).size());
+
+    // concave U cut by a bar across both arms gives two pieces
+    std::vector<cxy> u{{0, 0}, {6, 0}, {6, 6}, {4, 6}, {4, 2}, {2, 2}, {2, 6}, {0, 6}};
+    std::vector<cxy> bar{{-1, 3}, {7, 3}, {7, 5}, {-1, 5}};
+    CHECK(!cPolygonClip::isConvex(u));
+    auto pieces = cPolygonClip::intersection(u, bar);
+    CHECK_EQUAL(2, (int)pieces.size());
+    CHECK_CLOSE(8, totalArea(pieces), 1e-9);
+    CHECK_CLOSE(20, totalArea(cPolygonClip::difference(u, bar)), 1e-9);
+
+    // union encloses a hole between the arms
+    auto united = cPolygonClip::unite(u, bar);
+    CHECK_EQUAL(2, (int)united.size());
+    CHECK_CLOSE(36, totalArea(united), 1e-9);
+    std::vector<cxy> reversed(bar.rbegin(), bar.rend());
+    CHECK_CLOSE(36, totalArea(cPolygonClip::unite(reversed, u)), 1e-9);
+
+    // no crossings: contained and disjoint
+    std::vector<cxy> inner{{1, 1}, {2, 1}, {2, 2}, {1, 2}};
+    CHECK_CLOSE(1, totalArea(cPolygonClip::intersection(sq1, inner)), 1e-9);
+    CHECK_CLOSE(16, totalArea(cPolygonClip::unite(inner, sq1)), 1e-9);
+    auto holed = cPolygonClip::difference(sq1, inner);
+    CHECK_EQUAL(2, (int)holed.size());
+    CHECK_CLOSE(15, totalArea(holed), 1e-9);
+    CHECK(cPolygonClip::difference(inner, sq1).empty());
+    std::vector<cxy> far{{10, 10}, {11, 10}, {11, 11}};
+    CHECK(cPolygonClip::intersection(sq1, far).empty());
+
+    // degenerate: shared edge, identical polygons, vertex on edge
+    std::vector<cxy> right{{4, 0}, {8, 0}, {8, 4}, {4, 4}};
+    CHECK_CLOSE(0, totalArea(cPolygonClip::intersection(sq1, right)), 1e-6);
+    CHECK_CLOSE(32, totalArea(cPolygonClip::unite(sq1, right)), 1e-6);
+    CHECK_CLOSE(16, totalArea(cPolygonClip::intersection(sq1, sq1)), 1e-6);
+    std::vector<cxy> diamond{{2, 0}, {4, 2}, {2, 4}, {0, 2}};
+    CHECK_CLOSE(8, totalArea(cPolygonClip::intersection(sq1, diamond)), 1e-6);
+
+    // random convex against random star: Greiner-Hormann agrees with Sutherland-Hodgman
+    std::mt19937 rng(17);
+    int mismatch = 0;
+    for (int k = 0; k < 50; k++)
+    {
+        auto star = starPolygon(40, rng);
+        std::vector<cxy> hexagon;
+        for (int v = 0; v < 6; v++)
+            hexagon.push_back(cxy(30 + 50 * cos(v * M_PI / 3 + k), 20 + 50 * sin(v * M_PI / 3 + k)));
+        double sh = cxy::polygonArea(cPolygonClip::clipConvex(star, hexagon));
+        double gh = totalArea(cPolygonClip::intersection(star, hexagon));
+        double diff = totalArea(cPolygonClip::difference(star, hexagon));
+        if (fabs(sh - gh) > 1e-6 || fabs(gh + diff - cxy::polygonArea(star)) > 1e-6)
+            mismatch++;
+    }
+    CHECK_EQUAL(0, mismatch);
+}
+
+TEST(polygonClipBatch)
+{
+    // star polygons clipped against tiles covering them
+    std::mt19937 rng(19);
+    std::vector<std::vector<cxy>> polygons;
+    for (int k = 0; k < 200; k++)
+        polygons.push_back(starPolygon(30, rng));
+    std::vector<std::vector<cxy>> tiles;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+        {
+            double x = -100 + c * 50, y = -100 + r * 50;
+            tiles.push_back({{x, y}, {x + 50, y}, {x + 50, y + 50}, {x, y + 50}});
+        }
+
+    auto clipped = cPolygonClip::clipBatch(polygons, tiles, 4);
+    std::vector<double> area(polygons.size(), 0);
+    for (auto &c : clipped)
+        area[c.polygon] += cxy::polygonArea(c.ring);
+    // vertices on tile edges are shifted slightly, see cPolygonClip
+    int mismatch = 0;
+    for (int k = 0; k < (int)polygons.size(); k++)
+        if (fabs(area[k] - cxy::polygonArea(polygons[k])) > 1e-4)
+            mismatch++;
+    CHECK_EQUAL(0, mismatch);
+
+    // same result on one thread
+    auto single = cPolygonClip::clipBatch(polygons, tiles, 1);
+    CHECK_EQUAL(clipped.size(), single.size());
+    bool same = clipped.size() == single.size();
+    for (int k = 0; same && k < (int)single.size(); k++)
+        same = single[k].polygon == clipped[k].polygon &&
+               single[k].tile == clipped[k].tile &&
+               single[k].ring.size() == clipped[k].ring.size();
+    CHECK(same);
+}
+
+/// largest distance of a point outside a convex polygon, 0 if all inside
+double outsideHull(const std::vector<cxy> &points, const std::vector<cxy> &hull)
+{
+    double worst = 0;
+    for (auto &p : points)
+    {
+        // outside if right of any counter clockwise edge
+        bool fOut = false;
+        for (int i = 0; i < (int)hull.size(); i++)
+        {
+            const cxy &a = hull[i];
+            const cxy &b = hull[(i + 1) % hull.size()];
+            if ((b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x) < -1e-9)
+                fOut = true;
+        }
+        if (!fOut)
+            continue;
+        double d2 = DBL_MAX;
+        for (int i = 0; i < (int)hull.size(); i++)
+            d2 = std::min(d2, p.dis2toline(hull[i], hull[(i + 1) % hull.size()]));
+        worst = std::max(worst, sqrt(d2));
+    }
+    return worst;
+}
+
+/// largest distance of an original point from the simplified line between kept neighbours
+double simplifyError(const std::vector<cxy> &line, const std::vector<cxy> &simple)
+{
+    double worst = 0;
+    int s = 0;
+    for (auto &p : line)
+    {
+        if (s + 1 < (int)simple.size() && p == simple[s + 1])
+        {
+            s++;
+            continue;
+        }
+        if (s + 1 < (int)simple.size())
+            worst = std::max(worst, sqrt(p.dis2toline(simple[s], simple[s + 1])));
+    }
+    return worst;
+}
+
+std::vector<cxy> randomWalk(int n, std::mt19937 &rng)
+{
+    std::normal_distribution<double> step(0, 1);
+    std::vector<cxy> line;
+    cxy p(0, 0);
+    for (int k = 0; k < n; k++)
+    {
+        p = cxy(p.x + 1, p.y + step(rng));
+        line.push_back(p);
+    }
+    return line;
+}
+
+TEST(convexHull)
+{
+    std::vector<cxy> square{{0, 0}, {2, 0}, {2, 2}, {0, 2}, {1, 1}, {1, 0}, {0, 0}};
+    auto hull = cPointReduce::convexHull(square);
+    CHECK_EQUAL(4, (int)hull.size());
+    CHECK_CLOSE(4, signedArea(hull), 1e-9);
+
+    std::mt19937 rng(23);
+    auto cloud = randomPoints(300000, 100, rng);
+    hull = cPointReduce::convexHull(cloud);
+    CHECK(cPolygonClip::isConvex(hull));
+    CHECK_CLOSE(0, outsideHull(cloud, hull), 1e-9);
+
+    auto parallel = cPointReduce::convexHull(cloud, 0, 4);
+    CHECK(parallel == hull);
+
+    // approximate hull is within tolerance
+    auto approx = cPointReduce::convexHull(cloud, 0.5, 4);
+    CHECK(approx.size() <= hull.size());
+    CHECK(outsideHull(cloud, approx) <= 0.5);
+}
+
+TEST(simplify)
+{
+    std::mt19937 rng(29);
+    auto walk = randomWalk(200000, rng);
+
+    for (int threads : {1, 4})
+    {
+        auto r = cPointReduce::rdp(walk, 2, threads);
+        CHECK(r.size() < walk.size() / 4);
+        CHECK(r.front() == walk.front());
+        CHECK(r.back() == walk.back());
+        CHECK(simplifyError(walk, r) <= 2 + 1e-9);
+
+        auto v = cPointReduce::visvalingam(walk, 5, threads);
+        CHECK(v.size() < walk.size() / 2);
+        CHECK(v.front() == walk.front());
+        CHECK(v.back() == walk.back());
+    }
+
+    // serial Visvalingam leaves no triangle smaller than the bound
+    auto v = cPointReduce::visvalingam(walk, 5);
+    double smallest = DBL_MAX;
+    for (int k = 1; k + 1 < (int)v.size(); k++)
+    {
+        const cxy &a = v[k - 1], &b = v[k], &c = v[k + 1];
+        smallest = std::min(smallest, fabs((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)) / 2);
+    }
+    CHECK(smallest >= 5);
+
+    // straight line reduces to its ends
+    std::vector<cxy> straight{{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+    CHECK_EQUAL(2, (int)cPointReduce::rdp(straight, 0.1).size());
+    CHECK_EQUAL(2, (int)cPointReduce::visvalingam(straight, 0.1).size());
+}
+
+TEST(propertyModel)
+{
+    wex::propertyModel M;
+    std::vector<std::string> log;
+    M.listen([&](wex::property *p, wex::propertyModel::eChange c)
+             {
+                 if (c == wex::propertyModel::eChange::value)
+                     log.push_back(p->name() + "=" + p->value()); });
+
+    M.category("Serial");
+    M.string("Port", "COM3");
+    M.integer("Baud", 9600);
+    M.check("Flow", false);
+    M.category("Plot");
+    M.real("Scale", 0.25);
+    M.choice("Style", {"line", "dots"}).value("dots");
+    M.integer("Baud", 4);
+    CHECK_EQUAL(8, M.size());
+
+    // lookup by name finds the first, by category and name the one in the category
+    CHECK_EQUAL(9600, (int)M.find("Baud")->integer());
+    CHECK_EQUAL(4, (int)M.find("Plot", "Baud")->integer());
+    CHECK(M.find("Plot", "Port") == nullptr);
+    CHECK(M.find("Missing", "Port") == nullptr);
+    CHECK_CLOSE(0.25, M.find("Scale")->real(), 1e-12);
+
+    // notifications only when a value changes
+    M.find("Port")->value("COM3");
+    M.find("Port")->value("COM4");
+    M.find("Flow")->value_bool(true);
+    M.find("Scale")->real(1.5);
+    CHECK_EQUAL(4, (int)log.size());
+    CHECK_EQUAL(std::string("Style=dots"), log[0]);
+    CHECK_EQUAL(std::string("Port=COM4"), log[1]);
+    CHECK_EQUAL(std::string("Flow=1"), log[2]);
+    CHECK_EQUAL(std::string("Scale=1.5"), log[3]);
+    CHECK(M.find("Flow")->isChecked());
+
+    // validation
+    CHECK(M.invalid().empty());
+    M.find("Baud")->value("96k");
+    M.find("Scale")->value("");
+    M.find("Style")->value("bars");
+    CHECK_EQUAL(3, (int)M.invalid().size());
+    M.find("Baud")->value("9600");
+    M.find("Scale")->value("1e-3");
+    M.find("Style")->value("line");
+    CHECK(M.invalid().empty());
+
+    // diff matches by category and name
+    wex::propertyModel O;
+    O.category("Serial");
+    O.string("Port", "COM4");
+    O.integer("Baud", 19200);
+    O.category("Plot");
+    O.real("Scale", 1e-3);
+    O.string("Title", "");
+    auto d = M.diff(O);
+    CHECK_EQUAL(5, (int)d.size());
+    int changed = 0, removed = 0, added = 0;
+    for (auto &e : d)
+    {
+        switch (e.kind)
+        {
+        case wex::sPropertyDiff::eKind::changed:
+            changed++;
+            CHECK_EQUAL(std::string("Baud"), e.name);
+            CHECK_EQUAL(std::string("19200"), e.otherValue);
+            break;
+        case wex::sPropertyDiff::eKind::removed:
+            removed++;
+            break;
+        case wex::sPropertyDiff::eKind::added:
+            added++;
+            CHECK_EQUAL(std::string("Title"), e.name);
+            break;
+        }
+    }
+    CHECK_EQUAL(1, changed);
+    CHECK_EQUAL(3, removed); // Flow, Style and Plot.Baud
+    CHECK_EQUAL(1, added);
+
+#ifdef windex_has_boost
+    // JSON round trip keeps types and values
+    wex::propertyModel J;
+    J.addjson(M.json());
+    CHECK(M.diff(J).empty());
+    CHECK(J.find("Plot", "Style")->type() == wex::property::eType::choice);
+    CHECK_EQUAL(2, (int)J.find("Style")->choices().size());
+    CHECK(J.find("Flow")->isChecked());
+    CHECK(J.find("Baud")->type() == wex::property::eType::integer);
+#endif
+
+    // clear notifies with no property
+    bool cleared = false;
+    M.listen([&](wex::property *p, wex::propertyModel::eChange c)
+             { cleared = cleared || (c == wex::propertyModel::eChange::clear && !p); });
+    M.clear();
+    CHECK(cleared);
+    CHECK_EQUAL(0, M.size());
+}
+
+TEST(propertyIndex)
+{
+    // indexed lookups agree with a scan of the properties
+    wex::propertyModel M;
+    M.string("loose", "0");
+    for (int c = 0; c < 100; c++)
+    {
+        M.category("cat" + std::to_string(c % 90));
+        for (int p = 0; p < 100; p++)
+            M.integer("p" + std::to_string(p), c * 1000 + p);
+    }
+    auto scan = [&](const std::string &cat, const std::string &name) -> wex::property *
+    {
+        std::string current;
+        bool first = true;
+        std::map<std::string, int> seen;
+        for (int k = 0; k < M.size(); k++)
+        {
+            auto &P = M[k];
+            if (P.isCategory())
+            {
+                current = P.name();
+                first = seen[current]++ == 0;
+            }
+            else if (first && current == cat && P.name() == name)
+                return &P;
+        }
+        return nullptr;
+    };
+    int mismatch = 0;
+    for (int c = 0; c < 100; c++)
+        for (int p = 0; p < 110; p += 7)
+        {
+            std::string cat = "cat" + std::to_string(c);
+            std::string name = "p" + std::to_string(p);
+            if (M.find(cat, name) != scan(cat, name))
+                mismatch++;
+            if (M.find(wex::propertyKey(cat, name)) != M.find(cat, name))
+                mismatch++;
+        }
+    CHECK_EQUAL(0, mismatch);
+
+    // repeated names find the first
+    CHECK_EQUAL(5, (int)M.find("p5")->integer());
+    CHECK_EQUAL(89005, (int)M.find("cat89", "p5")->integer());
+    CHECK(M.find("cat90", "p5") == nullptr);
+    CHECK_EQUAL(std::string("0"), M.find("", "loose")->value());
+    CHECK(M.findCategory("cat3")->isCategory());
+    CHECK(M.findCategory("p3") == nullptr);
+
+    // indices follow clear and reload
+    wex::propertyKey key("cat1", "p1");
+    M.clear();
+    CHECK(M.find(key) == nullptr);
+    CHECK(M.find("p1") == nullptr);
+    M.category("cat1");
+    M.string("p1", "again");
+    CHECK_EQUAL(std::string("again"), M.find(key)->value());
+}
+
+/// JSON config with categories of mixed type properties
+std::string propertyJSON(int categories, int perCategory)
+{
+    std::string json = "{";
+    for (int c = 0; c < categories; c++)
+    {
+        if (c)
+            json += ",";
+        json += "\n\"cat" + std::to_string(c) + "\": {";
+        for (int p = 0; p < perCategory; p++)
+        {
+            if (p)
+                json += ",";
+            std::string name = "\"p" + std::to_string(p) + "\": ";
+            switch (p % 4)
+            {
+            case 0:
+                json += name + "{ \"type\": 0, \"value\": \"text \\\"" + std::to_string(p) + "\\\"\" }";
+                break;
+            case 1:
+                json += name + "{ \"type\": 1, \"value\": \"b\", \"choice0\": \"a\", \"choice1\": \"b\" }";
+                break;
+            case 2:
+                json += name + "{ \"type\": 2, \"value\": \"1\" }";
+                break;
+            case 3:
+                json += name + "{ \"type\": 4, \"value\": " + std::to_string(c * 1000 + p) + " }";
+                break;
+            }
+        }
+        json += "}";
+    }
+    json += "}";
+    return json;
+}
+
+TEST(propertyBulkLoad)
+{
+    std::string json = propertyJSON(100, 100);
+
+    wex::propertyModel M;
+    int adds = 0, loads = 0;
+    M.listen([&](wex::property *p, wex::propertyModel::eChange c)
+             {
+                 if (c == wex::propertyModel::eChange::add)
+                     adds++;
+                 if (c == wex::propertyModel::eChange::load)
+                     loads++; });
+
+    auto start = std::chrono::steady_clock::now();
+    M.addjson(json);
+    double msecs = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count() /
+                   1000.0;
+    std::cout << "addjson 10,000 properties " << msecs << " ms\n";
+
+    // one notification for the whole load
+    CHECK_EQUAL(0, adds);
+    CHECK_EQUAL(1, loads);
+    CHECK_EQUAL(10100, M.size());
+    CHECK(M.invalid().empty());
+    CHECK_EQUAL(std::string("text \"4\""), M.find("cat7", "p4")->value());
+    CHECK_EQUAL(std::string("b"), M.find("cat7", "p5")->value());
+    CHECK_EQUAL(2, (int)M.find("cat7", "p5")->choices().size());
+    CHECK(M.find("cat7", "p6")->isChecked());
+    CHECK_EQUAL(7007, (int)M.find("cat7", "p7")->integer());
+
+#ifdef windex_has_boost
+    // same result as reading through a boost property tree
+    std::stringstream ss(json);
+    boost::property_tree::ptree tree;
+    start = std::chrono::steady_clock::now();
+    read_json(ss, tree);
+    wex::propertyModel B;
+    B.add(tree);
+    msecs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count() /
+            1000.0;
+    std::cout << "boost ptree 10,000 properties " << msecs << " ms\n";
+    CHECK(M.diff(B).empty());
+
+    // and survives a round trip
+    wex::propertyModel R;
+    R.addjson(M.json());
+    CHECK(M.diff(R).empty());
+#endif
+
+    // escapes and scalar properties
+    wex::propertyModel E;
+    E.addjson("{ \"c\": { \"s\": \"tab\\there \\u00e9\\ud83d\\ude00\", \"n\": { \"value\": -1.5e3 } } }");
+    CHECK_EQUAL(std::string("tab\there \xc3\xa9\xf0\x9f\x98\x80"), E.find("c", "s")->value());
+    CHECK_EQUAL(std::string("-1.5e3"), E.find("c", "n")->value());
+
+    // format errors throw
+    int thrown = 0;
+    for (std::string bad : {"{ \"c\": { \"s\": 1 }", "{ \"c\" 1 }", "{ \"c\": tru }", "{ \"c\": \"x }", "{} x"})
+    {
+        try
+        {
+            wex::propertyModel X;
+            X.addjson(bad);
+        }
+        catch (std::runtime_error &)
+        {
+            thrown++;
+        }
+    }
+    CHECK_EQUAL(5, thrown);
+
+    // a failed load adds nothing and does not notify
+    wex::propertyModel F;
+    F.category("keep");
+    F.string("a", "1");
+    loads = 0;
+    F.listen([&](wex::property *p, wex::propertyModel::eChange c)
+             {
+                 if (c == wex::propertyModel::eChange::load)
+                     loads++; });
+    for (std::string bad : {
+             "{ \"c\": { \"s\": \"x\", \"t\": { \"value\": 1 } }, \"keep\": { \"b\": 1 }, \"d\": { \"s\" 1 } }",
+             "{ \"c\": { \"s\": \"x\" }, \"k\": 5 }"})
+    {
+        thrown = 0;
+        try
+        {
+            F.addjson(bad);
+        }
+        catch (std::runtime_error &)
+        {
+            thrown++;
+        }
+        CHECK_EQUAL(1, thrown);
+        CHECK_EQUAL(2, F.size());
+        CHECK_EQUAL(0, loads);
+        CHECK(F.findCategory("c") == nullptr);
+        CHECK(F.find("s") == nullptr);
+        CHECK(F.find("c", "t") == nullptr);
+        CHECK(F.find("keep", "b") == nullptr);
+        CHECK_EQUAL(std::string("1"), F.find("keep", "a")->value());
+    }
+
+    // and the model carries on from where it was
+    F.string("b", "2");
+    CHECK_EQUAL(std::string("2"), F.find("keep", "b")->value());
+    F.addjson("{ \"c\": { \"s\": \"x\" } }");
+    CHECK_EQUAL(1, loads);
+    CHECK_EQUAL(std::string("x"), F.find("c", "s")->value());
+}
+
+/// table provider generating rows, counting fetches
+class cCountingRows : public wex::tableProvider
+{
+public:
+    std::atomic<int> fetches{0};
+    std::atomic<int> rowsFetched{0};
+    int rows;
+    cCountingRows(int rows) : rows(rows) {}
+    int rowCount() override
+    {
+        return rows;
+    }
+    int colCount() override
+    {
+        return 2;
+    }
+    void fetch(int first, int count, std::vector<wex::tableRow> &ret) override
+    {
+        fetches++;
+        rowsFetched += count;
+        for (int r = first; r < first + count; r++)
+            ret.push_back({1000 + r, {std::to_string(1000 + r), "row" + std::to_string(r)}});
+    }
+};
+
+/// rows whose fetch, once armed, blocks on threads other than the test's
+class cGatedRows : public cCountingRows
+{
+public:
+    cGatedRows(int rows) : cCountingRows(rows), myMain(std::this_thread::get_id()) {}
+    void arm()
+    {
+        std::lock_guard<std::mutex> lck(myMutex);
+        myfArmed = true;
+    }
+    void release()
+    {
+        std::lock_guard<std::mutex> lck(myMutex);
+        myfArmed = false;
+        myCV.notify_all();
+    }
+    /// true when another thread is blocked in fetch
+    bool waitBlocked()
+    {
+        std::unique_lock<std::mutex> lck(myMutex);
+        return myCV.wait_for(lck, std::chrono::seconds(5), [this]
+                             { return myfBlocked; });
+    }
+    void fetch(int first, int count, std::vector<wex::tableRow> &ret) override
+    {
+        if (std::this_thread::get_id() != myMain)
+        {
+            std::unique_lock<std::mutex> lck(myMutex);
+            if (myfArmed)
+            {
+                myfBlocked = true;
+                myCV.notify_all();
+                myCV.wait(lck, [this]
+                          { return !myfArmed; });
+            }
+        }
+        cCountingRows::fetch(first, count, ret);
+    }
+
+private:
+    std::thread::id myMain;
+    std::mutex myMutex;
+    std::condition_variable myCV;
+    bool myfArmed = false;
+    bool myfBlocked = false;
+};
+
+TEST(tableRowCache)
+{
+    auto P = std::make_shared<cCountingRows>(1000000);
+    wex::tableRowCache C(100);
+    C.provider(P);
+
+    // only the rows requested are fetched, in one call
+    auto rows = C.range(500, 30);
+    CHECK_EQUAL(30, (int)rows.size());
+    CHECK_EQUAL(1, (int)P->fetches);
+    CHECK_EQUAL(30, (int)P->rowsFetched);
+    CHECK_EQUAL(1510, (int)rows[10]->id);
+    CHECK_EQUAL(std::string("row510"), rows[10]->cell[1]);
+
+    // overlapping request fetches only the missing run
+    rows = C.range(520, 30);
+    CHECK_EQUAL(2, (int)P->fetches);
+    CHECK_EQUAL(50, (int)P->rowsFetched);
+    CHECK_EQUAL(10, C.hits());
+    CHECK_EQUAL(50, C.misses());
+
+    // least recently used rows are evicted
+    C.range(520, 30); // 520 .. 549 now most recent
+    C.range(0, 60);
+    CHECK_EQUAL(100, C.size());
+    CHECK(C.isCached(520));
+    CHECK(!C.isCached(500));
+    CHECK_EQUAL(std::string("row505"), C.row(505)->cell[1]); // refetched
+
+    // rows returned stay valid after eviction
+    auto kept = C.row(999999);
+    C.range(0, 100);
+    CHECK(!C.isCached(999999));
+    CHECK_EQUAL(1000999, (int)kept->id);
+
+    // end of table
+    CHECK_EQUAL(1, (int)C.range(999999, 30).size());
+
+    // prefetch fetches the rows beyond, in the scroll direction
+    wex::tableRowCache F(1000);
+    F.provider(P);
+    F.prefetch(true, 2);
+    F.range(0, 30);
+    F.range(30, 30);
+    for (int wait = 0; wait < 200 && !F.isCached(119); wait++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK(F.isCached(60));
+    CHECK(F.isCached(119));
+    int misses = F.misses();
+    F.range(60, 30);
+    F.range(90, 30);
+    CHECK_EQUAL(misses, F.misses());
+
+    // and backwards
+    F.range(5000, 30);
+    F.range(4970, 30);
+    for (int wait = 0; wait < 200 && !F.isCached(4910); wait++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK(F.isCached(4910));
+    CHECK(!F.isCached(4909));
+    F.prefetch(false);
+
+    // view sorted while the prefetch thread is fetching in the old order
+    {
+        auto G = std::make_shared<cGatedRows>(1000);
+        auto view = std::make_shared<wex::tableIndexProvider>(G);
+        wex::tableRowCache S(1000);
+        S.provider(view);
+        S.prefetch(true, 1);
+        S.range(0, 10);
+        G->arm();
+        S.range(10, 10); // prefetch 20 .. 29 blocks in the provider
+        CHECK(G->waitBlocked());
+        view->sort({{0, true}});
+        S.clear(); // as table::refresh() does
+        G->release();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        S.prefetch(false);
+        int stale = 0;
+        for (int k = 20; k < 30; k++)
+            if (S.isCached(k) && S.row(k)->id != 1000 + 999 - k)
+                stale++;
+        CHECK_EQUAL(0, stale);
+        CHECK_EQUAL(1000 + 999 - 25, (int)S.row(25)->id);
+    }
+
+    // string providers read the row ID from the first column
+    wex::tableRowCache V;
+    V.provider(std::make_shared<wex::tableVectorProvider>(
+        std::vector<std::vector<std::string>>{{"7", "a"}, {"9", "b"}}));
+    CHECK_EQUAL(9, (int)V.row(1)->id);
+    V.provider(std::make_shared<wex::tableFlatProvider>(
+        std::vector<std::string>{"1", "a", "b", "2", "c", "d"}, 3));
+    CHECK_EQUAL(2, V.rowCount());
+    CHECK_EQUAL(3, V.colCount());
+    CHECK_EQUAL(std::string("d"), V.row(1)->cell[2]);
+    CHECK_EQUAL(2, (int)V.row(1)->id);
+}
+
+TEST(tableColumnProvider)
+{
+    auto P = std::make_shared<wex::tableColumnProvider>();
+    P->ids({101, 102, 103});
+    CHECK_EQUAL(1, P->int64Column({-5, 0, 9000000000LL}));
+    CHECK_EQUAL(2, P->realColumn({1.5, 2.25, -0.125}, 2));
+    CHECK_EQUAL(3, P->textColumn({"red", "blue", "red"}));
+    CHECK_EQUAL(3, P->rowCount());
+    CHECK_EQUAL(4, P->colCount());
+
+    // typed values, text stored once
+    CHECK(P->type(0) == wex::tableColumnProvider::eType::int64);
+    CHECK(P->type(2) == wex::tableColumnProvider::eType::real);
+    CHECK_EQUAL(9000000000LL, P->int64(2, 1));
+    CHECK_CLOSE(2.25, P->real(1, 2), 1e-12);
+    CHECK_EQUAL(2, (int)P->dictionary(3).size());
+    CHECK_EQUAL(P->code(0, 3), P->code(2, 3));
+    CHECK_EQUAL(std::string("blue"), P->text(1, 3));
+
+    // formatted when fetched, ID is the first column
+    wex::tableRowCache C;
+    C.provider(P);
+    auto r = C.row(2);
+    CHECK_EQUAL(103, (int)r->id);
+    CHECK_EQUAL(std::string("103"), r->cell[0]);
+    CHECK_EQUAL(std::string("9000000000"), r->cell[1]);
+    CHECK_EQUAL(std::string("-0.12"), r->cell[2]);
+    CHECK_EQUAL(std::string("red"), r->cell[3]);
+
+    // without IDs the row index is the ID
+    wex::tableColumnProvider Q;
+    Q.textColumn({0, 1, 1}, {"x", "y"});
+    CHECK_EQUAL(1, (int)Q.id(1));
+    CHECK_EQUAL(std::string("y"), Q.format(2, 1));
+    Q.realColumn({1e300, 0, 0}, 2);
+    CHECK_EQUAL(std::string("1e+300"), Q.format(0, 2));
+
+    bool fThrow = false;
+    try
+    {
+        Q.int64Column({1, 2});
+    }
+    catch (std::runtime_error &)
+    {
+        fThrow = true;
+    }
+    CHECK(fThrow);
+}
+
+TEST(tableIndexProvider)
+{
+    auto P = std::make_shared<wex::tableColumnProvider>();
+    P->textColumn({"b", "a", "b", "a", "c"});
+    P->realColumn({2, 1, NAN, 1, 3}, 0);
+    wex::tableIndexProvider V(P);
+
+    // stable multi column sort, base rows untouched
+    V.sort({{1, false}, {2, true}});
+    CHECK(V.index() == std::vector<int>({1, 3, 2, 0, 4}));
+    V.sort({{2, false}});
+    CHECK(V.index() == std::vector<int>({1, 3, 0, 4, 2})); // NaN is largest
+    V.sort({{1, true}});
+    CHECK(V.index() == std::vector<int>({4, 0, 2, 1, 3}));
+    CHECK_EQUAL(std::string("b"), P->text(0, 1));
+
+    // negative numbers, and -0 equal to 0
+    auto N = std::make_shared<wex::tableColumnProvider>();
+    N->realColumn({0, -2.5, 1, -0.0, -1e300}, 1);
+    N->int64Column({5, -3, 0, -7, 2});
+    wex::tableIndexProvider W(N);
+    W.sort({{1, false}});
+    CHECK(W.index() == std::vector<int>({4, 1, 0, 3, 2}));
+    W.sort({{2, true}});
+    CHECK(W.index() == std::vector<int>({0, 4, 2, 1, 3}));
+
+    // fetch through the view
+    std::vector<wex::tableRow> rows;
+    V.fetch(0, 2, rows);
+    CHECK_EQUAL(4, (int)rows[0].id);
+    CHECK_EQUAL(std::string("b"), rows[1].cell[1]);
+
+    // prefix search, binary when sorted on the column
+    V.sort({{1, false}});
+    CHECK_EQUAL(2, V.search(1, "b"));
+    CHECK_EQUAL(-1, V.search(1, "d"));
+    CHECK_EQUAL(4, V.search(2, "3"));
+
+    // filter keeps view order
+    V.filter([&](int row)
+             { return P->text(row, 1) != "a"; });
+    CHECK(V.index() == std::vector<int>({0, 2, 4}));
+    V.reset();
+    CHECK_EQUAL(5, V.rowCount());
+    CHECK_EQUAL(0, V.baseRow(0));
+
+    // other providers sort on formatted text
+    wex::tableIndexProvider S(std::make_shared<wex::tableVectorProvider>(
+        std::vector<std::vector<std::string>>{{"3", "x"}, {"1", "y"}, {"2", "x"}}));
+    S.sort({{1, true}, {0, false}});
+    CHECK(S.index() == std::vector<int>({1, 2, 0}));
+    CHECK_EQUAL(1, S.search(1, "x"));
+
+    // parallel sort of a million rows gives the serial order
+    const int n = 1000000;
+    std::vector<long long> group(n);
+    std::vector<double> value(n);
+    for (int k = 0; k < n; k++)
+    {
+        group[k] = (k * 7919LL) % 1000;
+        value[k] = (k * 104729LL) % 5000;
+    }
+    auto M = std::make_shared<wex::tableColumnProvider>();
+    M->int64Column(group);
+    M->realColumn(value);
+    wex::tableIndexProvider serial(M), parallel(M);
+    serial.sort({{1, false}, {2, false}}, 1);
+    parallel.sort({{1, false}, {2, false}}, 0);
+    CHECK(serial.index() == parallel.index());
+}
+
+/// a scene drawn by anything with the shapes drawing methods
+template <class T>
+void displayScene(T &S, int gaugeValue)
+{
+    // static
+    S.color(0x808080);
+    S.penThick(2);
+    S.rectangle({10, 10, 100, 60});
+    S.fill();
+    S.polygon({120, 10, 180, 10, 150, 60});
+    S.fill(false);
+    S.circle(50, 120, 30);
+    S.penThick(1);
+    S.text("gauge", {10, 160, 80, 20});
+
+    // moving
+    S.color(0x0000FF);
+    S.line({50, 120, 50 + gaugeValue, 100});
+    S.arc(150, 120, 25, 0, 90);
+    S.polyLine({cxy(10, 190), cxy(60, 180), cxy(120, 195)});
+    S.pixel(199, 199);
+}
+
+TEST(displayList)
+{
+    // replay draws what drawing directly draws
+    wex::displayList L;
+    displayScene(L, 10);
+    CHECK_EQUAL(14, L.size());
+    wex::displayRaster direct(200, 200), replayed(200, 200);
+    displayScene(direct, 10);
+    L.replay(replayed);
+    CHECK(direct == replayed);
+    CHECK_EQUAL(8, replayed.calls());
+    CHECK_EQUAL(std::string("gauge"), replayed.texts()[0].first);
+    CHECK_EQUAL(0x808080, replayed.get(130, 20)); // filled polygon
+    CHECK_EQUAL(0xFFFFFF, replayed.get(50, 50));  // outlined rectangle
+    CHECK_EQUAL(0x0000FF, replayed.get(199, 199));
+
+    // clipped replay skips drawing outside, draws the same inside
+    wex::displayRaster clipped(200, 200);
+    L.replay(clipped, {0, 0, 115, 75});
+    CHECK_EQUAL(1, clipped.calls());
+    for (int y = 0; y < 75; y++)
+        for (int x = 0; x < 115; x++)
+            if (clipped.get(x, y) != direct.get(x, y))
+                CHECK_EQUAL(direct.get(x, y), clipped.get(x, y));
+
+    // diff finds the area that draws differently
+    wex::displayList M;
+    displayScene(M, 10);
+    CHECK(L.diff(M).empty());
+    wex::displayList N;
+    displayScene(N, 30);
+    auto changed = L.diff(N);
+    CHECK_EQUAL(4, (int)changed.size());
+    CHECK(changed[0] <= 50 && changed[1] <= 100);
+    CHECK(changed[0] + changed[2] >= 80 && changed[1] + changed[3] >= 120);
+    CHECK(changed[1] > 70); // the static part above is unchanged
+
+    // segments re-record independently, state flows on
+    wex::displayList S;
+    S.segment(0);
+    S.color(0x00FF00);
+    S.rectangle({0, 0, 10, 10});
+    S.segment(1);
+    S.line({0, 20, 10, 20});
+    wex::displayRaster first(30, 30);
+    S.replay(first);
+    CHECK_EQUAL(0x00FF00, first.get(5, 20));
+    S.invalidate(1);
+    CHECK(S.isValid(0));
+    CHECK(!S.isValid(1));
+    wex::displayRaster without(30, 30);
+    S.replay(without);
+    CHECK_EQUAL(0xFFFFFF, without.get(5, 20));
+    S.segment(1);
+    S.line({0, 25, 10, 25});
+    wex::displayRaster again(30, 30);
+    S.replay(again);
+    CHECK_EQUAL(0xFFFFFF, again.get(5, 20));
+    CHECK_EQUAL(0x00FF00, again.get(5, 25));
+    CHECK_EQUAL(0x00FF00, again.get(0, 5));
+
+    // lines exclude their last point, as in GDI
+    wex::displayRaster R(10, 10);
+    R.color(0);
+    R.line({1, 1, 5, 1});
+    CHECK_EQUAL(0, R.get(4, 1));
+    CHECK_EQUAL(0xFFFFFF, R.get(5, 1));
+}
+
+TEST(displayGridCalls)
+{
+    // the axes of a 600 by 400 plot, 8 ticks along x and 4 up y, with dotted grid
+    wex::axisTicks T;
+    std::vector<double> xticks{0, 1, 2, 3, 4, 5, 6, 7}, yticks{0, 1, 2, 3};
+    wex::displayRaster batched(640, 440);
+    T.horz(batched, xticks, 420, 20, 0, 75, true, 20);
+    T.vert(batched, yticks, 20, 420, 0, -100, true, 620);
+
+    // ticks, and the grid as pixel pairs
+    wex::displayRaster pixels(640, 440);
+    for (int kt = 0; kt < 8; kt++)
+    {
+        int x = 20 + kt * 75;
+        pixels.line({x, 415, x, 425});
+        for (int y = 420; y >= 20; y -= 25)
+        {
+            pixels.pixel(x, y);
+            pixels.pixel(x, y + 1);
+        }
+    }
+    for (int kt = 0; kt < 4; kt++)
+    {
+        int y = 420 - kt * 100;
+        pixels.line({15, y, 25, y});
+        for (int x = 20; x < 620; x += 25)
+        {
+            pixels.pixel(x, y);
+            pixels.pixel(x + 1, y);
+        }
+    }
+    CHECK(pixels == batched);
+
+    // a line and a label for each tick, one call for each grid
+    CHECK_EQUAL(2 * 12 + 2, batched.calls());
+    CHECK_EQUAL(12, (int)batched.texts().size());
+    CHECK_EQUAL(std::string("0"), batched.texts()[0].first);
+    std::cout << "grid drawing calls " << pixels.calls()
+              << " pixel, " << batched.calls() << " axisTicks\n";
+
+    // recorded and replayed
+    wex::displayList L;
+    T.horz(L, xticks, 420, 20, 0, 75, true, 20);
+    T.vert(L, yticks, 20, 420, 0, -100, true, 620);
+    wex::displayRaster replayed(640, 440);
+    L.replay(replayed);
+    CHECK(batched == replayed);
+    CHECK_EQUAL(batched.calls(), replayed.calls());
+}
+
+/// axis label as formatted before labelFormat
+std::string labelStream(double f)
+{
+    if (f == 0)
+        return "0";
+    int n = 3;
+    int d = (int)::floor(::log10(f < 0 ? -f : f)) + 1;
+    double order = ::pow(10., n - d);
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(std::max(n - d, 0)) << round(f * order) / order;
+    return ss.str();
+}
+
+TEST(labelFormat)
+{
+    char buf[wex::labelFormat::bufSize];
+    wex::labelFormat::format(buf, 1234.5);
+    CHECK_EQUAL(std::string("1230"), std::string(buf));
+    wex::labelFormat::format(buf, -0.0012345);
+    CHECK_EQUAL(std::string("-0.00123"), std::string(buf));
+    wex::labelFormat::format(buf, 0.5, 2);
+    CHECK_EQUAL(std::string("0.50"), std::string(buf));
+    wex::labelFormat::format(buf, 1e-100);
+    CHECK_EQUAL(std::string("1e-100"), std::string(buf));
+    wex::labelFormat::format(buf, NAN);
+    CHECK_EQUAL(std::string("nan"), std::string(buf));
+
+    // same labels as before, over the ranges plots see
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> mantissa(-10, 10);
+    std::uniform_int_distribution<int> exponent(-6, 8);
+    std::vector<double> values;
+    for (int k = 0; k < 20000; k++)
+        values.push_back(mantissa(gen) * pow(10, exponent(gen)));
+    int mismatch = 0;
+    for (double v : values)
+    {
+        wex::labelFormat::format(buf, v);
+        if (labelStream(v) != buf)
+            mismatch++;
+    }
+    CHECK_EQUAL(0, mismatch);
+
+    // cached label
+    wex::labelFormat F(4);
+    const std::string &l = F.label(2.5);
+    CHECK_EQUAL(std::string("2.50"), l);
+    CHECK(&l == &F.label(2.5));
+    CHECK_EQUAL(1, F.size());
+    for (int k = 0; k < 4; k++)
+        F.label(k);
+    CHECK_EQUAL(1, F.size()); // cleared when full
+
+    // cost per label: the ticks of an axis repainted many times
+    std::vector<double> ticks;
+    for (int k = 0; k < 8; k++)
+        ticks.push_back(-3.75 + k * 12.125);
+    const int paints = 20000;
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < paints; p++)
+        for (double t : ticks)
+            total += labelStream(t).size();
+    auto nsecs = [&]
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count() /
+               (double)(paints * ticks.size());
+    };
+    double stream = nsecs();
+    start = std::chrono::steady_clock::now();
+    for (int p = 0; p < paints; p++)
+        for (double t : ticks)
+            total += wex::labelFormat::format(buf, t);
+    double format = nsecs();
+    wex::labelFormat cache;
+    start = std::chrono::steady_clock::now();
+    for (int p = 0; p < paints; p++)
+        for (double t : ticks)
+            total += cache.label(t).size();
+    double cached = nsecs();
+    CHECK(total > 0);
+    std::cout << "axis label ns: stringstream " << stream
+              << ", format " << format
+              << ", cached " << cached << "\n";
+}
+
+int main()
+{
+    return raven::set::UnitTest::RunAllTests();
+}
@@ -11,6 +11,7 @@
 #include <CommCtrl.h>
 #include <Shellapi.h>
 #include "cxy.h"
+#include "displaylist.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -21,7 +22,6 @@ namespace wex
 
     class gui;
 
-    typedef std::map<HWND, gui *> mgui_t;
     typedef std::vector<gui *> children_t;
 
     /// A structure containing the mouse status for event handlers
@@ -532,7 +532,7 @@ namespace wex
         @param[in] ps The PAINTSTRUCT passed as parameter into the draw event handler
     */
         shapes(PAINTSTRUCT &ps)
-            : myHDC(ps.hdc), myPenThick(1), myFill(false)
+            : myHDC(ps.hdc), myPenThick(1), myFill(false), myRecord(nullptr)
         {
             hPen = CreatePen(
                 PS_SOLID,
@@ -566,21 +566,15 @@ namespace wex
         }
         void color(int c)
         {
-            myColor = c;
-            hPen = CreatePen(
-                PS_SOLID,
-                myPenThick,
-                c);
-            HGDIOBJ old = SelectObject(myHDC, hPen);
-            DeleteObject(old);
-            SetTextColor(myHDC, c);
-            HBRUSH brush = CreateSolidBrush(c);
-            old = SelectObject(myHDC, brush);
-            DeleteObject(old);
+            if (myRecord)
+                myRecord->color(c);
+            select(c);
         }
         /// set background color
         void bgcolor(int c)
         {
+            if (myRecord)
+                myRecord->bgcolor(c);
             SetBkColor(
                 myHDC,
                 c);
@@ -592,6 +586,8 @@ namespace wex
         /// enable/disable transparent background
         void transparent(bool f = true)
         {
+            if (myRecord)
+                myRecord->transparent(f);
             SetBkMode(
                 myHDC,
                 TRANSPARENT);
@@ -600,18 +596,53 @@ namespace wex
         /// Set pen thickness in pixels
         void penThick(int t)
         {
+            if (myRecord)
+                myRecord->penThick(t);
             myPenThick = t;
-            color(myColor);
+            select(myColor);
         }
 
         /// Set filling option
         void fill(bool f = true)
         {
+            if (myRecord)
+                myRecord->fill(f);
             myFill = f;
         }
+
+        /** Record drawing
+        @param[in] list to record into, nullptr to stop recording
+
+        While recording, drawing calls are drawn and also appended to the list,
+        in the segment started by the last list.segment() call.
+        */
+        void record(displayList *list)
+        {
+            myRecord = list;
+        }
+        /** Draw recorded drawing
+        @param[in] list drawing recorded
+        @param[in] clip left, top, width, height.  Drawing entirely outside is skipped.
+
+        For a partial repaint, pass the PAINTSTRUCT rcPaint as the clip.
+        Recording is suspended while replaying.
+        */
+        void replay(
+            const displayList &list,
+            const std::vector<int> &clip = {})
+        {
+            // replaying the list being recorded would append to it while it is read
+            displayList *record = myRecord;
+            myRecord = nullptr;
+            list.replay(*this, clip);
+            myRecord = record;
+        }
+
         /// Color a pixel
         void pixel(int x, int y)
         {
+            if (myRecord)
+                myRecord->pixel(x, y);
             SetPixel(myHDC, x, y, myColor);
         }
         /** Draw line between two points
@@ -619,6 +650,8 @@ namespace wex
     */
         void line(const std::vector<int> &v)
         {
+            if (myRecord)
+                myRecord->line(v);
             MoveToEx(
                 myHDC,
                 v[0],
@@ -632,6 +665,13 @@ namespace wex
 
         void polyLine(POINT *pp, int n)
         {
+            if (myRecord)
+            {
+                std::vector<cxy> v;
+                for (int k = 0; k < n; k++)
+                    v.emplace_back(pp[k].x, pp[k].y);
+                myRecord->polyLine(v);
+            }
             Polyline(
                 myHDC,
                 pp,
@@ -642,11 +682,47 @@ namespace wex
             line({(int)p1.x, (int)p1.y,
                   (int)p2.x, (int)p2.y});
         }
+        /** Draw separate line segments, in one call
+        @param[in] v x1, y1, x2, y2 of each segment
+
+        As for line(), the last point of each segment is not drawn.
+        Many short segments, such as grid dots, cost one GDI call
+        instead of one each.
+    */
+        void segments(const std::vector<int> &v)
+        {
+            if (myRecord)
+                myRecord->segments(v);
+            int n = (int)v.size() / 4;
+            if (!n)
+                return;
+            std::vector<DWORD> count(n, 2);
+            PolyPolyline(
+                myHDC,
+                (const POINT *)v.data(),
+                count.data(),
+                n);
+        }
+        /** Draw lines joining points
+        @param[in] v points, e.g. from cPointReduce::rdp()
+    */
+        void polyLine(const std::vector<cxy> &v)
+        {
+            std::vector<POINT> pp(v.size());
+            for (int k = 0; k < (int)v.size(); k++)
+            {
+                pp[k].x = (int)v[k].x;
+                pp[k].y = (int)v[k].y;
+            }
+            polyLine(pp.data(), (int)pp.size());
+        }
         /** Draw rectangle
         @param[in] v vector with left, top, width, height
     */
         void rectangle(const std::vector<int> &v)
         {
+            if (myRecord)
+                myRecord->rectangle(v);
             if (!myFill)
             {
                 MoveToEx(
@@ -686,8 +762,26 @@ namespace wex
     */
         void polygon(const std::vector<int> &v)
         {
+            if (myRecord)
+                myRecord->polygon(v);
             Polygon(myHDC, (const POINT *)&(v[0]), v.size() / 2);
         }
+        /** Draw Polygon
+
+    @param[in] v vertices, e.g. from cPointReduce::convexHull()
+    */
+        void polygon(const std::vector<cxy> &v)
+        {
+            if (myRecord)
+                myRecord->polygon(v);
+            std::vector<POINT> pp(v.size());
+            for (int k = 0; k < (int)v.size(); k++)
+            {
+                pp[k].x = (int)v[k].x;
+                pp[k].y = (int)v[k].y;
+            }
+            Polygon(myHDC, pp.data(), (int)pp.size());
+        }
 
         /** Draw Arc of circle
 
@@ -703,6 +797,8 @@ namespace wex
             int x, int y, double r,
             double sa, double ea)
         {
+            if (myRecord)
+                myRecord->arc(x, y, r, sa, ea);
             int xl = round(x - r);
             int yt = round(y - r);
             int xr = round(x + r);
@@ -722,6 +818,8 @@ namespace wex
     */
         void circle(int x0, int y0, double r)
         {
+            if (myRecord)
+                myRecord->circle(x0, y0, r);
             //  'empty' circles are filled with a black brush
             HGDIOBJ oldBrush;
             if (!myFill)
@@ -743,6 +841,8 @@ namespace wex
             const std::string &t,
             const std::vector<int> &v)
         {
+            if (myRecord)
+                myRecord->text(t, v);
             if (myLogfont.lfEscapement)
             {
                 // rotated text
@@ -825,6 +925,8 @@ namespace wex
          */
         void textVertical(bool f = true)
         {
+            if (myRecord)
+                myRecord->textVertical(f);
             if (f)
                 myLogfont.lfEscapement = 2700;
             else
@@ -840,6 +942,8 @@ namespace wex
         /// default height 20 if not called
         void textHeight(int h)
         {
+            if (myRecord)
+                myRecord->textHeight(h);
             myLogfont.lfHeight = h;
             HANDLE hFont = CreateFontIndirect(&myLogfont);
             hFont = (HFONT)SelectObject(myHDC, hFont);
@@ -848,6 +952,8 @@ namespace wex
         /// set text font name
         void textFontName(const std::string &fn)
         {
+            if (myRecord)
+                myRecord->textFontName(fn);
             strcpy(myLogfont.lfFaceName, fn.c_str());
             HANDLE hFont = CreateFontIndirect(&myLogfont);
             hFont = (HFONT)SelectObject(myHDC, hFont);
@@ -872,6 +978,23 @@ namespace wex
         bool myFill;
         LOGFONT myLogfont;
         int myColor; // foreground color
+        displayList *myRecord; // null unless recording
+
+        /// select pen, brush and text color
+        void select(int c)
+        {
+            myColor = c;
+            hPen = CreatePen(
+                PS_SOLID,
+                myPenThick,
+                c);
+            HGDIOBJ old = SelectObject(myHDC, hPen);
+            DeleteObject(old);
+            SetTextColor(myHDC, c);
+            HBRUSH brush = CreateSolidBrush(c);
+            old = SelectObject(myHDC, brush);
+            DeleteObject(old);
+        }
     };
 
     /// The base class for all windex gui elements
@@ -885,7 +1008,7 @@ namespace wex
     */
         gui()
             : myParent(NULL), myBGColor(0xC8C8C8), myBGBrush(CreateSolidBrush(myBGColor)), myTextColor(0),
-              myDeleteList(0), myfModal(false), myfEnabled(true), myfnobgerase(false), myToolTip(NULL), myAsyncReadCompleteMsgID(0), myCursorID(0)
+              myfModal(false), myfEnabled(true), myfnobgerase(false), myToolTip(NULL), myAsyncReadCompleteMsgID(0), myCursorID(0)
         {
             myID = NewID();
             Create(
@@ -928,7 +1051,6 @@ namespace wex
             const char *window_class = "windex",
             unsigned long style = WS_CHILD,
             unsigned long exstyle = WS_EX_CONTROLPARENT) : myParent(parent),
-                                                           myDeleteList(0),
                                                            myfEnabled(true),
                                                            myToolTip(NULL),
                                                            myCursorID(IDC_ARROW)
@@ -961,9 +1083,11 @@ namespace wex
         virtual ~gui()
         {
             // std::cout << "deleting " << myText << "\n";
+
+            // stop messages reaching this gui element,
+            // including those sent while the window is destroyed
+            SetWindowLongPtr(myHandle, GWLP_USERDATA, 0);
             DestroyWindow(myHandle);
-            if (myDeleteList)
-                myDeleteList->push_back(myHandle);
         }
 
         /// register child on this window
@@ -1623,8 +1747,6 @@ namespace wex
             myfModal = false;
             modalMgr::get().set(0, 0);
             DestroyWindow(myHandle);
-            if (myDeleteList)
-                myDeleteList->push_back(myHandle);
         }
 
         /** force widget to redraw completely
@@ -1642,6 +1764,17 @@ namespace wex
             for (auto g : myChild)
                 g->update();
         }
+        /** force part of widget to redraw
+        @param[in] r left, top, width, height, e.g. from displayList::diff()
+    */
+        void update(const std::vector<int> &r)
+        {
+            if (r.size() != 4)
+                return;
+            RECT rect{r[0], r[1], r[0] + r[2], r[1] + r[3]};
+            InvalidateRect(myHandle, &rect, true);
+            UpdateWindow(myHandle);
+        }
 
         /** Move the window
         @param[in] r specify location and size
@@ -1720,12 +1853,6 @@ namespace wex
             return myHandle;
         }
 
-        /// set delete list for when gui is detroyed
-        void delete_list(std::vector<HWND> *list)
-        {
-            myDeleteList = list;
-        }
-
         /// change font for this and all child windows
         void setfont(LOGFONT &logfont, HFONT &font)
         {
@@ -1753,7 +1880,6 @@ namespace wex
         HBRUSH myBGBrush;
         LOGFONT myLogFont;
         HFONT myFont;
-        std::vector<HWND> *myDeleteList;
         std::string myText;
         int myID;
         std::vector<gui *> myChild; ///< gui elements to be displayed in this window
@@ -2992,9 +3118,10 @@ namespace wex
         }
     };
 
-    /** A class containing a database of the current gui elements
+    /** A class that directs window messages to the gui elements
 
-    This looks after directing messages to their intended gui element.
+    Each window created by windex stores a pointer to its gui element
+    in GWLP_USERDATA, so a message reaches its handler without a search.
 
     It should NOT be used by application code.
 
@@ -3023,13 +3150,15 @@ namespace wex
     */
         static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         {
-            auto w = get().myGui.find(hwnd);
-            if (w != get().myGui.end())
+            // the window carries a pointer to its gui element, set by Add().
+            // Messages sent while the window is being created, before Add(), get default processing
+            gui *w = (gui *)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+            if (w)
             {
                 if (uMsg == WM_GETDLGCODE)
-                    return w->second->WindowMessageHandler(hwnd, uMsg, wParam, lParam);
+                    return w->WindowMessageHandler(hwnd, uMsg, wParam, lParam);
 
-                if (w->second->WindowMessageHandler(hwnd, uMsg, wParam, lParam))
+                if (w->WindowMessageHandler(hwnd, uMsg, wParam, lParam))
                     return 0;
             }
 
@@ -3040,24 +3169,13 @@ namespace wex
         /// Add new gui element
         gui *Add(gui *g)
         {
-            // delete any destroyed elements
-            Delete();
-
-            // provide reference to delete list, so new gui element can be removed after destruction
-            g->delete_list(&myDeleteList);
-
-            // add to existing gui elements
-            myGui.insert(std::make_pair(g->handle(), g));
-
-            // std::cout << "windexAdd " << myGui.size() <<" in "<< this << "\n";
+            // point the window at its gui element, so WindowProc needs no lookup
+            SetWindowLongPtr(g->handle(), GWLP_USERDATA, (LONG_PTR)g);
 
             return g;
         }
 
-        mgui_t myGui; ///< map of existing gui elements
     private:
-        std::vector<HWND> myDeleteList; ///< gui elements that have been deleted but not yet removed from map
-
         windex()
         {
             // register a callback function
@@ -3070,19 +3188,6 @@ namespace wex
             wc.style = CS_DBLCLKS;
             RegisterClass(&wc);
         }
-
-        /// remove destroyed gui elements
-        void Delete()
-        {
-            // std::cout << "windex::Delete " << myDeleteList.size() << "\n";
-            for (auto h : myDeleteList)
-            {
-                auto i = myGui.find(h);
-                if (i != myGui.end())
-                    myGui.erase(i);
-            }
-            myDeleteList.clear();
-        }
     };
 
     /** \brief A drop down list of options that user can click to start an action.